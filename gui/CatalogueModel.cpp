@@ -0,0 +1,345 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 1.2.1 (CatalogueModel.cpp) - Source Finding Application        ///
+/// Copyright (C) 2014-2018 Tobias Westmeier                             ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+// Include zlib.h for decompression of catalogue file
+#include <zlib.h>
+
+#include "CatalogueModel.h"
+
+// ----------- //
+// Constructor //
+// ----------- //
+
+CatalogueModel::CatalogueModel(QObject *parent) : QAbstractTableModel(parent)
+{
+	rows       = 0;
+	cellColumn = 0;
+	inCell     = false;
+	inRow      = false;
+	
+	return;
+}
+
+
+
+// -------------------------------------------- //
+// Function to load catalogue from VOTable file //
+// -------------------------------------------- //
+
+int CatalogueModel::loadCatalog(const QString &filename)
+{
+	// The file is read in chunks of CATALOGUE_CHUNK_SIZE bytes, each of
+	// which is handed to a streaming XML parser right away, so that neither
+	// the file nor a document tree need to be held in memory. Plain files
+	// are read through zlib as well, which passes them on unchanged.
+	beginResetModel();
+	
+	columns.clear();
+	order.clear();
+	rows       = 0;
+	cellColumn = 0;
+	inCell     = false;
+	inRow      = false;
+	cellText.clear();
+	reader.clear();
+	
+	gzFile file = gzopen(filename.toUtf8().constData(), "rb");
+	bool success = (file != 0);
+	
+	if(success)
+	{
+		QByteArray buffer(CATALOGUE_CHUNK_SIZE, 0);
+		int nBytes = 0;
+		
+		while(success and (nBytes = gzread(file, buffer.data(), buffer.size())) > 0)
+		{
+			reader.addData(QByteArray(buffer.constData(), nBytes));
+			success = parse();
+		}
+		
+		success = success and nBytes == 0 and not reader.hasError();
+		gzclose(file);
+	}
+	
+	reader.clear();
+	
+	// Catalogues without fields or rows are considered invalid, but the
+	// columns of an empty catalogue are still shown.
+	if(not success or columns.isEmpty())
+	{
+		columns.clear();
+		rows = 0;
+	}
+	
+	order.resize(rows);
+	for(int i = 0; i < rows; ++i) order[i] = i;
+	
+	endResetModel();
+	
+	return rows ? 0 : 1;
+}
+
+
+
+// ---------------------------------------------------- //
+// Function to process all data available to the parser //
+// ---------------------------------------------------- //
+
+bool CatalogueModel::parse()
+{
+	// Returns false on a genuine XML error; running out of data in the
+	// middle of the document only means that the next chunk is needed.
+	while(not reader.atEnd())
+	{
+		const QXmlStreamReader::TokenType token = reader.readNext();
+		
+		if(token == QXmlStreamReader::StartElement)
+		{
+			const QStringRef tag = reader.name();
+			
+			if(tag == QLatin1String("FIELD"))
+			{
+				const QXmlStreamAttributes attributes = reader.attributes();
+				Column column;
+				column.name    = attributes.value("name").toString().trimmed();
+				column.unit    = attributes.value("unit").toString();
+				column.numeric = (attributes.value("datatype") != QLatin1String("char"));
+				columns.append(column);
+			}
+			else if(tag == QLatin1String("TR"))
+			{
+				startRow();
+			}
+			else if(tag == QLatin1String("TD") and inRow)
+			{
+				inCell = true;
+				cellText.clear();
+			}
+		}
+		else if(token == QXmlStreamReader::Characters and inCell)
+		{
+			cellText += reader.text();
+		}
+		else if(token == QXmlStreamReader::EndElement)
+		{
+			const QStringRef tag = reader.name();
+			
+			if(tag == QLatin1String("TD") and inCell)
+			{
+				storeCell();
+				inCell = false;
+			}
+			else if(tag == QLatin1String("TR"))
+			{
+				inRow = false;
+			}
+		}
+	}
+	
+	return not reader.hasError() or reader.error() == QXmlStreamReader::PrematureEndOfDocumentError;
+}
+
+
+
+// ----------------------------------------- //
+// Functions to append new row and its cells //
+// ----------------------------------------- //
+
+void CatalogueModel::startRow()
+{
+	// All cells are blank until read
+	for(int j = 0; j < columns.size(); ++j)
+	{
+		Column &column = columns[j];
+		
+		if(column.numeric) column.values.append(0.0);
+		else               column.texts.append(QString());
+		column.blank.append(true);
+	}
+	
+	++rows;
+	cellColumn = 0;
+	inRow = true;
+	
+	return;
+}
+
+void CatalogueModel::storeCell()
+{
+	// Surplus cells are ignored, and empty cells stay blank
+	const QString text = cellText.trimmed();
+	
+	if(cellColumn < columns.size() and not text.isEmpty())
+	{
+		Column &column = columns[cellColumn];
+		
+		if(column.numeric) column.values[rows - 1] = text.toDouble();
+		else               column.texts[rows - 1] = text;
+		column.blank[rows - 1] = false;
+	}
+	
+	++cellColumn;
+	
+	return;
+}
+
+
+
+// --------------------------------------- //
+// Function to remove catalogue from model //
+// --------------------------------------- //
+
+void CatalogueModel::clear()
+{
+	beginResetModel();
+	columns.clear();
+	order.clear();
+	rows = 0;
+	endResetModel();
+	
+	return;
+}
+
+
+
+// ------------------------------ //
+// Functions required by the view //
+// ------------------------------ //
+
+int CatalogueModel::rowCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : rows;
+}
+
+int CatalogueModel::columnCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : columns.size();
+}
+
+QString CatalogueModel::columnName(int column) const
+{
+	if(column < 0 or column >= columns.size()) return QString();
+	return columns[column].name;
+}
+
+QVariant CatalogueModel::data(const QModelIndex &index, int role) const
+{
+	if(not index.isValid() or index.row() >= rows or index.column() >= columns.size()) return QVariant();
+	
+	if(role == Qt::TextAlignmentRole) return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+	if(role != Qt::DisplayRole) return QVariant();
+	
+	const Column &column = columns[index.column()];
+	const int row = order[index.row()];
+	
+	if(column.blank[row]) return QVariant();
+	if(column.numeric) return column.values[row];
+	return column.texts[row];
+}
+
+QVariant CatalogueModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if(orientation == Qt::Horizontal and role == Qt::DisplayRole and section >= 0 and section < columns.size())
+	{
+		const Column &column = columns[section];
+		QString headerText = column.name;
+		
+		if(not column.unit.isEmpty() and column.unit != "-")
+		{
+			headerText.append("\n(");
+			headerText.append(column.unit);
+			headerText.append(")");
+		}
+		
+		return headerText;
+	}
+	
+	return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags CatalogueModel::flags(const QModelIndex &index) const
+{
+	if(not index.isValid()) return Qt::NoItemFlags;
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+
+
+// ------------------------------- //
+// Function to sort rows by column //
+// ------------------------------- //
+
+bool CatalogueModel::lessThan(const Column &column, int row1, int row2) const
+{
+	if(column.numeric) return column.values[row1] < column.values[row2];
+	return column.texts[row1] < column.texts[row2];
+}
+
+void CatalogueModel::sort(int column, Qt::SortOrder sortOrder)
+{
+	// Only the row index is permuted; blank cells are moved to the end
+	// irrespective of the sort order.
+	if(column < 0 or column >= columns.size()) return;
+	
+	emit layoutAboutToBeChanged();
+	
+	// Remember source rows of persistent indices, e.g. of the selection
+	const QModelIndexList oldIndices = persistentIndexList();
+	QVector<int> oldRows(oldIndices.size());
+	for(int i = 0; i < oldIndices.size(); ++i) oldRows[i] = order[oldIndices[i].row()];
+	
+	const Column &sortColumn = columns[column];
+	const bool descending = (sortOrder == Qt::DescendingOrder);
+	int *first = order.data();
+	int *last  = first + rows;
+	
+	int *blank = std::stable_partition(first, last, [&sortColumn](int row) { return not sortColumn.blank[row]; });
+	std::stable_sort(first, blank, [this, &sortColumn, descending](int row1, int row2) { return descending ? lessThan(sortColumn, row2, row1) : lessThan(sortColumn, row1, row2); });
+	std::stable_sort(blank, last);
+	
+	// Update persistent indices
+	QVector<int> position(rows);
+	for(int i = 0; i < rows; ++i) position[order[i]] = i;
+	
+	QModelIndexList newIndices;
+	for(int i = 0; i < oldIndices.size(); ++i) newIndices.append(index(position[oldRows[i]], oldIndices[i].column()));
+	changePersistentIndexList(oldIndices, newIndices);
+	
+	emit layoutChanged();
+	
+	return;
+}
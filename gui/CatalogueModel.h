@@ -0,0 +1,102 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 1.2.1 (CatalogueModel.h) - Source Finding Application          ///
+/// Copyright (C) 2014-2018 Tobias Westmeier                             ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+
+
+#ifndef CATALOGUEMODEL_H
+#define CATALOGUEMODEL_H
+
+#include <QtGlobal>
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QVariant>
+#include <QtCore/QByteArray>
+#include <QtCore/QModelIndex>
+#include <QtCore/QAbstractTableModel>
+#include <QtCore/QXmlStreamReader>
+
+// Number of bytes read from the catalogue file at a time
+#define CATALOGUE_CHUNK_SIZE 65536
+
+// Table model holding a VOTable source catalogue column by column. Numeric
+// columns are stored as doubles and text columns as strings, and sorting
+// only permutes an index of rows, so that the view merely asks for the
+// cells currently visible.
+
+class CatalogueModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+public:
+	CatalogueModel(QObject *parent = 0);
+	
+	int  loadCatalog(const QString &filename);
+	void clear();
+	QString columnName(int column) const;
+	
+	int rowCount(const QModelIndex &parent = QModelIndex()) const;
+	int columnCount(const QModelIndex &parent = QModelIndex()) const;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+	Qt::ItemFlags flags(const QModelIndex &index) const;
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+private:
+	struct Column
+	{
+		QString name;
+		QString unit;
+		bool    numeric;
+		QVector<double>  values;
+		QVector<QString> texts;
+		QVector<bool>    blank;
+	};
+	
+	QVector<Column> columns;
+	QVector<int>    order;
+	int             rows;
+	
+	// State of parser while reading the catalogue
+	QXmlStreamReader reader;
+	int              cellColumn;
+	bool             inCell;
+	bool             inRow;
+	QString          cellText;
+	
+	bool parse();
+	void startRow();
+	void storeCell();
+	bool lessThan(const Column &column, int row1, int row2) const;
+};
+
+#endif
@@ -0,0 +1,317 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 1.2.1 (ChannelPrefetcher.cpp) - Source Finding Application     ///
+/// Copyright (C) 2014-2018 Tobias Westmeier                             ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "ChannelPrefetcher.h"
+
+
+
+// --------------------------- //
+// Comparison of channel views //
+// --------------------------- //
+
+bool ChannelView::operator==(const ChannelView &other) const
+{
+	return width == other.width and height == other.height and scale == other.scale and offsetX == other.offsetX and offsetY == other.offsetY and plotMin == other.plotMin and plotMax == other.plotMax and level == other.level and transferTable == other.transferTable;
+}
+
+bool ChannelView::operator!=(const ChannelView &other) const
+{
+	return not (*this == other);
+}
+
+
+
+// ---------------------------------------- //
+// FUNCTION to render channel into an image //
+// ---------------------------------------- //
+
+void renderChannel(QImage &image, const float *values, const size_t nx, const size_t ny, const ChannelView &view)
+{
+	// Writes the colour index of each pixel of the channel values as seen
+	// through view into image, which must be an 8-bit indexed image of
+	// view.width * view.height pixels. The values must be those of pyramid
+	// level view.level of a channel of nx * ny pixels, while the scale and
+	// offsets of view refer to the original channel. Areas outside of the
+	// data array are filled with a checkerboard pattern.
+	const double factor = static_cast<double>(static_cast<size_t>(1) << view.level);
+	const double scale   = view.scale * factor;
+	const double offsetX = view.offsetX / factor;
+	const double offsetY = view.offsetY / factor;
+	const size_t levelNx = (nx + (static_cast<size_t>(1) << view.level) - 1) >> view.level;
+	const size_t levelNy = (ny + (static_cast<size_t>(1) << view.level) - 1) >> view.level;
+	const double tableScale = static_cast<double>(view.transferTable.size()) / (view.plotMax - view.plotMin);
+	const size_t tableMax = view.transferTable.size() - 1;
+	
+	// Data column of each image column and range of image
+	// columns that fall onto the data array
+	std::vector<long> column(view.width);
+	int aFirst = view.width;
+	int aLast  = -1;
+	
+	for(int a = 0; a < view.width; ++a)
+	{
+		column[a] = floor(static_cast<double>(a) / scale - offsetX);
+		
+		if(column[a] >= 0 and column[a] < static_cast<long>(levelNx))
+		{
+			if(a < aFirst) aFirst = a;
+			aLast = a;
+		}
+	}
+	
+	long yPrev = -1;
+	
+	for(int b = 0; b < view.height; ++b)
+	{
+		uchar *line = image.scanLine(b);
+		long y = floor(static_cast<double>(view.height - b - 1) / scale - offsetY);
+		
+		if(y < 0 or y >= static_cast<long>(levelNy) or aLast < aFirst)
+		{
+			for(int a = 0; a < view.width; ++a) line[a] = ((a + b) % 2) * 30;
+			continue;
+		}
+		
+		for(int a = 0; a < aFirst; ++a) line[a] = ((a + b) % 2) * 30;
+		for(int a = aLast + 1; a < view.width; ++a) line[a] = ((a + b) % 2) * 30;
+		
+		// Consecutive image rows showing the same data row are copied
+		if(y == yPrev)
+		{
+			memcpy(line + aFirst, image.scanLine(b - 1) + aFirst, aLast - aFirst + 1);
+			continue;
+		}
+		yPrev = y;
+		
+		const float *dataRow = values + y * levelNx;
+		
+		for(int a = aFirst; a <= aLast; ++a)
+		{
+			const float value = dataRow[column[a]];
+			
+			if(std::isnan(value) or value < view.plotMin) line[a] = 0;
+			else if(value > view.plotMax) line[a] = 255;
+			else line[a] = view.transferTable[std::min(static_cast<size_t>((value - view.plotMin) * tableScale), tableMax)];
+		}
+	}
+	
+	return;
+}
+
+
+
+// ----------- //
+// Constructor //
+// ----------- //
+
+ChannelPrefetcher::ChannelPrefetcher(Fips *source, QObject *parent) : QThread(parent)
+{
+	// Dimensions are copied here, as Fips::plane() is the only
+	// member function of Fips that may be called from this thread.
+	fips = source;
+	nx = fips->dimension(1);
+	ny = fips->dimension() > 1 ? fips->dimension(2) : 1;
+	nz = fips->dimension() > 2 ? fips->dimension(3) : 1;
+	
+	view.width   = 0;
+	view.height  = 0;
+	view.scale   = 1.0;
+	view.offsetX = 0.0;
+	view.offsetY = 0.0;
+	view.plotMin = 0.0;
+	view.plotMax = 1.0;
+	view.level   = 0;
+	
+	generation = 0;
+	currentChannel = 0;
+	stopped = false;
+	
+	return;
+}
+
+
+
+// ---------------------------------------------- //
+// Set view; clears the cache if the view changed //
+// ---------------------------------------------- //
+
+void ChannelPrefetcher::setView(const ChannelView &newView)
+{
+	QMutexLocker locker(&mutex);
+	
+	if(newView != view)
+	{
+		view = newView;
+		++generation;
+		cache.clear();
+	}
+	
+	return;
+}
+
+
+
+// -------------------------- //
+// Look up and store channels //
+// -------------------------- //
+
+bool ChannelPrefetcher::find(size_t z, QImage &result)
+{
+	QMutexLocker locker(&mutex);
+	
+	QMap<size_t, QImage>::const_iterator it = cache.constFind(z);
+	if(it == cache.constEnd()) return false;
+	
+	result = it.value();
+	return true;
+}
+
+void ChannelPrefetcher::insert(size_t z, const QImage &channelImage)
+{
+	QMutexLocker locker(&mutex);
+	cache.insert(z, channelImage);
+	evict();
+	return;
+}
+
+
+
+// --------------------------------------------------- //
+// Queue channels following z in direction of movement //
+// --------------------------------------------------- //
+
+void ChannelPrefetcher::prefetch(size_t z, int direction)
+{
+	QMutexLocker locker(&mutex);
+	
+	currentChannel = z;
+	queue.clear();
+	
+	for(long i = 1; i <= PREFETCH_CHANNELS; ++i)
+	{
+		const long channel = static_cast<long>(z) + (direction < 0 ? -i : i);
+		if(channel < 0 or channel >= static_cast<long>(nz)) break;
+		if(not cache.contains(channel)) queue.append(channel);
+	}
+	
+	evict();
+	if(not queue.isEmpty()) condition.wakeOne();
+	
+	return;
+}
+
+
+
+// ----------------------------------------------- //
+// Drop channels farthest from the current channel //
+// ----------------------------------------------- //
+
+void ChannelPrefetcher::evict()
+{
+	// Must be called with mutex locked
+	while(cache.size() > PREFETCH_CACHE_SIZE)
+	{
+		const size_t first = cache.constBegin().key();
+		const size_t last  = (cache.constEnd() - 1).key();
+		
+		if(currentChannel - std::min(currentChannel, first) > std::max(currentChannel, last) - currentChannel) cache.remove(first);
+		else cache.remove(last);
+	}
+	
+	return;
+}
+
+
+
+// --------------------------- //
+// Stop thread as soon as idle //
+// --------------------------- //
+
+void ChannelPrefetcher::stop()
+{
+	QMutexLocker locker(&mutex);
+	stopped = true;
+	queue.clear();
+	condition.wakeAll();
+	return;
+}
+
+
+
+// ---------------- //
+// Thread main loop //
+// ---------------- //
+
+void ChannelPrefetcher::run()
+{
+	while(true)
+	{
+		mutex.lock();
+		while(not stopped and queue.isEmpty()) condition.wait(&mutex);
+		
+		if(stopped)
+		{
+			mutex.unlock();
+			return;
+		}
+		
+		const size_t z = queue.takeFirst();
+		
+		if(cache.contains(z))
+		{
+			mutex.unlock();
+			continue;
+		}
+		
+		const ChannelView channelView = view;
+		const unsigned long channelGeneration = generation;
+		mutex.unlock();
+		
+		// Decode and render without holding the lock
+		FipsPlane values = fips->plane(z, channelView.level);
+		if(not values) continue;
+		
+		QImage channelImage(channelView.width, channelView.height, QImage::Format_Indexed8);
+		renderChannel(channelImage, &(*values)[0], nx, ny, channelView);
+		
+		// Discard image if the view has changed in the meantime
+		mutex.lock();
+		if(channelGeneration == generation and not stopped)
+		{
+			cache.insert(z, channelImage);
+			evict();
+		}
+		mutex.unlock();
+	}
+}
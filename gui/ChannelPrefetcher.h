@@ -0,0 +1,115 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 1.2.1 (ChannelPrefetcher.h) - Source Finding Application       ///
+/// Copyright (C) 2014-2018 Tobias Westmeier                             ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#ifndef CHANNELPREFETCHER_H
+#define CHANNELPREFETCHER_H
+
+#include <QtGlobal>
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QMap>
+#include <QtCore/QList>
+#include <QtGui/QImage>
+
+#include <vector>
+#include "Fips.hpp"
+
+// Number of channels rendered ahead in the direction of navigation
+#define PREFETCH_CHANNELS   16
+
+// Maximum number of rendered channels kept in the cache
+#define PREFETCH_CACHE_SIZE 64
+
+
+
+// Settings determining the colour indices of a rendered channel; the
+// colour table itself is applied on display, so changing the look-up
+// table does not require channels to be rendered again. Channels are
+// read from the given level of the pyramid of downsampled planes.
+
+struct ChannelView
+{
+	int    width;
+	int    height;
+	double scale;
+	double offsetX;
+	double offsetY;
+	double plotMin;
+	double plotMax;
+	unsigned int level;
+	std::vector<unsigned char> transferTable;
+	
+	bool operator==(const ChannelView &other) const;
+	bool operator!=(const ChannelView &other) const;
+};
+
+void renderChannel(QImage &image, const float *values, const size_t nx, const size_t ny, const ChannelView &view);
+
+
+
+// Thread rendering channels ahead of the one currently displayed
+// into a cache of images that is cleared whenever the view changes
+
+class ChannelPrefetcher : public QThread
+{
+public:
+	ChannelPrefetcher(Fips *source, QObject *parent = 0);
+	
+	void setView(const ChannelView &newView);
+	bool find(size_t z, QImage &result);
+	void insert(size_t z, const QImage &channelImage);
+	void prefetch(size_t z, int direction);
+	void stop();
+
+protected:
+	void run();
+
+private:
+	Fips *fips;
+	size_t nx;
+	size_t ny;
+	size_t nz;
+	
+	ChannelView view;
+	unsigned long generation;
+	size_t currentChannel;
+	bool stopped;
+	
+	QMap<size_t, QImage> cache;
+	QList<size_t> queue;
+	QMutex mutex;
+	QWaitCondition condition;
+	
+	void evict();
+};
+
+#endif
@@ -39,6 +39,16 @@
 #include <cmath>
 #include <cstring>
 #include <cstdint>
+#include <algorithm>
+
+// Memory-mapping of the data unit requires POSIX
+#if defined(__unix__) or defined(__APPLE__)
+	#define FIPS_USE_MMAP
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
 
 
 
@@ -89,7 +99,7 @@ Fips::Fips(const std::string &url)
 
 Fips::~Fips()
 {
-	if(dataArray != 0) delete[] dataArray;
+	releaseData();
 	return;
 }
 
@@ -113,6 +123,37 @@ void Fips::initializeMembers()
 	
 	dataArray = 0;
 	dataSize  = 0;
+	size[0] = size[1] = size[2] = 0;
+	
+	mapAddress = 0;
+	mapSize    = 0;
+	planeCacheBytes = 0;
+	
+	return;
+}
+
+
+
+// ------------------ //
+// Release data array //
+// ------------------ //
+
+void Fips::releaseData()
+{
+	std::lock_guard<std::mutex> lock(planeCacheMutex);
+	planeCache.clear();
+	planeCacheBytes = 0;
+
+#ifdef FIPS_USE_MMAP
+	if(mapAddress != 0) munmap(mapAddress, mapSize);
+	else if(dataArray != 0) delete[] dataArray;
+#else
+	if(dataArray != 0) delete[] dataArray;
+#endif
+
+	dataArray  = 0;
+	mapAddress = 0;
+	mapSize    = 0;
 	
 	return;
 }
@@ -165,6 +206,9 @@ std::string Fips::unit()
 
 int Fips::readFile()
 {
+	releaseData();
+	naxis.clear();
+	
 	if(verbose) std::cout << "Attempting to read FITS file " << fileName << "\n";
 	std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
 	
@@ -173,6 +217,7 @@ int Fips::readFile()
 	{
 		char *headerUnit = 0;
 		bool endReached = false;
+		size_t headerSize = 0;
 		
 		// Ensure that EOF is not reached
 		while(not file.eof() and not endReached)
@@ -182,6 +227,8 @@ int Fips::readFile()
 			// Read header unit(s)
 			if(file.read(headerUnit, FITS_HEADER_UNIT_SIZE))
 			{
+				headerSize += FITS_HEADER_UNIT_SIZE;
+				
 				// Split header units into 80-byte lines
 				for(size_t i = 0; i < FITS_HEADER_UNIT_SIZE / FITS_HEADER_ENTRY_SIZE; ++i)
 				{
@@ -300,6 +347,40 @@ int Fips::readFile()
 			return 1;
 		}
 		
+		// Data are accessed as channels of size[0] * size[1] values; any axes beyond
+		// the third one are ignored.
+		size[0] = naxis[1];
+		size[1] = naxes > 1 ? naxis[2] : 1;
+		size[2] = naxes > 2 ? naxis[3] : 1;
+
+#ifdef FIPS_USE_MMAP
+		// Map data unit into memory, so data are only read from disc when needed
+		int fd = open(fileName.c_str(), O_RDONLY);
+		struct stat fileInfo;
+		
+		if(fd != -1 and fstat(fd, &fileInfo) == 0 and static_cast<size_t>(fileInfo.st_size) >= headerSize + dataSize)
+		{
+			void *address = mmap(0, headerSize + dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+			
+			if(address != MAP_FAILED)
+			{
+				mapAddress = static_cast<char *>(address);
+				mapSize    = headerSize + dataSize;
+				dataArray  = mapAddress + headerSize;
+			}
+		}
+		
+		if(fd != -1) close(fd);
+		
+		if(dataArray != 0)
+		{
+			file.close();
+			return 0;
+		}
+		
+		if(verbose) std::cout << "Memory-mapping failed; reading data unit into memory.\n";
+#endif
+
 		// Allocate memory for data
 		try
 		{
@@ -438,6 +519,278 @@ double Fips::data(size_t *pos)
 
 
 
+// ---------------------- //
+// Get row of data values //
+// ---------------------- //
+
+int Fips::row(float *buffer, size_t x, size_t y, size_t z, size_t n) const
+{
+	// Decode n consecutive values of row y in channel z, starting
+	// at position x, into buffer; returns 0 on success.
+	if(dataArray == 0 or n == 0) return 1;
+	
+	// Data are stored in column-major order as required by FITS standard
+	const size_t nx = size[0];
+	const size_t ny = size[1];
+	
+	if(x + n > nx or y >= ny or z >= size[2])
+	{
+		std::cerr << "Error: Data array index out of range.\n";
+		return 1;
+	}
+	
+	const int bytes = abs(bitpix / 8);
+	const char *src = &dataArray[((z * ny + y) * nx + x) * bytes];
+	const bool swap = littleEndian();
+	
+	// Decode all values of the same data type in one loop
+	// WARNING: These functions require fixed-width integer numbers from C++11
+	//          as well as the built-in byte-swap functions of GCC!
+	switch(bitpix)
+	{
+		case -64:
+			for(size_t i = 0; i < n; ++i)
+			{
+				uint64_t tmp;
+				double tmp2;
+				memcpy(&tmp, src + i * bytes, bytes);
+				if(swap) tmp = __builtin_bswap64(tmp);
+				memcpy(&tmp2, &tmp, bytes);
+				buffer[i] = static_cast<float>(tmp2);
+			}
+			break;
+		
+		case -32:
+			memcpy(buffer, src, n * bytes);
+			if(swap)
+			{
+				uint32_t *tmp = reinterpret_cast<uint32_t *>(buffer);
+				for(size_t i = 0; i < n; ++i) tmp[i] = __builtin_bswap32(tmp[i]);
+			}
+			break;
+		
+		case 8:
+			for(size_t i = 0; i < n; ++i) buffer[i] = static_cast<float>(static_cast<uint8_t>(src[i]));
+			break;
+		
+		case 16:
+			for(size_t i = 0; i < n; ++i)
+			{
+				int16_t tmp;
+				memcpy(&tmp, src + i * bytes, bytes);
+				if(swap) tmp = __builtin_bswap16(tmp);
+				buffer[i] = static_cast<float>(tmp);
+			}
+			break;
+		
+		case 32:
+			for(size_t i = 0; i < n; ++i)
+			{
+				int32_t tmp;
+				memcpy(&tmp, src + i * bytes, bytes);
+				if(swap) tmp = __builtin_bswap32(tmp);
+				buffer[i] = static_cast<float>(tmp);
+			}
+			break;
+		
+		case 64:
+			for(size_t i = 0; i < n; ++i)
+			{
+				int64_t tmp;
+				memcpy(&tmp, src + i * bytes, bytes);
+				if(swap) tmp = __builtin_bswap64(tmp);
+				buffer[i] = static_cast<float>(tmp);
+			}
+			break;
+		
+		default:
+			std::cerr << "Error: No native support for required data type on your system.\n";
+			return 1;
+	}
+	
+	// Lastly, correct for BSCALE and BZERO, if necessary
+	if(bzero != 0.0 or bscale != 1.0)
+	{
+		for(size_t i = 0; i < n; ++i) buffer[i] = static_cast<float>(bzero + bscale * static_cast<double>(buffer[i]));
+	}
+	
+	return 0;
+}
+
+
+
+// ----------------------------------------------- //
+// Get decoded channel or pyramid level from cache //
+// ----------------------------------------------- //
+
+FipsPlane Fips::plane(size_t z, unsigned int level)
+{
+	// Returns the decoded values of channel z, downsampled level times by
+	// a factor of 2, or a null pointer on error. Level 0 holds the size[0]
+	// * size[1] original values; each further level holds the mean of all
+	// non-blank values in 2 x 2 blocks of the previous one, with partial
+	// blocks at the upper edges, and is therefore levelDimension(1, level)
+	// * levelDimension(2, level) in size. Levels are built on first access
+	// from the level below and kept in a cache of limited size. This func-
+	// tion can be called from several threads at once; levels are decoded
+	// and downsampled outside of the lock.
+	if(dataArray == 0 or z >= size[2] or level > FIPS_MAX_LEVEL) return FipsPlane();
+	
+	const std::pair<size_t, unsigned int> key(z, level);
+	
+	{
+		std::lock_guard<std::mutex> lock(planeCacheMutex);
+		
+		for(std::list< std::pair<std::pair<size_t, unsigned int>, FipsPlane> >::iterator it = planeCache.begin(); it != planeCache.end(); ++it)
+		{
+			if(it->first == key)
+			{
+				planeCache.splice(planeCache.begin(), planeCache, it);
+				return planeCache.front().second;
+			}
+		}
+	}
+	
+	const size_t nx = levelDimension(1, level);
+	const size_t ny = levelDimension(2, level);
+	std::shared_ptr< std::vector<float> > values;
+	FipsPlane parent;
+	
+	// Level below is obtained first, so that it is cached as well
+	if(level > 0)
+	{
+		parent = plane(z, level - 1);
+		if(not parent) return FipsPlane();
+	}
+	
+	try
+	{
+		values = std::make_shared< std::vector<float> >(nx * ny);
+	}
+	catch(std::bad_alloc &e)
+	{
+		std::cerr << "Error: Memory allocation error: " << e.what() << ".\n";
+		return FipsPlane();
+	}
+	
+	if(level == 0)
+	{
+		for(size_t y = 0; y < ny; ++y)
+		{
+			if(row(&(*values)[y * nx], 0, y, z, nx)) return FipsPlane();
+		}
+	}
+	else
+	{
+		const size_t px = levelDimension(1, level - 1);
+		const size_t py = levelDimension(2, level - 1);
+		
+		for(size_t y = 0; y < ny; ++y)
+		{
+			const float *src0 = &(*parent)[2 * y * px];
+			const float *src1 = 2 * y + 1 < py ? src0 + px : 0;
+			float *dst = &(*values)[y * nx];
+			
+			for(size_t x = 0; x < nx; ++x)
+			{
+				const size_t x0 = 2 * x;
+				const size_t x1 = x0 + 1 < px ? x0 + 1 : x0;
+				float sum = 0.0;
+				int count = 0;
+				
+				if(not std::isnan(src0[x0])) { sum += src0[x0]; ++count; }
+				if(x1 != x0 and not std::isnan(src0[x1])) { sum += src0[x1]; ++count; }
+				if(src1 != 0)
+				{
+					if(not std::isnan(src1[x0])) { sum += src1[x0]; ++count; }
+					if(x1 != x0 and not std::isnan(src1[x1])) { sum += src1[x1]; ++count; }
+				}
+				
+				dst[x] = count ? sum / static_cast<float>(count) : std::numeric_limits<float>::quiet_NaN();
+			}
+		}
+	}
+	
+	// Drop least recently used levels; the cache only holds references,
+	// so levels still in use elsewhere remain valid.
+	std::lock_guard<std::mutex> lock(planeCacheMutex);
+	
+	// Another thread may have built the same level in the meantime
+	for(std::list< std::pair<std::pair<size_t, unsigned int>, FipsPlane> >::iterator it = planeCache.begin(); it != planeCache.end(); ++it)
+	{
+		if(it->first == key) return it->second;
+	}
+	
+	const size_t bytes = values->size() * sizeof(float);
+	
+	while(not planeCache.empty() and planeCacheBytes + bytes > FIPS_PLANE_CACHE_SIZE)
+	{
+		planeCacheBytes -= planeCache.back().second->size() * sizeof(float);
+		planeCache.pop_back();
+	}
+	
+	planeCache.push_front(std::make_pair(key, FipsPlane(values)));
+	planeCacheBytes += bytes;
+	
+	return planeCache.front().second;
+}
+
+
+
+// ---------------------------------------- //
+// Get size of downsampled level along axis //
+// ---------------------------------------- //
+
+size_t Fips::levelDimension(const size_t axis, const unsigned int level) const
+{
+	// Size of plane(z, level) along axis 1 or 2; 0 for any other axis
+	if(axis < 1 or axis > 2 or level > FIPS_MAX_LEVEL) return 0;
+	return (size[axis - 1] + (static_cast<size_t>(1) << level) - 1) >> level;
+}
+
+
+
+// ------------------------------------- //
+// Determine minimum and maximum of data //
+// ------------------------------------- //
+
+int Fips::range(double &minimum, double &maximum, const std::atomic<bool> *cancel) const
+{
+	// Scans the entire data array row by row without touching the channel
+	// cache, so this can be run in a separate thread; returns 0 on success,
+	// 1 on error or if cancelled via cancel, or if all values are NaN.
+	if(dataArray == 0) return 1;
+	
+	std::vector<float> buffer(size[0]);
+	float valueMin =  std::numeric_limits<float>::infinity();
+	float valueMax = -std::numeric_limits<float>::infinity();
+	
+	for(size_t z = 0; z < size[2]; ++z)
+	{
+		for(size_t y = 0; y < size[1]; ++y)
+		{
+			if(cancel != 0 and cancel->load()) return 1;
+			if(row(&buffer[0], 0, y, z, size[0])) return 1;
+			
+			for(size_t x = 0; x < size[0]; ++x)
+			{
+				// Comparisons are false for NaN
+				if(buffer[x] < valueMin) valueMin = buffer[x];
+				if(buffer[x] > valueMax) valueMax = buffer[x];
+			}
+		}
+	}
+	
+	if(valueMin > valueMax) return 1;
+	
+	minimum = valueMin;
+	maximum = valueMax;
+	
+	return 0;
+}
+
+
+
 // ---------------- //
 // Trim std::string //
 // ---------------- //
@@ -33,13 +33,28 @@
 #define FITS_PROCESSING_SOFTWARE_H
 
 #include <map>
+#include <list>
+#include <vector>
 #include <string>
 #include <limits>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 #define FITS_HEADER_UNIT_SIZE  2880
 #define FITS_HEADER_ENTRY_SIZE   80
 #define FITS_HEADER_KEY_SIZE      8
 
+// Maximum memory used for caching decoded channels and their down-
+// sampled levels (in bytes); the most recently used one is always kept.
+#define FIPS_PLANE_CACHE_SIZE 268435456
+
+// Maximum number of times a channel can be downsampled by a factor of 2
+#define FIPS_MAX_LEVEL 16
+
+// Decoded channel, shared between cache and users
+typedef std::shared_ptr< const std::vector<float> > FipsPlane;
+
 class Fips
 {
 public:
@@ -55,15 +70,20 @@ public:
 	double minimum();
 	double maximum();
 	double data(size_t *pos);
+	int row(float *buffer, size_t x, size_t y, size_t z, size_t n) const;
+	FipsPlane plane(size_t z, unsigned int level = 0);
+	size_t levelDimension(const size_t axis, const unsigned int level) const;
+	int range(double &minimum, double &maximum, const std::atomic<bool> *cancel = 0) const;
 	std::string unit();
 
 private:
 	// Member functions
 	void initializeMembers();
+	void releaseData();
 	
 	// Helper functions
 	void trimString(std::string &s);
-	bool littleEndian();
+	static bool littleEndian();
 	
 	// Data members
 	std::string  fileName;
@@ -78,6 +98,16 @@ private:
 	std::string  bunit;
 	char        *dataArray;
 	size_t       dataSize;
+	size_t       size[3];
+	
+	// Memory map of file, if data are not read into memory
+	char        *mapAddress;
+	size_t       mapSize;
+	
+	// Decoded channels and levels, most recently used first
+	std::list< std::pair<std::pair<size_t, unsigned int>, FipsPlane> > planeCache;
+	size_t planeCacheBytes;
+	std::mutex planeCacheMutex;
 };
 
 #endif
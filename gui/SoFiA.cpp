@@ -114,6 +114,16 @@ SoFiA::SoFiA(int argc, char *argv[])
 	connect(pipelineProcess, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(pipelineProcessFinished(int, QProcess::ExitStatus)));
 	connect(pipelineProcess, SIGNAL(error(QProcess::ProcessError)), this, SLOT(pipelineProcessError(QProcess::ProcessError)));
 	
+	// Pipeline messages are collected and displayed at regular intervals,
+	// while the complete log is written to a temporary file:
+	logTimer = new QTimer(this);
+	logTimer->setSingleShot(true);
+	logTimer->setInterval(LOG_UPDATE_INTERVAL);
+	connect(logTimer, SIGNAL(timeout()), this, SLOT(flushLog()));
+	
+	logFile = new QTemporaryFile(QDir::tempPath() + "/" + LOG_FILE_TEMPLATE, this);
+	if(not logFile->open()) std::cerr << "Warning: Failed to create log file; only the most recent pipeline messages can be saved.\n";
+	
 	// Create user interface:
 	this->createInterface();
 	this->setDefaults();
@@ -739,8 +749,21 @@ void SoFiA::saveLogAs()
 	
 	if(file.open(QIODevice::WriteOnly))
 	{
-		QTextStream stream(&file);
-		stream << outputText->toPlainText();
+		flushLog();
+		
+		if(logFile->isOpen())
+		{
+			// Copy complete log, as older messages may no longer be displayed:
+			logFile->flush();
+			logFile->seek(0);
+			while(not logFile->atEnd()) file.write(logFile->read(65536));
+			logFile->seek(logFile->size());
+		}
+		else
+		{
+			QTextStream stream(&file);
+			stream << outputText->toPlainText();
+		}
 		
 		file.close();
 		
@@ -766,7 +789,15 @@ void SoFiA::saveLogAs()
 
 void SoFiA::clearLog()
 {
+	logPending.clear();
 	outputText->clear();
+	
+	if(logFile->isOpen())
+	{
+		logFile->resize(0);
+		logFile->seek(0);
+	}
+	
 	outputProgress->setValue(0);
 	
 	QString messageText = tr("");
@@ -926,8 +957,8 @@ void SoFiA::updateActions()
 	actionAbort->setEnabled(pipelineProcess->state() == QProcess::Running);
 	actionExit->setEnabled(pipelineProcess->state() == QProcess::NotRunning);
 	
-	actionSaveLogAs->setEnabled(outputText->toPlainText() != "" and pipelineProcess->state() == QProcess::NotRunning);
-	actionClearLog->setEnabled(outputText->toPlainText() != "" and pipelineProcess->state() == QProcess::NotRunning);
+	actionSaveLogAs->setEnabled(not outputText->document()->isEmpty() and pipelineProcess->state() == QProcess::NotRunning);
+	actionClearLog->setEnabled(not outputText->document()->isEmpty() and pipelineProcess->state() == QProcess::NotRunning);
 	
 	actionShowCatalogue->setEnabled(not (tabInputFieldData->text()).isEmpty());
 	
@@ -1245,13 +1276,7 @@ void SoFiA::pipelineProcessReadStd()
 	outputStd.remove(QChar('\r'));       // Get rid of carriage returns in the output
 	outputStd.remove(QRegExp("\x1B\[[0-?]*[ -/]*[@-~]"));  // Get rid of ANSI escape sequences
 	
-	if(not outputStd.isEmpty())
-	{
-		outputText->moveCursor(QTextCursor::End);
-		outputText->setTextColor(Qt::black);
-		outputText->insertPlainText(outputStd);
-		outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
-	}
+	if(not outputStd.isEmpty()) appendLog(outputStd, Qt::black);
 	
 	return;
 }
@@ -1270,14 +1295,54 @@ void SoFiA::pipelineProcessReadErr()
 	outputErr.remove(QChar('\r'));                         // Get rid of carriage returns in the output
 	outputErr.remove(QRegExp("\x1B\[[0-?]*[ -/]*[@-~]"));  // Get rid of ANSI escape sequences
 	
-	if(not outputErr.isEmpty())
+	if(not outputErr.isEmpty()) appendLog(outputErr, Qt::red);
+	
+	return;
+}
+
+
+
+// ------------------------------------------
+// Function to append message to pipeline log
+// ------------------------------------------
+
+void SoFiA::appendLog(const QString &text, const QColor &colour, bool immediately)
+{
+	// Messages are written to the log file straight away, but only shown
+	// once the timer expires, so that frequent small messages from the
+	// pipeline are combined into a single update of the display.
+	if(logFile->isOpen()) logFile->write(text.toUtf8());
+	
+	if(not logPending.isEmpty() and logPending.last().first == colour) logPending.last().second.append(text);
+	else logPending.append(qMakePair(colour, text));
+	
+	if(immediately) flushLog();
+	else if(not logTimer->isActive()) logTimer->start();
+	
+	return;
+}
+
+
+
+// ------------------------------------
+// Slot to display pending log messages
+// ------------------------------------
+
+void SoFiA::flushLog()
+{
+	logTimer->stop();
+	if(logPending.isEmpty()) return;
+	
+	for(int i = 0; i < logPending.size(); ++i)
 	{
 		outputText->moveCursor(QTextCursor::End);
-		outputText->setTextColor(Qt::red);
-		outputText->insertPlainText(outputErr);
-		outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+		outputText->setTextColor(logPending[i].first);
+		outputText->insertPlainText(logPending[i].second);
 	}
 	
+	logPending.clear();
+	outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+	
 	return;
 }
 
@@ -1317,9 +1382,7 @@ void SoFiA::pipelineProcessFinished(int exitCode, QProcess::ExitStatus exitStatu
 			QString statusText = tr("Pipeline finished.");
 			showMessage(MESSAGE_INFO, messageText, statusText);
 			
-			outputText->setTextColor(Qt::darkGreen);
-			outputText->insertPlainText(QString("Pipeline finished with exit code %1.\n").arg(exitCode));
-			outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+			appendLog(QString("Pipeline finished with exit code %1.\n").arg(exitCode), Qt::darkGreen, true);
 			
 			outputProgress->setValue(100);
 			
@@ -1334,9 +1397,7 @@ void SoFiA::pipelineProcessFinished(int exitCode, QProcess::ExitStatus exitStatu
 			
 			outputProgress->setValue(0);
 			
-			outputText->setTextColor(Qt::red);
-			outputText->insertPlainText(QString("Pipeline failed with exit code %1.\n").arg(exitCode));
-			outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+			appendLog(QString("Pipeline failed with exit code %1.\n").arg(exitCode), Qt::red, true);
 		}
 	}
 	else
@@ -1348,9 +1409,7 @@ void SoFiA::pipelineProcessFinished(int exitCode, QProcess::ExitStatus exitStatu
 		
 		outputProgress->setValue(0);
 		
-		outputText->setTextColor(Qt::red);
-		outputText->insertPlainText(QString("Pipeline aborted with exit code %1.\n").arg(exitCode));
-		outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+		appendLog(QString("Pipeline aborted with exit code %1.\n").arg(exitCode), Qt::red, true);
 	}
 	
 	outputProgress->setMaximum(100);
@@ -1402,9 +1461,7 @@ void SoFiA::pipelineProcessError(QProcess::ProcessError error)
 	switch(error)
 	{
 		case QProcess::FailedToStart:
-			outputText->setTextColor(Qt::red);
-			outputText->insertPlainText(QString("Error: Failed to launch pipeline.\n"));
-			outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+			appendLog(QString("Error: Failed to launch pipeline.\n"), Qt::red, true);
 			
 			messageText = tr("<p>Failed to launch pipeline.</p><p>Please ensure that the pipeline is installed on your computer and you have permission to execute it.</p>");
 			statusText = tr("Failed to launch pipeline.");
@@ -1412,33 +1469,23 @@ void SoFiA::pipelineProcessError(QProcess::ProcessError error)
 			break;
 			
 		case QProcess::Crashed:
-			outputText->setTextColor(Qt::red);
-			outputText->insertPlainText(QString("Error: Pipeline terminated prematurely.\n"));
-			outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+			appendLog(QString("Error: Pipeline terminated prematurely.\n"), Qt::red, true);
 			break;
 			
 		case QProcess::Timedout:
-			outputText->setTextColor(Qt::red);
-			outputText->insertPlainText(QString("Error: Pipeline timed out.\n"));
-			outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+			appendLog(QString("Error: Pipeline timed out.\n"), Qt::red, true);
 			break;
 			
 		case QProcess::WriteError:
-			outputText->setTextColor(Qt::red);
-			outputText->insertPlainText(QString("Error: Pipeline failed to receive input.\n"));
-			outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+			appendLog(QString("Error: Pipeline failed to receive input.\n"), Qt::red, true);
 			break;
 			
 		case QProcess::ReadError:
-			outputText->setTextColor(Qt::red);
-			outputText->insertPlainText(QString("Error: Failed to receive output from pipeline.\n"));
-			outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+			appendLog(QString("Error: Failed to receive output from pipeline.\n"), Qt::red, true);
 			break;
 			
 		default:
-			outputText->setTextColor(Qt::red);
-			outputText->insertPlainText(QString("Error: An unspecified error occurred.\n"));
-			outputText->verticalScrollBar()->setValue(outputText->verticalScrollBar()->maximum());
+			appendLog(QString("Error: An unspecified error occurred.\n"), Qt::red, true);
 	}
 	
 	return;
@@ -3028,6 +3075,8 @@ void SoFiA::createInterface()
 	outputText->setWhatsThis(tr("<h3>Pipeline Messages</h3><p>Any output messages and progress information produced by the SoFiA pipeline will be displayed here.</p>"));
 	outputText->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Expanding);
 	outputText->setReadOnly(true);
+	outputText->setUndoRedoEnabled(false);                                        // Undo history would grow with every message
+	outputText->document()->setMaximumBlockCount(LOG_MAX_LINES);                  // Oldest lines are discarded beyond this
 	outputText->setLineWrapMode(QTextEdit::FixedColumnWidth);
 	outputText->setLineWrapColumnOrWidth(80);
 	outputText->setTabStopWidth(8 * outputText->fontMetrics().width("0"));     // setTabStopWidth() expects pixels!!!
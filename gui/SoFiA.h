@@ -55,6 +55,10 @@
 #define KERNEL_SCALE_FACTOR 100.0
 #define RELMIN_SCALE_FACTOR 100.0
 
+#define LOG_UPDATE_INTERVAL 100      // Interval in ms at which pipeline messages are displayed
+#define LOG_MAX_LINES       10000    // Number of lines of pipeline messages retained on screen
+#define LOG_FILE_TEMPLATE   "SoFiA_log_XXXXXX.txt"
+
 #include <iostream>
 #include <ctime>
 
@@ -69,6 +73,9 @@
 #include <QtCore/QMimeData>
 #include <QtCore/QVariant>
 #include <QtCore/QRegExp>
+#include <QtCore/QTimer>
+#include <QtCore/QPair>
+#include <QtCore/QTemporaryFile>
 
 #include <QtGui/QCloseEvent>
 #include <QtGui/QDropEvent>
@@ -169,6 +176,7 @@ private slots:
 	void pipelineProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
 	void pipelineProcessCancel();
 	void pipelineProcessError(QProcess::ProcessError error);
+	void flushLog();
 	void showCatalogue();
 	void showCube();
 	void showFilteredCube();
@@ -199,6 +207,10 @@ private:
 	
 	QProcess   *pipelineProcess;
 	
+	QTimer         *logTimer;
+	QTemporaryFile *logFile;
+	QList< QPair<QColor, QString> > logPending;
+	
 	WidgetSpreadsheet *spreadsheet;
 	
 	int  selectFile(QLineEdit *target, bool isDirectory = false);
@@ -212,6 +224,7 @@ private:
 	void createInterface();
 	void createWhatsThis();
 	void updateActions();
+	void appendLog(const QString &text, const QColor &colour, bool immediately = false);
 	void updateWindowTitle();
 	QString extractFileName(QString &extension);
 	
@@ -6,7 +6,6 @@ TEMPLATE = app
 TARGET = SoFiA
 DEPENDPATH += .
 INCLUDEPATH += .
-QT += xml
 LIBS += -lz
 QMAKE_CXXFLAGS += -std=c++11 # for Qt 4
 
@@ -19,15 +18,19 @@ greaterThan(QT_MAJOR_VERSION, 4)
 
 # Input
 HEADERS   += HelpBrowser.h \
-             TableWidget.h \
+             TableView.h \
+             CatalogueModel.h \
              WidgetSpreadsheet.h \
              Fips.hpp \
+             ChannelPrefetcher.h \
              WidgetDataViewer.h \
              SoFiA.h
 SOURCES   += HelpBrowser.cpp \
-             TableWidget.cpp \
+             TableView.cpp \
+             CatalogueModel.cpp \
              WidgetSpreadsheet.cpp \
              Fips.cpp \
+             ChannelPrefetcher.cpp \
              WidgetDataViewer.cpp \
              SoFiA.cpp \
              main.cpp
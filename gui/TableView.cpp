@@ -1,6 +1,6 @@
 /// ____________________________________________________________________ ///
 ///                                                                      ///
-/// SoFiA 1.2.1 (TableWidget.cpp) - Source Finding Application           ///
+/// SoFiA 1.2.1 (TableView.cpp) - Source Finding Application             ///
 /// Copyright (C) 2014-2018 Tobias Westmeier                             ///
 /// ____________________________________________________________________ ///
 ///                                                                      ///
@@ -29,13 +29,13 @@
 /// ____________________________________________________________________ ///
 ///                                                                      ///
 
-#include "TableWidget.h"
+#include "TableView.h"
 
 // ----------- //
 // Constructor //
 // ----------- //
 
-TableWidget::TableWidget(QWidget *parent)
+TableView::TableView(QWidget *parent)
 {
 	this->setParent(parent);
 	
@@ -71,8 +71,21 @@ TableWidget::TableWidget(QWidget *parent)
 	actionClearSelection->setIcon(iconClearSelection);
 	connect(actionClearSelection, SIGNAL(triggered()), this, SLOT(selectNothing()));
 	
+	return;
+}
+
+
+
+// --------------------------------------------- //
+// Function to set model and track its selection //
+// --------------------------------------------- //
+
+void TableView::setModel(QAbstractItemModel *model)
+{
+	QTableView::setModel(model);
+	
 	// React to change in item selection:
-	connect(this, SIGNAL(itemSelectionChanged()), this, SLOT(updateActions()));
+	connect(this->selectionModel(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)), this, SLOT(updateActions()));
 	
 	return;
 }
@@ -83,26 +96,27 @@ TableWidget::TableWidget(QWidget *parent)
 // Slot to copy selected cells to clipboard //
 // ---------------------------------------- //
 
-void TableWidget::copy()
+void TableView::copy()
 {
-	// Get a list of all selected ranges:
-	QList<QTableWidgetSelectionRange> selectedRanges = this->selectedRanges();
-	if(selectedRanges.isEmpty()) return;
+	// Get a list of all selected cells:
+	if(this->model() == 0) return;
+	QModelIndexList selectedIndexes = this->selectionModel()->selectedIndexes();
+	if(selectedIndexes.isEmpty()) return;
 	
 	// Establish the outer boundary of all selections:
-	int leftColumn  = this->columnCount() - 1;
+	int leftColumn  = this->model()->columnCount() - 1;
 	int rightColumn = 0;
-	int topRow      = this->rowCount() - 1;
+	int topRow      = this->model()->rowCount() - 1;
 	int bottomRow   = 0;
 	
-	for(int i = 0; i < selectedRanges.size(); i++)
+	for(int i = 0; i < selectedIndexes.size(); i++)
 	{
-		QTableWidgetSelectionRange range = selectedRanges.at(i);
+		const QModelIndex &index = selectedIndexes.at(i);
 		
-		if(range.leftColumn()  < leftColumn)  leftColumn  = range.leftColumn();
-		if(range.rightColumn() > rightColumn) rightColumn = range.rightColumn();
-		if(range.topRow()      < topRow)      topRow      = range.topRow();
-		if(range.bottomRow()   > bottomRow)   bottomRow   = range.bottomRow();
+		if(index.column() < leftColumn)  leftColumn  = index.column();
+		if(index.column() > rightColumn) rightColumn = index.column();
+		if(index.row()    < topRow)      topRow      = index.row();
+		if(index.row()    > bottomRow)   bottomRow   = index.row();
 	}
 	
 	if(bottomRow < topRow or rightColumn < leftColumn) return;
@@ -114,9 +128,11 @@ void TableWidget::copy()
 	{
 		for(int j = leftColumn; j <= rightColumn; j++)
 		{
-			if(this->item(i, j)->isSelected())
+			QModelIndex index = this->model()->index(i, j);
+			
+			if(this->selectionModel()->isSelected(index))
 			{
-				outputText += this->item(i, j)->text();
+				outputText += index.data(Qt::DisplayRole).toString();
 			}
 			
 			if (j < rightColumn) outputText += "\t";
@@ -137,7 +153,7 @@ void TableWidget::copy()
 // Slot to select all cells //
 // ------------------------ //
 
-void TableWidget::selectEverything()
+void TableView::selectEverything()
 {
 	this->selectAll();
 	
@@ -150,7 +166,7 @@ void TableWidget::selectEverything()
 // Slot to deselect all cells //
 // -------------------------- //
 
-void TableWidget::selectNothing()
+void TableView::selectNothing()
 {
 	this->selectionModel()->clearSelection();
 	
@@ -163,12 +179,12 @@ void TableWidget::selectNothing()
 // Slot to update actions and buttons //
 // ---------------------------------- //
 
-void TableWidget::updateActions()
+void TableView::updateActions()
 {
-	QList<QTableWidgetSelectionRange> selectedRanges = this->selectedRanges();
+	const bool selected = this->selectionModel() != 0 and this->selectionModel()->hasSelection();
 	
-	actionCopy->setEnabled(not selectedRanges.isEmpty());
-	actionClearSelection->setEnabled(not selectedRanges.isEmpty());
+	actionCopy->setEnabled(selected);
+	actionClearSelection->setEnabled(selected);
 	
 	return;
 }
@@ -179,7 +195,7 @@ void TableWidget::updateActions()
 // Function to create context menu when right-clicking //
 // --------------------------------------------------- //
 
-void TableWidget::contextMenuEvent(QContextMenuEvent *event)
+void TableView::contextMenuEvent(QContextMenuEvent *event)
 {
 	QMenu menuContext(this);
 	
@@ -195,16 +211,16 @@ void TableWidget::contextMenuEvent(QContextMenuEvent *event)
 
 
 
-// ------------------------------------------------------------ //
-// Function to override default key press event of QTableWidget //
-// ------------------------------------------------------------ //
+// ---------------------------------------------------------- //
+// Function to override default key press event of QTableView //
+// ---------------------------------------------------------- //
 
-void TableWidget::keyPressEvent(QKeyEvent *event)
+void TableView::keyPressEvent(QKeyEvent *event)
 {
 	if(event->matches(QKeySequence::Copy)) this->copy();
 	if(event->matches(QKeySequence::SelectAll)) this->selectEverything();
 	else if(event->key() == Qt::Key_Escape) this->selectNothing();
-	else QTableWidget::keyPressEvent(event);
+	else QTableView::keyPressEvent(event);
 	
 	return;
 }
@@ -1,6 +1,6 @@
 /// ____________________________________________________________________ ///
 ///                                                                      ///
-/// SoFiA 1.2.1 (TableWidget.h) - Source Finding Application             ///
+/// SoFiA 1.2.1 (TableView.h) - Source Finding Application               ///
 /// Copyright (C) 2014-2018 Tobias Westmeier                             ///
 /// ____________________________________________________________________ ///
 ///                                                                      ///
@@ -29,14 +29,16 @@
 /// ____________________________________________________________________ ///
 ///                                                                      ///
 
-#ifndef TABLEWIDGET_H
-#define TABLEWIDGET_H
+#ifndef TABLEVIEW_H
+#define TABLEVIEW_H
 
 #include <QtGlobal>
 
 #include <QtCore/QString>
 #include <QtCore/QList>
 #include <QtCore/QDebug>
+#include <QtCore/QModelIndex>
+#include <QtCore/QAbstractItemModel>
 
 #include <QtGui/QClipboard>
 #include <QtGui/QContextMenuEvent>
@@ -48,21 +50,22 @@
 	#include <QtGui/QAction>
 	#include <QtGui/QMenu>
 	#include <QtGui/QWidget>
-	#include <QtGui/QTableWidget>
+	#include <QtGui/QTableView>
 #else
 	#include <QtWidgets/QApplication>
 	#include <QtWidgets/QAction>
 	#include <QtWidgets/QMenu>
 	#include <QtWidgets/QWidget>
-	#include <QtWidgets/QTableWidget>
+	#include <QtWidgets/QTableView>
 #endif
 
-class TableWidget : public QTableWidget
+class TableView : public QTableView
 {
 	Q_OBJECT
 	
 public:
-	TableWidget(QWidget *parent = 0);
+	TableView(QWidget *parent = 0);
+	void setModel(QAbstractItemModel *model);
 	
 private slots:
 	void copy();
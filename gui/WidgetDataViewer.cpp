@@ -35,8 +35,37 @@
 #include <limits>
 #include <cstdlib>
 #include <ctime>
+#include <cstring>
 #include "WidgetDataViewer.h"
 
+// ------------------------------ //
+// Thread to determine data range //
+// ------------------------------ //
+
+DataRangeThread::DataRangeThread(Fips *source, QObject *parent) : QThread(parent)
+{
+	fips = source;
+	success = false;
+	minimum = 0.0;
+	maximum = 1.0;
+	cancelled.store(false);
+	return;
+}
+
+void DataRangeThread::cancel()
+{
+	cancelled.store(true);
+	return;
+}
+
+void DataRangeThread::run()
+{
+	success = not fips->range(minimum, maximum, &cancelled);
+	return;
+}
+
+
+
 // ----------- //
 // CONSTRUCTOR //
 // ----------- //
@@ -63,6 +92,10 @@ WidgetDataViewer::WidgetDataViewer(const std::string &url, QWidget *parent) : QW
 	currentLut = RAINBOW;
 	transferFunction = LINEAR;
 	currentChannel = 0;
+	provisionalLevels = false;
+	rangeThread = 0;
+	prefetcher = 0;
+	lastChannel = 0;
 	
 	setUpInterface();
 	fieldChannel->setText(QString::number(currentChannel));
@@ -90,6 +123,20 @@ WidgetDataViewer::WidgetDataViewer(const std::string &url, QWidget *parent) : QW
 
 WidgetDataViewer::~WidgetDataViewer()
 {
+	// Stop scan of data range before data are released
+	if(rangeThread != 0)
+	{
+		rangeThread->cancel();
+		rangeThread->wait();
+	}
+	
+	// Stop prefetching of channels
+	if(prefetcher != 0)
+	{
+		prefetcher->stop();
+		prefetcher->wait();
+	}
+	
 	delete fips;
 	return;
 }
@@ -108,6 +155,9 @@ int WidgetDataViewer::openFitsFile(const std::string &url)
 		return 1;
 	}
 	
+	prefetcher = new ChannelPrefetcher(fips, this);
+	prefetcher->start(QThread::LowPriority);
+	
 	// Redefine settings
 	zoomToFit();
 	
@@ -115,33 +165,36 @@ int WidgetDataViewer::openFitsFile(const std::string &url)
 	{
 		std::cerr << "Warning: DATAMIN or DATAMAX undefined; extracting values from data.\n";
 		
+		// Scanning the entire cube can take a long time, so the range of the
+		// current channel is used until the scan in the background is done.
 		dataMin =  std::numeric_limits<double>::max();
 		dataMax = -std::numeric_limits<double>::max();
 		
-		for(size_t z = 0; z < (fips->dimension() > 2 ? fips->dimension(3) : 1); ++z)
+		FipsPlane values = fips->plane(currentChannel);
+		
+		if(values)
 		{
-			for(size_t y = 0; y < fips->dimension(2); ++y)
+			for(size_t i = 0; i < values->size(); ++i)
 			{
-				for(size_t x = 0; x < fips->dimension(1); ++x)
+				if(not std::isnan((*values)[i]))
 				{
-					size_t pos[3] = {x, y, z};
-					double value = fips->data(pos);
-					
-					if(not std::isnan(value))
-					{
-						if(value < dataMin) dataMin = value;
-						if(value > dataMax) dataMax = value;
-					}
+					if((*values)[i] < dataMin) dataMin = (*values)[i];
+					if((*values)[i] > dataMax) dataMax = (*values)[i];
 				}
 			}
 		}
 		
 		if(dataMin >= dataMax)
 		{
-			std::cerr << "Warning: DATAMIN not greater than DATAMAX; using default values.\n";
 			dataMin = 0.0;
 			dataMax = 1.0;
 		}
+		
+		provisionalLevels = true;
+		status->setText("Determining data range...");
+		rangeThread = new DataRangeThread(fips, this);
+		connect(rangeThread, SIGNAL(finished()), this, SLOT(dataRangeFound()));
+		rangeThread->start(QThread::LowPriority);
 	}
 	else
 	{
@@ -168,33 +221,54 @@ int WidgetDataViewer::openFitsFile(const std::string &url)
 
 int WidgetDataViewer::plotChannelMap(size_t z)
 {
-	if(not fips->dimension()) return 1;
+	if(not fips->dimension() or prefetcher == 0) return 1;
 	
 	if(fips->dimension() < 3) z = 0;
 	else if(z >= fips->dimension(3)) z = fips->dimension(3) - 1;
 	
-	for(size_t b = 0; b < VIEWPORT_HEIGHT; ++b)
+	// Rendered channels only hold colour indices without reversion, so that
+	// changing the colour table does not require them to be rendered again.
+	setUpTransferTable();
+	
+	ChannelView view;
+	view.width   = VIEWPORT_WIDTH;
+	view.height  = VIEWPORT_HEIGHT;
+	view.scale   = scale;
+	view.offsetX = offsetX;
+	view.offsetY = offsetY;
+	view.plotMin = plotMin;
+	view.plotMax = plotMax;
+	view.level   = 0;
+	view.transferTable = transferTable;
+	
+	// When zoomed out, channels are read from the level of the pyramid of
+	// downsampled planes with at least one data pixel per viewport pixel.
+	while(view.level < FIPS_MAX_LEVEL and scale * static_cast<double>(static_cast<size_t>(2) << view.level) <= 1.0) ++view.level;
+	
+	prefetcher->setView(view);
+	
+	QImage channelImage;
+	
+	if(not prefetcher->find(z, channelImage))
 	{
-		for(size_t a = 0; a < VIEWPORT_WIDTH; ++a)
-		{
-			long x = floor(static_cast<double>(a) / scale - offsetX);
-			long y = floor(static_cast<double>(VIEWPORT_HEIGHT - b - 1) / scale - offsetY);
-			
-			if(x >= 0 and static_cast<size_t>(x) < fips->dimension(1) and y >= 0 and static_cast<size_t>(y) < fips->dimension(2))
-			{
-				size_t position[3] = {static_cast<size_t>(x), static_cast<size_t>(y), z};
-				double value = fips->data(position);
-				unsigned int index = flux2grey(value);
-				
-				image->setPixel(a, b, index xor revert);
-			}
-			else
-			{
-				image->setPixel(a, b, (((a + b) % 2) * 30) xor revert);
-			}
-		}
+		FipsPlane values = fips->plane(z, view.level);
+		if(not values) return 1;
+		
+		channelImage = QImage(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, QImage::Format_Indexed8);
+		renderChannel(channelImage, &(*values)[0], fips->dimension(1), fips->dimension() > 1 ? fips->dimension(2) : 1, view);
+		prefetcher->insert(z, channelImage);
 	}
 	
+	QVector<QRgb> colourTable(lut.size());
+	for(int i = 0; i < lut.size(); ++i) colourTable[i] = lut[i xor revert];
+	
+	*image = channelImage;
+	image->setColorTable(colourTable);
+	
+	// Render the following channels in the background
+	prefetcher->prefetch(z, z < lastChannel ? -1 : 1);
+	lastChannel = z;
+	
 	viewport->setPixmap(QPixmap::fromImage(*image));
 	
 	return 0;
@@ -312,6 +386,26 @@ unsigned int WidgetDataViewer::flux2grey(double value)
 
 
 
+// ------------------------------------------------------ //
+// FUNCTION to tabulate transfer function over plot range //
+// ------------------------------------------------------ //
+
+void WidgetDataViewer::setUpTransferTable()
+{
+	// Each entry holds the colour index at the centre of one of
+	// TRANSFER_TABLE_SIZE equal intervals between plotMin and plotMax.
+	transferTable.resize(TRANSFER_TABLE_SIZE);
+	
+	for(size_t i = 0; i < TRANSFER_TABLE_SIZE; ++i)
+	{
+		transferTable[i] = flux2grey(plotMin + (plotMax - plotMin) * (static_cast<double>(i) + 0.5) / static_cast<double>(TRANSFER_TABLE_SIZE));
+	}
+	
+	return;
+}
+
+
+
 // --------------------------------- //
 // FUNCTION to set up user interface //
 // --------------------------------- //
@@ -690,7 +784,7 @@ void WidgetDataViewer::setUpLut(int type)
 	return;
 }
 
-	
+
 
 // ----------------------------- //
 // SLOTs to change look-up table //
@@ -823,6 +917,7 @@ void WidgetDataViewer::setLevelMin()
 	if(ok and value < plotMax)
 	{
 		plotMin = value;
+		provisionalLevels = false;
 		plotChannelMap(currentChannel);
 	}
 	else
@@ -847,6 +942,7 @@ void WidgetDataViewer::setLevelMax()
 	if(ok and value > plotMin)
 	{
 		plotMax = value;
+		provisionalLevels = false;
 		plotChannelMap(currentChannel);
 	}
 	else
@@ -979,6 +1075,7 @@ void WidgetDataViewer::resetDisplaySettings()
 	
 	plotMin = dataMin;
 	plotMax = dataMax;
+	provisionalLevels = (rangeThread != 0 and rangeThread->isRunning());
 	if(actionRevert->isChecked()) actionRevert->trigger();
 	if(actionInvert->isChecked()) actionInvert->trigger();
 	actionLutRainbow->trigger();
@@ -994,6 +1091,48 @@ void WidgetDataViewer::resetDisplaySettings()
 
 
 
+// ----------------------------------------------- //
+// SLOT to update data range after background scan //
+// ----------------------------------------------- //
+
+void WidgetDataViewer::dataRangeFound()
+{
+	if(rangeThread == 0 or not rangeThread->success)
+	{
+		status->setText("Failed to determine data range.");
+		return;
+	}
+	
+	if(rangeThread->minimum < rangeThread->maximum)
+	{
+		dataMin = rangeThread->minimum;
+		dataMax = rangeThread->maximum;
+	}
+	else
+	{
+		std::cerr << "Warning: DATAMIN not greater than DATAMAX; using default values.\n";
+		dataMin = 0.0;
+		dataMax = 1.0;
+	}
+	
+	// Only replace levels not yet changed by the user
+	if(provisionalLevels)
+	{
+		plotMin = dataMin;
+		plotMax = dataMax;
+		fieldLevelMin->setText(QString::number(plotMin));
+		fieldLevelMax->setText(QString::number(plotMax));
+		plotChannelMap(currentChannel);
+		provisionalLevels = false;
+	}
+	
+	status->setText(QString("Data range: %1 to %2").arg(dataMin).arg(dataMax));
+	
+	return;
+}
+
+
+
 // ----------------------------------- //
 // FUNCTION to copy image to clipboard //
 // ----------------------------------- //
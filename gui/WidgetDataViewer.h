@@ -34,6 +34,7 @@
 
 #include <QtGlobal>
 #include <QtCore/QVector>
+#include <QtCore/QThread>
 #include <QtGui/QImage>
 #include <QtGui/QPixmap>
 #include <QtGui/QMouseEvent>
@@ -71,7 +72,10 @@
 #endif
 
 #include <string>
+#include <vector>
+#include <atomic>
 #include "Fips.hpp"
+#include "ChannelPrefetcher.h"
 
 #define VIEWPORT_WIDTH  480
 #define VIEWPORT_HEIGHT 480
@@ -85,11 +89,37 @@
 #define SQRT   1
 #define LOG    2
 
+// Number of entries in the table used to look up the
+// colour index of data values in place of flux2grey()
+#define TRANSFER_TABLE_SIZE 4096
+
 #define SCALE_MAX    32.0
 #define SCALE_FACTOR  1.414213562373095
 
 
 
+// Thread determining the minimum and maximum of the entire data
+// array, so that large cubes can be displayed before the scan is done
+
+class DataRangeThread : public QThread
+{
+public:
+	DataRangeThread(Fips *source, QObject *parent = 0);
+	void cancel();
+	bool success;
+	double minimum;
+	double maximum;
+
+protected:
+	void run();
+
+private:
+	Fips *fips;
+	std::atomic<bool> cancelled;
+};
+
+
+
 class WidgetDataViewer : public QWidget
 {
 	Q_OBJECT
@@ -119,6 +149,7 @@ private slots:
 	void zoomOut();
 	void zoomToFit();
     void copy();
+	void dataRangeFound();
 
 private:
 	Fips *fips;
@@ -132,7 +163,12 @@ private:
 	int transferFunction;
 	int currentLut;
 	QVector<QRgb> lut;
+	std::vector<unsigned char> transferTable;
 	size_t currentChannel;
+	bool provisionalLevels;
+	DataRangeThread *rangeThread;
+	ChannelPrefetcher *prefetcher;
+	size_t lastChannel;
 	
 	QVBoxLayout *mainLayout;
 	QHBoxLayout *layoutControls;
@@ -195,6 +231,7 @@ private:
 	int openFitsFile(const std::string &url);
 	int plotChannelMap(size_t z);
 	unsigned int flux2grey(double value);
+	void setUpTransferTable();
 
 protected:
 	bool eventFilter(QObject *obj, QEvent *event);
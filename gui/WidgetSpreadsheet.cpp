@@ -32,7 +32,7 @@
 // Include zlib.h for decompression of catalogue file
 #include <zlib.h>
 
-#include "TableWidget.h"
+#include "TableView.h"
 #include "WidgetSpreadsheet.h"
 
 // ----------- //
@@ -52,14 +52,16 @@ WidgetSpreadsheet::WidgetSpreadsheet(QWidget *parent)
 	iconViewRefresh.addFile(QString(":/icons/16/view-refresh.png"), QSize(16, 16));
 	iconViewRefresh = QIcon::fromTheme("view-refresh", iconViewRefresh);
 	
-	// Create table widget:
-	tableWidget = new TableWidget(this);
-	tableWidth  = 0;
-	tableHeight = 0;
-	tableWidget->setColumnCount(tableWidth);
-	tableWidget->setRowCount(tableHeight);
-	tableWidget->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-	tableWidget->setStyleSheet("QTableWidget::item {padding:5px 10px;}");
+	// Create table view:
+	catalogueModel = new CatalogueModel(this);
+	tableView = new TableView(this);
+	tableView->setModel(catalogueModel);
+	tableView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+	tableView->setStyleSheet("QTableView::item {padding:5px 10px;}");
+	
+	// Rows are given a fixed height, as resizing them to their contents
+	// would require all of them to be created:
+	tableView->verticalHeader()->setDefaultSectionSize(tableView->fontMetrics().height() + 10);
 	
 	// Create control widget:
 	widgetControls = new QWidget(this);
@@ -103,7 +105,7 @@ WidgetSpreadsheet::WidgetSpreadsheet(QWidget *parent)
 	mainLayout = new QVBoxLayout;
 	mainLayout->setContentsMargins(0, 0, 0, 0);
 	mainLayout->setSpacing(0);
-	mainLayout->addWidget(tableWidget);
+	mainLayout->addWidget(tableView);
 	mainLayout->addWidget(widgetControls);
 	
 	// Set up main window:
@@ -126,122 +128,21 @@ int WidgetSpreadsheet::loadCatalog(QString &filename)
 	if(filename.isEmpty()) return 1;
 	
 	currentFileName = filename;
-	tableWidget->clear();              // Clear the existing table. This will automatically delete all QTableWidgetItem objects
-	                                   // created before, so no memory will be leaked.
-	tableWidth  = 0;
-	tableHeight = 0;
-	buttonSort->clear();               // Clear sort button as well.
+	buttonSort->clear();               // Clear sort button.
 	buttonSort->setEnabled(false);
 	buttonOrder->setEnabled(false);
 	buttonReload->setEnabled(false);
 	
-	QDomDocument catalogue(currentFileName);
-	QFile file(currentFileName);
-	QByteArray catalogueData;
-	
-	// Try to open file
-	if(!file.open(QIODevice::ReadOnly))
-	{
-		// Doesn't work - let's check for compressed file (using zlib)
-		currentFileName.append(".gz");
-		gzFile compressedFile = gzopen(currentFileName.toUtf8().constData(), "rb");
-		
-		if(compressedFile)
-		{
-			char buffer[1024];
-			int nBytes = 0;
-			while((nBytes = gzread(compressedFile, buffer, sizeof(buffer))) > 0) catalogueData.append(buffer, nBytes);
-			gzclose(compressedFile);
-		}
-		else
-		{
-			// Doesn't work either, so let's quit.
-			return 1;
-		}
-	}
-	else
-	{
-		// Read file content into byte array
-		catalogueData = file.readAll();
-		
-		// Close file again
-		file.close();
-	}
-	
-	if(!catalogue.setContent(catalogueData)) return 1;
-	
-	// Get all tags named FIELD (contains header information):
-	QDomNodeList headerTags = catalogue.elementsByTagName("FIELD");
-	if(headerTags.isEmpty()) return 1;
-	
-	tableWidth = headerTags.size();
-	tableWidget->setColumnCount(tableWidth);
+	// Check for compressed file if the file itself doesn't exist
+	if(not QFile::exists(currentFileName)) currentFileName.append(".gz");
 	
-	QStringList datatype;    // This will store the data type of each column for later use.
+	// The catalogue is parsed while reading; the existing table is
+	// replaced, and only the visible cells will be created by the view.
+	if(catalogueModel->loadCatalog(currentFileName)) return 1;
 	
-	// Extract all header names:
-	for(int i = 0; i < headerTags.size(); i++)
-	{
-		QDomNode field = headerTags.item(i);
-		QDomNamedNodeMap fieldAttributes = field.attributes();
-		QDomNode attribute = fieldAttributes.namedItem("name");
-		QDomNode unit      = fieldAttributes.namedItem("unit");
-		datatype.append((fieldAttributes.namedItem("datatype")).nodeValue());
-		
-		QString headerText = attribute.nodeValue().trimmed();
-		
-		buttonSort->addItem(headerText);
-		
-		if(not unit.isNull() and unit.nodeValue() != "-")
-		{
-			headerText.append("\n(");
-			headerText.append(unit.nodeValue());
-			headerText.append(")");
-		}
-		
-		QTableWidgetItem* headerItem = new QTableWidgetItem(headerText, QTableWidgetItem::Type);
-		tableWidget->setHorizontalHeaderItem(i, headerItem);
-	}
-	
-	// Get all tags named TR (data rows):
-	QDomNodeList rowTags = catalogue.elementsByTagName("TR");
-	if(rowTags.isEmpty()) return 1;
-	
-	tableHeight = rowTags.size();
-	tableWidget->setRowCount(tableHeight);
-	
-	// Extract all fields (TD) within each row:
-	for(int i = 0; i < rowTags.size(); i++)
-	{
-		QDomNode row = rowTags.item(i);
-		QDomNodeList cellTags = row.childNodes();
-		
-		for(int j = 0; j < tableWidth; j++)
-		{
-			if(j < cellTags.size())
-			{
-				QDomNode cell = cellTags.item(j);
-				
-				if(not cell.isNull() and cell.hasChildNodes())
-				{
-					QDomNode entry = cell.firstChild();
-					QString  text  = entry.nodeValue().trimmed();
-					double   value = text.toDouble();
-					QTableWidgetItem* cellItem = new QTableWidgetItem();
-					
-					if(datatype[j] == "char") cellItem->setData(Qt::DisplayRole, text);
-					else                      cellItem->setData(Qt::DisplayRole, value);
-					
-					cellItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-					cellItem->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-					tableWidget->setItem(i, j, cellItem);
-				}
-			}
-		}
-	}
+	for(int i = 0; i < catalogueModel->columnCount(); i++) buttonSort->addItem(catalogueModel->columnName(i));
 	
-	tableWidget->resizeColumnsToContents();
-	tableWidget->resizeRowsToContents();
+	tableView->resizeColumnsToContents();
 	
 	buttonSort->setEnabled(true);
 	buttonOrder->setEnabled(true);
@@ -259,8 +160,8 @@ int WidgetSpreadsheet::loadCatalog(QString &filename)
 
 void WidgetSpreadsheet::sortTable(int column)
 {
-	if(buttonOrder->isChecked()) tableWidget->sortItems(column, Qt::DescendingOrder);
-	else                         tableWidget->sortItems(column, Qt::AscendingOrder);
+	if(buttonOrder->isChecked()) catalogueModel->sort(column, Qt::DescendingOrder);
+	else                         catalogueModel->sort(column, Qt::AscendingOrder);
 	
 	return;
 }
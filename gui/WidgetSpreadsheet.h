@@ -43,13 +43,11 @@
 
 #include <QtGui/QCloseEvent>
 
-#include <QtXml/QDomDocument>
-
 // Import correct headers depending on Qt version:
 #if QT_VERSION < 0x050000
 	#include <QtGui/QWidget>
-	#include <QtGui/QTableWidget>
-	#include <QtGui/QTableWidgetItem>
+	#include <QtGui/QTableView>
+	#include <QtGui/QHeaderView>
 	#include <QtGui/QLayout>
 	#include <QtGui/QFormLayout>
 	#include <QtGui/QPushButton>
@@ -57,8 +55,8 @@
 	#include <QtGui/QCheckBox>
 #else
 	#include <QtWidgets/QWidget>
-	#include <QtWidgets/QTableWidget>
-	#include <QtWidgets/QTableWidgetItem>
+	#include <QtWidgets/QTableView>
+	#include <QtWidgets/QHeaderView>
 	#include <QtWidgets/QLayout>
 	#include <QtWidgets/QFormLayout>
 	#include <QtWidgets/QPushButton>
@@ -66,6 +64,8 @@
 	#include <QtWidgets/QCheckBox>
 #endif
 
+#include "CatalogueModel.h"
+
 class WidgetSpreadsheet : public QWidget
 {
 	Q_OBJECT
@@ -78,10 +78,9 @@ private:
 	QByteArray gzipDecompress(QByteArray &compressedData);
 	
 	QString currentFileName;
-	int tableWidth;
-	int tableHeight;
-	QTableWidget *tableWidget;
-	QVBoxLayout  *mainLayout;
+	CatalogueModel *catalogueModel;
+	QTableView     *tableView;
+	QVBoxLayout    *mainLayout;
 	
 	QIcon iconDialogClose;
 	QIcon iconViewRefresh;
@@ -77,13 +77,24 @@ except KeyError:
 ext_include_dirs = [ext_include_dir for ext_include_dir in ext_include_dirs if not "bin" in ext_include_dir]
 
 
+# OpenMP flags for multi-threaded C code (not supported by Apple's default compiler)
+openmp_args = []
+if sys.platform != "darwin": openmp_args.append("-fopenmp")
+
+
 # C/C++ source code files
 # -----------------------
 
 # SoFiA's statistics functions
 statistics_src_base = "src/statistics/"
 statistics_src_files = [
-	"statistics.c"
+	"statistics.c",
+	"filter.c",
+	"atrous.c",
+	"regions.c",
+	"noise.c",
+	"ingest.c",
+	"kde.c"
 	]
 statistics_src = [statistics_src_base + f for f in statistics_src_files]
 
@@ -99,13 +110,6 @@ linker_src_files = [
 	]
 linker_src = [linker_src_base + f for f in linker_src_files]
 
-# 2D1D wavelet finder code
-wavelet_src_base = "src/wavelet/"
-wavelet_src_files = [
-	"wavelet.c"
-	]
-wavelet_src = [wavelet_src_base + f for f in wavelet_src_files]
-
 # CNHI finder code
 CNHI_src_base = "src/CNHI/"
 CNHI_src_files = [
@@ -143,21 +147,16 @@ setup(
 	version = sofia_version,
 	ext_package = "sofia",
 	ext_modules = [
-		#Extension(
-		#	"_statistics",
-		#	statistics_src,
-		#	extra_compile_args = ["-O3", "-std=c99"],
-		#	include_dirs = include_dirs
-		#	),
 		Extension(
-			"linker",
-			linker_src,
-			extra_compile_args = ["-O3"],
+			"_statistics",
+			statistics_src,
+			extra_compile_args = ["-O3", "-std=c99"] + openmp_args,
+			extra_link_args = openmp_args,
 			include_dirs = include_dirs
 			),
 		Extension(
-			"wavelet",
-			wavelet_src,
+			"linker",
+			linker_src,
 			extra_compile_args = ["-O3"],
 			include_dirs = include_dirs
 			),
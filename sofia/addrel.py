@@ -4,18 +4,30 @@ import numpy as np
 import scipy.stats as stats
 from itertools import combinations
 from sofia import error as err
+from sofia import statistics as stat
 
 # =======================================================================
-# CLASS: Define class of gaussian_kde with user-defined covariance matrix
+# CLASS: Gaussian kernel density estimate with user-defined covariance
+#        matrix; same interface as scipy.stats.gaussian_kde, but evalu-
+#        ated natively with the kernel truncated at KDE_CUTOFF sigma
 # =======================================================================
 
-class gaussian_kde_set_covariance(stats.gaussian_kde):
+KDE_CUTOFF = 8.0
+
+class gaussian_kde_set_covariance(object):
 	def __init__(self, dataset, covariance):
-		self.covariance = covariance
-		stats.gaussian_kde.__init__(self, dataset)
-	def _compute_covariance(self):
+		self.dataset = np.atleast_2d(np.asarray(dataset, dtype=np.float64))
+		self.d, self.n = self.dataset.shape
+		self.covariance = np.atleast_2d(np.asarray(covariance, dtype=np.float64))
 		self.inv_cov = np.linalg.inv(self.covariance)
+		self.whiten = np.linalg.cholesky(self.inv_cov).T
 		self._norm_factor = np.sqrt(np.linalg.det(2 * np.pi * self.covariance)) * self.n
+	def evaluate(self, points):
+		points = np.atleast_2d(np.asarray(points, dtype=np.float64))
+		if points.shape[0] != self.d and points.shape == (1, self.d): points = points.T
+		err.ensure(points.shape[0] == self.d, "Points have dimension {0}, dataset has dimension {1}.".format(points.shape[0], self.d))
+		return stat.kde_evaluate(self.dataset, points, self.whiten, KDE_CUTOFF) / self._norm_factor
+	__call__ = evaluate
 
 
 # ================================================
@@ -183,80 +195,95 @@ def EstimateRel(data, pdfoutname, parNames, parSpace=["snr_sum", "snr_max", "n_p
 		err.ensure(len(parSpace)==len(kernel),"The number of entries in the kernel above does not match the number of parameters you requested for the reliability calculation.")
 		kernel = np.identity(len(kernel)) * np.array(kernel)**2
 	
-	# Set grow_kernel to 1 to start the kernel growing loop below.
-	grow_kernel = 1
-	
-	# This loop will estimate the reliability, check whether the kernel is large enough,
-	# and if not pick a larger kernel. If autoKernel = 0 or scaleKernel = 0, we will do
-	# just one pass (i.e., we will not grow the kernel).
-	while grow_kernel:
-		# ------------------------
-		# Evaluate N-d reliability
-		# ------------------------
-		
-		if verb: err.message("   estimate normalised positive and negative density fields ...")
-		
-		Np = gaussian_kde_set_covariance(pars[:,pos], kernel)
-		Nn = gaussian_kde_set_covariance(pars[:,neg], kernel)
-		
-		# Calculate the number of positive and negative sources at the location of positive sources
-		Nps = Np(pars[:,pos]) * Npos
-		Nns = Nn(pars[:,pos]) * Nneg
+	# Search for the kernel size (unless fixed by the user), i.e. for the
+	# smallest number of growth steps, kernelIter, for which the distribution of
+	# (P-N)/sqrt(P+N) at the location of negative sources reaches skellamTol. As
+	# the kernel only grows by an isotropic factor, the median/width of that
+	# distribution is evaluated for a number of steps growing by about a quarter
+	# each time until the tolerance is reached, and the last interval is then
+	# bisected. This is only done at the location of negative sources; the
+	# density fields at the location of positive sources are only derived for
+	# the final kernel.
+	if autoKernel and not scaleKernel:
+		skellamRatio = {}
 		
-		# Calculate the number of positive and negative sources at the location of negative sources
-		nNps = Np(pars[:,neg]) * Npos
-		nNns = Nn(pars[:,neg]) * Nneg
+		def kernelFound(k):
+			# The kernel cannot grow beyond the covariance matrix
+			if negPerBin + k >= Nneg: return True
+			if k not in skellamRatio:
+				kern = kernel * (float(negPerBin + k) / negPerBin)**(2.0 / len(parCol))
+				nNps = gaussian_kde_set_covariance(pars[:,pos], kern)(pars[:,neg]) * Npos
+				nNns = gaussian_kde_set_covariance(pars[:,neg], kern)(pars[:,neg]) * Nneg
+				delt = (nNps - nNns) / np.sqrt(nNps + nNns)
+				deltstd = delt.std()
+				deltmed = np.median(delt)
+				skellamRatio[k] = deltmed / deltstd
+				err.message("  iteration, median, width, median/width = %3i, %9.2e, %9.2e, %9.2e" % (k, deltmed, deltstd, deltmed / deltstd))
+				
+				if deltmed / deltstd > -100 and doskellam and makePlot:
+					plt.hist(delt / deltstd, bins=np.arange(delt.min() / deltstd, max(5.1, delt.max() / deltstd), 0.01), cumulative=True, histtype="step", color=(min(1, float(max(1.,negPerBin) + k) / Nneg), 0,0), normed=True)
+					deltplot.append([((max(1.,negPerBin) + k) / Nneg)**(1.0 / len(parCol)), deltmed / deltstd])
+			return skellamRatio[k] > skellamTol
 		
-		# Calculate the reliability at the location of positive sources
-		Rs = (Nps - Nns) / Nps
+		lower, upper = -1, 0
+		while not kernelFound(upper):
+			lower, upper = upper, upper + 1 + int((negPerBin + upper) / 4)
+		while upper - lower > 1:
+			middle = (lower + upper) // 2
+			if kernelFound(middle): upper = middle
+			else: lower = middle
 		
-		# The reliability must be <= 1. If not, something is wrong.
-		err.ensure(Rs.max() <= 1, "Maximum reliability greater than 1; something is wrong.\nPlease ensure that enough negative sources are detected\nand decrease your source finding threshold if necessary.", frame=True)
-		
-		# Find pseudo-reliable sources (taking maximum(Rs, 0) in order to include objects with Rs < 0
-		# if threshold == 0; Rs may be < 0 because of insufficient statistics)
-		# These are called pseudo-reliable because some objects may be discarded later based on additional criteria below
-		pseudoreliable = np.maximum(Rs, 0) >= threshold
+		kernelIter = upper
+		kernel *= (float(negPerBin + kernelIter) / negPerBin)**(2.0 / len(parCol))
+	
+	# ------------------------
+	# Evaluate N-d reliability
+	# ------------------------
+	
+	if verb: err.message("   estimate normalised positive and negative density fields ...")
+	
+	Np = gaussian_kde_set_covariance(pars[:,pos], kernel)
+	Nn = gaussian_kde_set_covariance(pars[:,neg], kernel)
+	
+	# Calculate the number of positive and negative sources at the location of positive sources
+	Nps = Np(pars[:,pos]) * Npos
+	Nns = Nn(pars[:,pos]) * Nneg
+	
+	# Calculate the number of positive and negative sources at the location of negative sources
+	nNps = Np(pars[:,neg]) * Npos
+	nNns = Nn(pars[:,neg]) * Nneg
+	
+	# Calculate the reliability at the location of positive sources
+	Rs = (Nps - Nns) / Nps
+	
+	# The reliability must be <= 1. If not, something is wrong.
+	err.ensure(Rs.max() <= 1, "Maximum reliability greater than 1; something is wrong.\nPlease ensure that enough negative sources are detected\nand decrease your source finding threshold if necessary.", frame=True)
+	
+	# Find pseudo-reliable sources (taking maximum(Rs, 0) in order to include objects with Rs < 0
+	# if threshold == 0; Rs may be < 0 because of insufficient statistics)
+	# These are called pseudo-reliable because some objects may be discarded later based on additional criteria below
+	pseudoreliable = np.maximum(Rs, 0) >= threshold
 
-		# Find reliable sources (taking maximum(Rs, 0) in order to include objects with Rs < 0 if
-		# threshold == 0; Rs may be < 0 because of insufficient statistics)
-		#reliable=(np.maximum(Rs, 0)>=threshold) * (data[pos, ftotCOL].reshape(-1,) > fMin) * (data[pos, fmaxCOL].reshape(-1,) > 4)
-		reliable = (np.maximum(Rs, 0) >= threshold) * ((data[pos, ftotCOL] / np.sqrt(data[pos, parNames.index("n_pix")])).reshape(-1,) > fMin)
+	# Find reliable sources (taking maximum(Rs, 0) in order to include objects with Rs < 0 if
+	# threshold == 0; Rs may be < 0 because of insufficient statistics)
+	#reliable=(np.maximum(Rs, 0)>=threshold) * (data[pos, ftotCOL].reshape(-1,) > fMin) * (data[pos, fmaxCOL].reshape(-1,) > 4)
+	reliable = (np.maximum(Rs, 0) >= threshold) * ((data[pos, ftotCOL] / np.sqrt(data[pos, parNames.index("n_pix")])).reshape(-1,) > fMin)
+	
+	if autoKernel:
+		# Calculate quantities needed for comparison to Skellam distribution
+		delt = (nNps - nNns) / np.sqrt(nNps + nNns)
+		deltstd = delt.std()
+		deltmed = np.median(delt)
+		deltmin = delt.min()
+		deltmax = delt.max()
 		
-		if autoKernel:
-			# Calculate quantities needed for comparison to Skellam distribution
-			delt = (nNps - nNns) / np.sqrt(nNps + nNns)
-			deltstd = delt.std()
-			deltmed = np.median(delt)
-			deltmin = delt.min()
-			deltmax = delt.max()
-			
+		if scaleKernel:
 			if deltmed / deltstd > -100 and doskellam and makePlot:
 				plt.hist(delt / deltstd, bins=np.arange(deltmin / deltstd, max(5.1, deltmax / deltstd), 0.01), cumulative=True, histtype="step", color=(min(1, float(max(1.,negPerBin) + kernelIter) / Nneg), 0,0), normed=True)
 				deltplot.append([((max(1.,negPerBin) + kernelIter) / Nneg)**(1.0 / len(parCol)), deltmed / deltstd])
-						
-			if scaleKernel: grow_kernel = 0
-			else:
-				err.message("  iteration, median, width, median/width = %3i, %9.2e, %9.2e, %9.2e" % (kernelIter, deltmed, deltstd, deltmed / deltstd))
-
-				if deltmed / deltstd > skellamTol or negPerBin + kernelIter >= Nneg:
-					grow_kernel = 0
-					err.message("  Found good kernel after %i kernel growth iterations. The sqrt(kernel) size is:" % kernelIter)
-					err.message(np.sqrt(np.abs(kernel)))
-				elif deltmed / deltstd < 5 * skellamTol:
-					kernel *= (float(negPerBin + kernelIter + 20) / (negPerBin + kernelIter))**(2.0 / len(parCol)) 
-					kernelIter += 20
-				elif deltmed / deltstd < 2 * skellamTol:
-					kernel *= (float(negPerBin + kernelIter + 10) / (negPerBin + kernelIter))**(2.0 / len(parCol))
-					kernelIter += 10
-				elif deltmed / deltstd < 1.5 * skellamTol:
-					kernel *= (float(negPerBin + kernelIter + 3) / (negPerBin + kernelIter))**(2.0 / len(parCol))
-					kernelIter += 3
-				else:
-					kernel *= (float(negPerBin + kernelIter + 1) / (negPerBin + kernelIter))**(2.0 / len(parCol))
-					kernelIter += 1
 		else:
-			grow_kernel = 0
+			err.message("  Found good kernel after %i kernel growth iterations. The sqrt(kernel) size is:" % kernelIter)
+			err.message(np.sqrt(np.abs(kernel)))
 	
 	
 	# ------------
@@ -277,7 +304,7 @@ def EstimateRel(data, pdfoutname, parNames, parSpace=["snr_sum", "snr_max", "n_p
 		
 		if not scaleKernel:
 			fig3 = plt.figure()
-			deltplot = np.array(deltplot)
+			deltplot = np.array(sorted(deltplot))
 			plt.plot(deltplot[:,0], deltplot[:,1], "ko-")
 			plt.xlabel("kernel size (1D-sigma, aribtrary units)")
 			plt.ylabel("median/std of (P-N)/sqrt(P+N)")
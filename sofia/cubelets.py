@@ -2,7 +2,10 @@
 
 import os
 import math
+import gzip
 import numpy as np
+from multiprocessing import cpu_count
+from multiprocessing.pool import ThreadPool
 from scipy.ndimage import map_coordinates
 from astropy.io import fits
 from sofia import functions as func
@@ -10,6 +13,59 @@ from sofia import __version_full__ as sofia_version_full
 from sofia import __astropy_arg_overwrite__
 
 
+# Maximum number of sources written in parallel
+MAX_WORKERS = 8
+
+# Size of FITS blocks in bytes
+FITS_BLOCK = 2880
+
+
+# ==================================================================
+# FUNCTION: Pre-render the header cards of a FITS file with the given
+#           header, data type and number of axes
+# ==================================================================
+
+# Astropy is used once per type of data product to create the header
+# exactly as it would have written it; additional keywords are set in
+# the order given. The returned template contains the 80-character
+# card images, the position and comment of each keyword and the big-
+# endian data type of the data block.
+
+def fitsTemplate(header, dtype, naxis, update=(), strip3rdAxis=False):
+	hdu = fits.PrimaryHDU(data=np.zeros((1,) * naxis, dtype=dtype), header=header)
+	if strip3rdAxis: func.delete_3rd_axis(hdu.header)
+	for key, value in update: hdu.header[key] = value
+	hdu.verify("warn")
+	
+	cards = [card.image for card in hdu.header.cards]
+	index = dict((card.keyword, (i, card.comment)) for i, card in enumerate(hdu.header.cards))
+	return cards, index, np.dtype(dtype).newbyteorder(">")
+
+
+# ================================================================
+# FUNCTION: Write data to FITS file using header template, updating
+#           the values of the given keywords (which must exist)
+# ================================================================
+
+def writeFits(filename, template, data, update, compress):
+	cards, index, dtype = template
+	cards = list(cards)
+	for key in update:
+		i, comment = index[key]
+		cards[i] = fits.Card(key, update[key], comment).image
+	cards.append("END".ljust(80))
+	
+	header = "".join(cards).encode("ascii")
+	block  = np.ascontiguousarray(data, dtype=dtype).tobytes()
+	
+	if compress: f = gzip.open(filename, "wb")
+	else: f = open(filename, "wb")
+	f.write(header + b" " * (-len(header) % FITS_BLOCK))
+	f.write(block + b"\0" * (-len(block) % FITS_BLOCK))
+	f.close()
+	return
+
+
 # ======================================================
 # FUNCTION: Create various data products for each source
 # ======================================================
@@ -29,6 +85,7 @@ def writeSubcube(cube, header, mask, objects, cathead, outroot, outputDir, compr
 	
 	# Copy of header for manipulation
 	headerCubelets = header.copy()
+	headerCubelets["ORIGIN"] = sofia_version_full
 	
 	# Read all important information (central pixels & values, increments) from the header
 	#dX    = headerCubelets["CDELT1"]
@@ -42,7 +99,62 @@ def writeSubcube(cube, header, mask, objects, cathead, outroot, outputDir, compr
 	cPixZ = headerCubelets["CRPIX3"] - 1
 	cubeDim = cube.shape
 	
-	for obj in objects:
+	# Units of moment images
+	# Velocity
+	if func.check_header_keywords(func.KEYWORDS_VELO, headerCubelets["CTYPE3"]):
+		if not "CUNIT3" in headerCubelets or headerCubelets["CUNIT3"].lower() == "m/s":
+			# Converting m/s to km/s
+			dkms = abs(headerCubelets["CDELT3"]) * 1e-3
+			scalemom12 = 1e-3
+			bunitExt = ".km/s"
+		elif headerCubelets["CUNIT3"].lower() == "km/s":
+			dkms = abs(headerCubelets["CDELT3"])
+			scalemom12 = 1.0
+			bunitExt = ".km/s"
+		else:
+			# Working with whatever units the cube has
+			dkms = abs(headerCubelets["CDELT3"])
+			scalemom12 = 1.0
+			bunitExt = "." + headerCubelets["CUNIT3"]
+	# Frequency
+	elif func.check_header_keywords(func.KEYWORDS_FREQ, headerCubelets["CTYPE3"]):
+		if not "CUNIT3" in headerCubelets or headerCubelets["CUNIT3"].lower() == "hz":
+			dkms = abs(headerCubelets["CDELT3"])
+			scalemom12 = 1.0
+			bunitExt = ".Hz"
+		elif headerCubelets["CUNIT3"].lower() == "khz":
+			# Converting kHz to Hz
+			dkms = abs(headerCubelets["CDELT3"]) * 1e+3
+			scalemom12 = 1e+3
+			bunitExt = ".Hz"
+		else:
+			# Working with whatever units the cube has
+			dkms = abs(headerCubelets["CDELT3"])
+			scalemom12 = 1.0
+			bunitExt = "." + headerCubelets["CUNIT3"]
+	# Other
+	else:
+		# Working with whatever units the cube has
+		dkms = abs(headerCubelets["CDELT3"])
+		scalemom12 = 1.0
+		if not "CUNIT3" in headerCubelets: bunitExt = ".std_unit_" + headerCubelets["CTYPE3"]
+		else: bunitExt = "." + headerCubelets["CUNIT3"]
+	
+	units = [headerCubelets["BUNIT"] + bunitExt, bunitExt[1:], bunitExt[1:]]
+	
+	# Header templates of cubelets and masks; those of the moment maps are
+	# created on first use, as their data type is not known in advance.
+	templateCube = fitsTemplate(headerCubelets, cube.dtype, 3)
+	templateMask = fitsTemplate(headerCubelets, "int16", 3, [("BUNIT", "Source-ID"), ("DATAMIN", 0), ("DATAMAX", 0), ("ORIGIN", sofia_version_full)])
+	templatesMom = {}
+	
+	
+	# -------------------------------------------------------
+	# Data products of a single source; sources are processed
+	# in parallel, so all per-source state must be local.
+	# -------------------------------------------------------
+	
+	def writeSource(obj):
 		# Centres and bounding boxes
 		Xc = obj[cathead == "x"][0]
 		Yc = obj[cathead == "y"][0]
@@ -87,32 +199,21 @@ def writeSubcube(cube, header, mask, objects, cathead, outroot, outputDir, compr
 		cPixYCut = cPixY - YminNew
 		cPixZCut = cPixZ - ZminNew
 		
-		# Update header keywords:
-		headerCubelets["CRPIX1"] = cPixXCut + 1
-		headerCubelets["CRPIX2"] = cPixYCut + 1
-		headerCubelets["CRPIX3"] = cPixZCut + 1
-		
 		# Extract the cubelet
 		[ZminNew, ZmaxNew, YminNew, YmaxNew, XminNew, XmaxNew] = map(int, [ZminNew, ZmaxNew, YminNew, YmaxNew, XminNew, XmaxNew])
 		subcube = cube[ZminNew:ZmaxNew + 1, YminNew:YmaxNew + 1, XminNew:XmaxNew + 1]
 		
-		# Update header keywords:
-		headerCubelets["NAXIS1"] = subcube.shape[2]
-		headerCubelets["NAXIS2"] = subcube.shape[1]
-		headerCubelets["NAXIS3"] = subcube.shape[0]
-		
-		headerCubelets["ORIGIN"] = sofia_version_full
+		# Header keywords to be updated:
+		update2d = {"CRPIX1": cPixXCut + 1, "CRPIX2": cPixYCut + 1, "NAXIS1": subcube.shape[2], "NAXIS2": subcube.shape[1]}
+		update3d = {"CRPIX3": cPixZCut + 1, "NAXIS3": subcube.shape[0]}
+		update3d.update(update2d)
 		
 		# Write the cubelet
-		hdu = fits.PrimaryHDU(data=subcube, header=headerCubelets)
-		hdulist = fits.HDUList([hdu])
 		name = outputDir + cubename + "_" + str(int(obj[0])) + ".fits"
 		if compress: name += ".gz"
 		
 		# Check for overwrite flag:
-		if func.check_overwrite(name, flagOverwrite): hdulist.writeto(name, output_verify="warn", **__astropy_arg_overwrite__)
-		
-		hdulist.close()
+		if func.check_overwrite(name, flagOverwrite): writeFits(name, templateCube, subcube, update3d, compress)
 		
 		
 		# -------------------------
@@ -137,7 +238,9 @@ def writeSubcube(cube, header, mask, objects, cathead, outroot, outputDir, compr
 				plane = np.array([ii[:plane[-1].shape[0]] for ii in plane])
 				pv_array.append(plane.mean(axis=0))
 			pv_array = np.array(pv_array)
-			hdu = fits.PrimaryHDU(data=pv_array, header=headerCubelets)
+			headerPV = headerCubelets.copy()
+			for key in update3d: headerPV[key] = update3d[key]
+			hdu = fits.PrimaryHDU(data=pv_array, header=headerPV)
 			hdulist = fits.HDUList([hdu])
 			hdulist[0].header["CTYPE1"] = "PV--DIST"
 			hdulist[0].header["CDELT1"] = hdulist[0].header["CDELT2"]
@@ -162,78 +265,33 @@ def writeSubcube(cube, header, mask, objects, cathead, outroot, outputDir, compr
 		# -------------
 		
 		# Remove all other sources from the mask
-		submask = mask[ZminNew:ZmaxNew + 1, YminNew:YmaxNew + 1, XminNew:XmaxNew + 1].astype("int")
-		submask[submask != obj[0]] = 0
-		submask[submask == obj[0]] = 1
+		submask = (mask[ZminNew:ZmaxNew + 1, YminNew:YmaxNew + 1, XminNew:XmaxNew + 1] == obj[0]).astype("int16")
 		
 		# Write mask
-		hdu = fits.PrimaryHDU(data=submask.astype("int16"), header=headerCubelets)
-		hdu.header["BUNIT"] = "Source-ID"
-		hdu.header["DATAMIN"] = np.nanmin(submask)
-		hdu.header["DATAMAX"] = np.nanmax(submask)
-		hdu.header["ORIGIN"] = sofia_version_full
-		hdulist = fits.HDUList([hdu])
 		name = outputDir + cubename + "_" + str(int(obj[0])) + "_mask.fits"
 		if compress: name += ".gz"
 		
 		# Check for overwrite flag:
-		if func.check_overwrite(name, flagOverwrite): hdulist.writeto(name, output_verify="warn", **__astropy_arg_overwrite__)
-		hdulist.close()
+		if func.check_overwrite(name, flagOverwrite):
+			updateMask = {"DATAMIN": int(submask.min()), "DATAMAX": int(submask.max())}
+			updateMask.update(update3d)
+			writeFits(name, templateMask, submask, updateMask, compress)
 		
 		
 		# ------------------
 		# Moments 0, 1 and 2
 		# ------------------
 		
-		# Units of moment images
-		# Velocity
-		if func.check_header_keywords(func.KEYWORDS_VELO, headerCubelets["CTYPE3"]):
-			if not "CUNIT3" in headerCubelets or headerCubelets["CUNIT3"].lower() == "m/s":
-				# Converting m/s to km/s
-				dkms = abs(headerCubelets["CDELT3"]) * 1e-3
-				scalemom12 = 1e-3
-				bunitExt = ".km/s"
-			elif headerCubelets["CUNIT3"].lower() == "km/s":
-				dkms = abs(headerCubelets["CDELT3"])
-				scalemom12 = 1.0
-				bunitExt = ".km/s"
-			else:
-				# Working with whatever units the cube has
-				dkms = abs(headerCubelets["CDELT3"])
-				scalemom12 = 1.0
-				bunitExt = "." + headerCubelets["CUNIT3"]
-		# Frequency
-		elif func.check_header_keywords(func.KEYWORDS_FREQ, headerCubelets["CTYPE3"]):
-			if not "CUNIT3" in headerCubelets or headerCubelets["CUNIT3"].lower() == "hz":
-				dkms = abs(headerCubelets["CDELT3"])
-				scalemom12 = 1.0
-				bunitExt = ".Hz"
-			elif headerCubelets["CUNIT3"].lower() == "khz":
-				# Converting kHz to Hz
-				dkms = abs(headerCubelets["CDELT3"]) * 1e+3
-				scalemom12 = 1e+3
-				bunitExt = ".Hz"
-			else:
-				# Working with whatever units the cube has
-				dkms = abs(headerCubelets["CDELT3"])
-				scalemom12 = 1.0
-				bunitExt = "." + headerCubelets["CUNIT3"]
-		# Other
-		else:
-			# Working with whatever units the cube has
-			dkms = abs(headerCubelets["CDELT3"])
-			scalemom12 = 1.0
-			if not "CUNIT3" in headerCubelets: bunitExt = ".std_unit_" + headerCubelets["CTYPE3"]
-			else: bunitExt = "." + headerCubelets["CUNIT3"]
-		
 		# Make copy of subcube and regrid if necessary
 		# NOTE: Why on earth do we need to make a copy here? If we don't create a copy,
 		#       then SoFiA will crash as all pixels in the moment map are NaN, but I
 		#       don't understand why this would be the case in the first place.
 		subcubeCopy = subcube.copy()
 		if "cellscal" in headerCubelets and headerCubelets["cellscal"] == "1/F":
+			headerRegrid = headerCubelets.copy()
+			for key in update3d: headerRegrid[key] = update3d[key]
 			subcubeCopy[submask == 0] = 0        # NOTE: These will later be set to NaN by the regridding task
-			subcubeCopy = func.regridMaskedChannels(subcubeCopy, submask, headerCubelets)
+			subcubeCopy = func.regridMaskedChannels(subcubeCopy, submask, headerRegrid)
 		else:
 			subcubeCopy[submask == 0] = np.nan   # NOTE: Manually set to NaN to ensure correct generation of spectra below
 		
@@ -243,7 +301,7 @@ def writeSubcube(cube, header, mask, objects, cathead, outroot, outputDir, compr
 			moments[0] = np.nansum(subcubeCopy, axis=0)
 			
 			# Definition of moment 1
-			velArr = ((np.arange(subcubeCopy.shape[0]).reshape((subcubeCopy.shape[0], 1, 1)) + 1.0 - headerCubelets["CRPIX3"]) * headerCubelets["CDELT3"] + headerCubelets["CRVAL3"]) * scalemom12
+			velArr = ((np.arange(subcubeCopy.shape[0]).reshape((subcubeCopy.shape[0], 1, 1)) + 1.0 - update3d["CRPIX3"]) * headerCubelets["CDELT3"] + headerCubelets["CRVAL3"]) * scalemom12
 			moments[1] = np.divide(np.nansum(velArr * subcubeCopy, axis=0), moments[0])
 			# NOTE: Here we make use of array broadcasting in NumPy, but we need to reshape the velocity array
 			#       from [nz] to [nz, 1, 1] for this to work, so that [nz, 1, 1] * [nz, ny, nx] --> [nz, ny, nx].
@@ -255,18 +313,16 @@ def writeSubcube(cube, header, mask, objects, cathead, outroot, outputDir, compr
 			#       [nz, 1, 1] - [ny, nx] --> [nz, ny, nx] according to NumPy's broadcasting rules.
 		
 		moments[0] *= dkms
-		units = [headerCubelets["BUNIT"] + bunitExt, bunitExt[1:], bunitExt[1:]]
 		
 		for i in range(3):
-			hdu = fits.PrimaryHDU(data=moments[i], header=headerCubelets)
-			func.delete_3rd_axis(hdu.header)
-			hdu.header["BUNIT"]   = units[i]
-			hdu.header["DATAMIN"] = np.nanmin(moments[i])
-			hdu.header["DATAMAX"] = np.nanmax(moments[i])
-			hdu.header["ORIGIN"]  = sofia_version_full
 			filename = outputDir + cubename + "_{0:d}_mom{1:d}.fits".format(int(obj[0]), i)
 			if compress: filename += ".gz"
-			if func.check_overwrite(filename, flagOverwrite): hdu.writeto(filename, output_verify="warn", **__astropy_arg_overwrite__)
+			if func.check_overwrite(filename, flagOverwrite):
+				key = (i, moments[i].dtype.str)
+				if key not in templatesMom: templatesMom[key] = fitsTemplate(headerCubelets, moments[i].dtype, 2, [("BUNIT", units[i]), ("DATAMIN", 0), ("DATAMAX", 0), ("ORIGIN", sofia_version_full)], strip3rdAxis=True)
+				updateMom = {"DATAMIN": np.nanmin(moments[i]), "DATAMAX": np.nanmax(moments[i])}
+				updateMom.update(update2d)
+				writeFits(filename, templatesMom[key], moments[i], updateMom, compress)
 		
 		
 		# -------------------
@@ -280,36 +336,54 @@ def writeSubcube(cube, header, mask, objects, cathead, outroot, outputDir, compr
 		
 		# Check for overwrite flag:
 		if func.check_overwrite(name, flagOverwrite):
-			if compress:
-				import gzip
-				f = gzip.open(name, "wb")
-			else:
-				f = open(name, "w")
-			
-			f.write("# Integrated source spectrum\n")
-			f.write("# Creator: %s\n#\n" % sofia_version_full)
-			f.write("# Description of columns:\n")
-			f.write("# - Chan      Channel number.\n")
-			f.write("# - Spectral  Associated value of the spectral coordinate according to\n")
-			f.write("#             the WCS information in the FITS file header.\n")
-			f.write("# - Sum       Sum of flux values of all spatial pixels covered by the\n")
-			f.write("#             source in that channel. Note that this has not yet been\n")
-			f.write("#             divided by the beam solid angle! If your data cube is in\n")
-			f.write("#             Jy/beam, you will have to manually divide by the beam\n")
-			f.write("#             size which, for Gaussian beams, is given as\n")
-			f.write("#               PI * a * b / (4 * ln(2))\n")
-			f.write("#             where a and b are the major and minor axis of the beam in\n")
-			f.write("#             units of pixels.\n")
-			f.write("# - Npix      Number of spatial pixels covered by the source in that\n")
-			f.write("#             channel. This can be used to determine the statistical\n")
-			f.write("#             uncertainty of the summed flux value. Again, this has\n")
-			f.write("#             not yet been corrected for any potential spatial correla-\n")
-			f.write("#             tion of pixels due to the beam solid angle!\n#\n")
-			f.write("# Chan        Spectral             Sum    Npix\n")
-			f.write("# --------------------------------------------\n")
+			# Assemble entire file in memory to write it in one go
+			text = []
+			text.append("# Integrated source spectrum\n")
+			text.append("# Creator: %s\n#\n" % sofia_version_full)
+			text.append("# Description of columns:\n")
+			text.append("# - Chan      Channel number.\n")
+			text.append("# - Spectral  Associated value of the spectral coordinate according to\n")
+			text.append("#             the WCS information in the FITS file header.\n")
+			text.append("# - Sum       Sum of flux values of all spatial pixels covered by the\n")
+			text.append("#             source in that channel. Note that this has not yet been\n")
+			text.append("#             divided by the beam solid angle! If your data cube is in\n")
+			text.append("#             Jy/beam, you will have to manually divide by the beam\n")
+			text.append("#             size which, for Gaussian beams, is given as\n")
+			text.append("#               PI * a * b / (4 * ln(2))\n")
+			text.append("#             where a and b are the major and minor axis of the beam in\n")
+			text.append("#             units of pixels.\n")
+			text.append("# - Npix      Number of spatial pixels covered by the source in that\n")
+			text.append("#             channel. This can be used to determine the statistical\n")
+			text.append("#             uncertainty of the summed flux value. Again, this has\n")
+			text.append("#             not yet been corrected for any potential spatial correla-\n")
+			text.append("#             tion of pixels due to the beam solid angle!\n#\n")
+			text.append("# Chan        Spectral             Sum    Npix\n")
+			text.append("# --------------------------------------------\n")
 			
 			for i in range(0,len(spec)):
 				xspec = cValZ + (i + float(ZminNew) - cPixZ) * dZ
-				f.write("%6d %15.6e %15.6e %7d\n" % (i + ZminNew, xspec, spec[i], nPix[i]))
+				text.append("%6d %15.6e %15.6e %7d\n" % (i + ZminNew, xspec, spec[i], nPix[i]))
+			
+			text = "".join(text)
 			
+			if compress:
+				f = gzip.open(name, "wb")
+				f.write(text.encode("ascii"))
+			else:
+				f = open(name, "w")
+				f.write(text)
 			f.close()
+	
+	
+	# Process sources in parallel with a bounded pool of worker threads; most of
+	# the time is spent in NumPy and in file I/O, both of which release the GIL.
+	workers = max(1, min(MAX_WORKERS, cpu_count(), len(objects)))
+	if workers > 1:
+		pool = ThreadPool(workers)
+		pool.map(writeSource, objects)
+		pool.close()
+		pool.join()
+	else:
+		for obj in objects: writeSource(obj)
+	
+	return
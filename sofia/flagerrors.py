@@ -4,6 +4,7 @@ import math
 import numpy as np
 from scipy.ndimage.morphology import binary_dilation
 from sofia.functions import GetRMS
+from sofia import statistics as stat
 from sofia import error as err
 
 """
@@ -24,15 +25,14 @@ def flaglos(cube,flgthr,dilside):
 	#los_rms = np.nanstd(cube,axis=0)
 	#los_rms = 1.4826*np.nanmedian(abs(cube),axis=0)
 
-	# ... OR NOT in order to use the TwoPass option of GetRMS
-	los_rms=np.zeros((cube.shape[-2],cube.shape[-1]))
-	for xx in range(cube.shape[-1]):
-		for yy in range(cube.shape[-2]): los_rms[yy,xx]=GetRMS(cube[:,yy:yy+1,xx:xx+1],rmsMode="mad", fluxRange="all", twoPass=True)
+	# ... OR NOT in order to use the TwoPass option of GetRMS (5-sigma clip)
+	los_rms=stat.mad_spectra(cube, clip=5.0)
 
 	# Mask all LOS's whose RMS is > flgthr*STD above rms0 (optionally extended to neighbouring LOS's using binary dilation with a box structuring element)
 	los_rms_disp=np.nanstd(los_rms)
 	los_rms=(los_rms<rms0+flgthr*los_rms_disp)
 	los_rms=binary_dilation(~los_rms,structure=np.ones((dilside,dilside)))
 	cube[:,los_rms]=np.nan
+	stat.forget(cube)
 
 	return cube
@@ -6,6 +6,7 @@ import math
 import numpy as np
 import scipy as sp
 from distutils.version import LooseVersion
+from sofia import statistics as stat
 from sofia import error as err
 
 # Check numpy and scipy version numbers for the nanmedian function import
@@ -233,7 +234,7 @@ def GetRMS(cube, rmsMode="negative", fluxRange="all", zoomx=1, zoomy=1, zoomz=1,
 	if rmsMode == "negative":
 		nrbins = max(100, int(math.ceil(float(cube.size) / 1e+5)))
 		
-		cubemin = np.nanmin(cube)
+		cubemin = stat.nan_range(cube)[0]
 		err.ensure(cubemin < 0, "Cannot estimate noise from Gaussian fit to negative flux\nhistogram; no negative fluxes found in data cube.")
 		
 		bins = np.arange(cubemin, abs(cubemin) / nrbins - 1e-12, abs(cubemin) / nrbins)
@@ -255,8 +256,8 @@ def GetRMS(cube, rmsMode="negative", fluxRange="all", zoomx=1, zoomy=1, zoomz=1,
 	# GAUSSIAN FIT TO FLUX HISTOGRAM / SECOND MOMENT OF FLUX HISTOGRAM
 	elif rmsMode == "gauss" or rmsMode == "moment":
 		nBins = 100
-		dataMin = float(np.nanmin(cube))
-		dataMax = float(np.nanmax(cube))
+		dataMin, dataMax = stat.nan_range(cube)
+		dataMin, dataMax = float(dataMin), float(dataMax)
 		err.ensure(dataMin < dataMax, "Maximum not greater than minimum. Cannot determine noise level.")
 		
 		if fluxRange == "negative":
@@ -6,6 +6,87 @@ import os
 import sys
 from numpy import *
 import re
+from sofia import statistics as stat
+
+
+# FITS data types that can be memory-mapped directly (in FITS byte order):
+FITS_DTYPES = {8: 'u1', 16: '>i2', 32: '>i4', 64: '>i8', -32: '>f4', -64: '>f8'}
+
+
+def memmap_hdu(hdulist, index=Ellipsis):
+	# Memory-map (section of) primary HDU without reading any data; returns None if the file is
+	# compressed or contains scaled integers, in which case astropy needs to take care of it.
+	# Otherwise returns the memory-mapped array in FITS byte order along with BSCALE and BZERO.
+	header = hdulist[0].header
+	bscale = float(header.get('BSCALE', 1.0))
+	bzero = float(header.get('BZERO', 0.0))
+	
+	info = hdulist.fileinfo(0)
+	if info is None: return None
+	
+	try:
+		if getattr(info['file'], 'compression', None) or header['BITPIX'] not in FITS_DTYPES or header['NAXIS'] < 1: return None
+		if header['BITPIX'] > 0 and (bscale != 1.0 or bzero != 0.0): return None
+		shape = tuple([int(header['NAXIS%i' % axis]) for axis in range(header['NAXIS'], 0, -1)])
+		source = memmap(info['filename'], dtype=FITS_DTYPES[header['BITPIX']], mode='r', offset=info['datLoc'], shape=shape)[index]
+	except (KeyError, ValueError, OSError, IOError):
+		return None
+	
+	return source, bscale, bzero
+
+
+def read_hdu(hdulist, index=Ellipsis):
+	# Read (section of) primary HDU into native-endian array. Memory-mapped data are copied one
+	# plane at a time, so only the requested section is read from disk, and byte-swapping and
+	# scaling are carried out in a single pass while the plane is in cache. As with astropy's
+	# data attribute, BSCALE and BZERO are removed from the header once they have been applied.
+	mapped = memmap_hdu(hdulist, index)
+	if mapped is None:
+		if index is Ellipsis: return hdulist[0].data
+		return hdulist[0].section[index]
+	
+	source, bscale, bzero = mapped
+	data = empty(source.shape, dtype=source.dtype.newbyteorder('='))
+	if source.dtype.kind == 'f' and source.dtype.itemsize == 4 and source.ndim >= 2 and source.strides[-1] == 4:
+		# Single-precision data are converted natively, recording the number of NaN values and
+		# the data range on the way; these are cached for later stages to avoid further passes.
+		n_nan, data_min, data_max = 0, nan, nan
+		for plane in ndindex(source.shape[:-2]):
+			plane_nan, plane_min, plane_max = stat.ingest_plane(data[plane], source[plane], bscale, bzero)
+			n_nan += plane_nan
+			if not isnan(plane_min):
+				data_min = plane_min if isnan(data_min) else minimum(data_min, plane_min)
+				data_max = plane_max if isnan(data_max) else maximum(data_max, plane_max)
+		stat.remember(data, n_nan, data_min, data_max)
+	else:
+		for plane in ndindex(source.shape[:-2]):
+			data[plane] = source[plane]
+			if bscale != 1.0: data[plane] *= bscale
+			if bzero != 0.0: data[plane] += bzero
+	
+	for keyword in ['BSCALE', 'BZERO']:
+		if keyword in hdulist[0].header: del hdulist[0].header[keyword]
+	
+	return data
+
+
+def multiply_hdu(data, hdulist, index=Ellipsis):
+	# Multiply data in place by (section of) primary HDU of the same shape, one plane at a time,
+	# without loading the entire HDU into memory if it can be memory-mapped.
+	mapped = memmap_hdu(hdulist, index)
+	if mapped is None:
+		if index is Ellipsis: data *= hdulist[0].data
+		else: data *= hdulist[0].section[index]
+		return
+	
+	source, bscale, bzero = mapped
+	for plane in ndindex(source.shape[:-2]):
+		factor = source[plane].astype(source.dtype.newbyteorder('='))
+		if bscale != 1.0: factor *= bscale
+		if bzero != 0.0: factor += bzero
+		data[plane] *= factor
+	
+	return
 
 
 def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, weightsFunction = None, subcube=[], subcubeMode='pixel', doFlag=False, flagRegions=False, flagFile='', cubeOnly=False):
@@ -143,7 +224,7 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 		fullshape = [dict_Header['NAXIS3'], dict_Header['NAXIS2'], dict_Header['NAXIS1']]
 		
 		if len(subcube) == 6:
-			np_Cube = f[0].section[subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]]
+			np_Cube = read_hdu(f, s_[subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]])
 			dict_Header['CRPIX1'] -= subcube[0]
 			dict_Header['CRPIX2'] -= subcube[2]
 			dict_Header['CRPIX3'] -= subcube[4]
@@ -151,7 +232,7 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 			dict_Header['NAXIS2'] = subcube[3] - subcube[2]
 			dict_Header['NAXIS3'] = subcube[5] - subcube[4]
 		elif not len(subcube):
-			np_Cube = f[0].data
+			np_Cube = read_hdu(f)
 		else:
 			sys.stderr.write("ERROR: The subcube list must have 6 entries (%i given).\n" % len(subcube))
 			raise SystemExit(1)
@@ -166,7 +247,7 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 			fullshape = [dict_Header['NAXIS3'], dict_Header['NAXIS2'], dict_Header['NAXIS1']]
 			
 			if len(subcube) == 6:
-				np_Cube = f[0].section[0, subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]]
+				np_Cube = read_hdu(f, s_[0, subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]])
 				dict_Header['CRPIX1'] -= subcube[0]
 				dict_Header['CRPIX2'] -= subcube[2]
 				dict_Header['CRPIX3'] -= subcube[4]
@@ -174,7 +255,7 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 				dict_Header['NAXIS2'] = subcube[3] - subcube[2]
 				dict_Header['NAXIS3'] = subcube[5] - subcube[4]
 			elif not len(subcube):
-				np_Cube = f[0].section[0]
+				np_Cube = read_hdu(f, s_[0])
 			else:
 				sys.stderr.write("ERROR: The subcube list must have 6 entries (%i given). Ignore 4th axis.\n" % len(subcube))
 				raise SystemExit(1)
@@ -187,13 +268,13 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 		fullshape = [dict_Header['NAXIS2'], dict_Header['NAXIS1']]
 		
 		if len(subcube) == 4:
-			np_Cube = array([f[0].section[subcube[2]:subcube[3], subcube[0]:subcube[1]]])
+			np_Cube = array([read_hdu(f, s_[subcube[2]:subcube[3], subcube[0]:subcube[1]])])
 			dict_Header['CRPIX1'] -= subcube[0]
 			dict_Header['CRPIX2'] -= subcube[2]
 			dict_Header['NAXIS1'] = subcube[1] - subcube[0]
 			dict_Header['NAXIS2'] = subcube[3] - subcube[2]
 		elif not len(subcube):
-			np_Cube = array([f[0].data])
+			np_Cube = array([read_hdu(f)])
 		else:
 			sys.stderr.write("ERROR: The subcube list must have 4 entries (%i given).\n" % len(subcube))
 			raise SystemExit(1)
@@ -213,6 +294,8 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 	# Check if cube needs to be inverted
 	if invertData:
 		np_Cube *= -1.0
+		info = stat.cube_info(np_Cube)
+		if info is not None: stat.remember(np_Cube, info['n_nan'], -info['max'], -info['min'])
 		print("Inverting data cube to search for negative signals")
 	
 	
@@ -242,25 +325,25 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 				dict_Weights_header = f[0].header
 				if dict_Weights_header['NAXIS'] == 3:
 					if len(subcube) == 6:
-						np_Cube *= f[0].section[subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]]
+						multiply_hdu(np_Cube, f, s_[subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]])
 					else:
-						np_Cube *= f[0].data
+						multiply_hdu(np_Cube, f)
 				elif dict_Weights_header['NAXIS'] == 4:
 					if dict_Weights_header['NAXIS4'] != 1:
 						sys.stderr.write("ERROR: The 4th dimension has more than 1 value.\n")
 						raise SystemExit(1)
 					else:
 						sys.stderr.write("WARNING: The weights cube has 4 axes; first axis ignored.\n")
-						if len(subcube) == 6: np_Cube *= f[0].section[0, subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]]
-						else: np_Cube *= f[0].section[0]
+						if len(subcube) == 6: multiply_hdu(np_Cube, f, s_[0, subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]])
+						else: multiply_hdu(np_Cube, f, s_[0])
 				elif dict_Weights_header['NAXIS'] == 2:
 					sys.stderr.write("WARNING: The weights cube has 2 axes; third axis added.\n")
-					if len(subcube) == 6 or len(subcube) == 4: np_Cube *= array([f[0].section[subcube[2]:subcube[3], subcube[0]:subcube[1]]])
-					else: np_Cube *= array([f[0].data])
+					if len(subcube) == 6 or len(subcube) == 4: np_Cube *= array([read_hdu(f, s_[subcube[2]:subcube[3], subcube[0]:subcube[1]])])
+					else: np_Cube *= array([read_hdu(f)])
 				elif dict_Weights_header['NAXIS'] == 1:
 					sys.stderr.write("WARNING: The weights cube has 1 axis; interpreted as third axis; first and second axes added.\n")
-					if len(subcube) == 6: np_Cube *= reshape(f[0].section[subcube[4]:subcube[5]], (-1, 1, 1))
-					elif not len(subcube): np_Cube *= reshape(f[0].data, (-1, 1, 1))
+					if len(subcube) == 6: np_Cube *= reshape(read_hdu(f, s_[subcube[4]:subcube[5]]), (-1, 1, 1))
+					elif not len(subcube): np_Cube *= reshape(read_hdu(f), (-1, 1, 1))
 					else:
 						sys.stderr.write("ERROR: The subcube list must have 6 entries (%i given).\n" % len(subcube))
 						raise SystemExit(1)
@@ -270,7 +353,7 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 				
 				f.close()
 				print ('Weights cube loaded and applied.')
-				
+		
 		# Else apply weights function if defined:
 		elif weightsFunction:
 			# WARNING: I'm not sure if there is a safe way to properly implement multiplication of a data array 
@@ -338,10 +421,10 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 				dict_Flag_header = f[0].header
 				if dict_Flag_header['NAXIS'] == 3:
 					if len(subcube) == 6:
-						flags = f[0].section[subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]]
+						flags = read_hdu(f, s_[subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]])
 						np_Cube[isnan(flags)] = nan
 					else:
-						np_Cube[isnan(f[0].data)] = nan
+						np_Cube[isnan(read_hdu(f))] = nan
 				elif dict_Flag_header['NAXIS'] == 4:
 					if dict_Flag_header['NAXIS4'] != 1:
 						sys.stderr.write("ERROR: The 4th dimension has more than 1 value.\n")
@@ -349,13 +432,13 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 					else:
 						sys.stderr.write("WARNING: The flag cube has 4 axes; first axis ignored.\n")
 						if len(subcube) == 6:
-							flags = f[0].section[0, subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]]
+							flags = read_hdu(f, s_[0, subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]])
 							np_Cube[isnan(flags)] = nan
-						else: np_Cube[isnan(f[0].section[0])] = nan
+						else: np_Cube[isnan(read_hdu(f, s_[0]))] = nan
 				elif dict_Flag_header['NAXIS'] == 2:
 					sys.stderr.write("WARNING: The flag cube has 2 axes; third axis added.\n")
 					if len(subcube) == 6 or len(subcube) == 4: 
-						flags = f[0].section[subcube[2]:subcube[3], subcube[0]:subcube[1]]
+						flags = read_hdu(f, s_[subcube[2]:subcube[3], subcube[0]:subcube[1]])
 						for channel in range(np_Cube.shape[0]):
 							np_Cube[channel][isnan(flags)] = nan
 					else: 
@@ -371,6 +454,9 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 			if flagRegions:
 				flag(np_Cube, flagRegions)
 		
+		# Statistics recorded on ingest are no longer valid for weighted or flagged data
+		if weightsFile or weightsFunction or doFlag: stat.forget(np_Cube)
+		
 		
 		if maskFile:
 			# check whether the mask cube exists:
@@ -391,14 +477,14 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 					elif len(subcube) == 6:
 						if dict_Mask_header['NAXIS1'] == np_Cube.shape[2] and dict_Mask_header['NAXIS2'] == np_Cube.shape[1] and dict_Mask_header['NAXIS3'] == np_Cube.shape[0]:
 							print ('Subcube selection NOT applied to input mask. The full input mask cube matches size and WCS of the selected data subcube.')
-							mask = g[0].data
+							mask = read_hdu(g)
 						elif dict_Mask_header['NAXIS1'] == fullshape[2] and dict_Mask_header['NAXIS2'] == fullshape[1] and dict_Mask_header['NAXIS3'] == fullshape[0]:
 							print ('Subcube selection applied also to input mask. The mask subcube matches size and WCS of the selected data subcube.')
-							mask = g[0].section[subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]]
+							mask = read_hdu(g, s_[subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]])
 						else:
 							sys.stderr.write("ERROR: Neither the full mask nor the subcube of the mask match size and WCS of the selected data subcube.\n")
 							raise SystemExit(1)
-					else: mask = g[0].data
+					else: mask = read_hdu(g)
 				elif dict_Mask_header['NAXIS'] == 4:
 					if dict_Mask_header['CRVAL1'] != dict_Header['CRVAL1'] or dict_Mask_header['CRVAL2'] != dict_Header['CRVAL2'] or dict_Mask_header['CRVAL3'] != dict_Header['CRVAL3']:
 						sys.stderr.write("ERROR: Input cube and mask are not on the same WCS grid.\n")
@@ -410,14 +496,14 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 						sys.stderr.write("WARNING: The mask cube has 4 axes; first axis ignored.\n")
 						if dict_Mask_header['NAXIS1'] == np_Cube.shape[2] and dict_Mask_header['NAXIS2'] == np_Cube.shape[1] and dict_Mask_header['NAXIS3'] == np_Cube.shape[0]:
 							print ('Subcube selection NOT applied to input mask. The full input mask cube matches size and WCS of the selected data subcube.')
-							mask = g[0].section[0]
+							mask = read_hdu(g, s_[0])
 						elif dict_Mask_header['NAXIS1'] == fullshape[2] and dict_Mask_header['NAXIS2'] == fullshape[1] and dict_Mask_header['NAXIS3'] == fullshape[0]:
 							print ('Subcube selection applied also to input mask. The mask subcube matches size and WCS of the selected data subcube.')
-							mask = g[0].section[0, subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]]
+							mask = read_hdu(g, s_[0, subcube[4]:subcube[5], subcube[2]:subcube[3], subcube[0]:subcube[1]])
 						else:
 							sys.stderr.write("ERROR: Neither the full mask nor the subcube of the mask match size and WCS of the selected data subcube.\n")
 							raise SystemExit(1)
-					else: mask = g[0].section[0]
+					else: mask = read_hdu(g, s_[0])
 				elif dict_Mask_header['NAXIS'] == 2:
 					if dict_Mask_header['CRVAL1'] != dict_Header['CRVAL1'] or dict_Mask_header['CRVAL2'] != dict_Header['CRVAL2']:
 						sys.stderr.write("ERROR: Input cube and mask are not on the same WCS grid.\n")
@@ -426,14 +512,14 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 					if len(subcube) == 6 or len(subcube) == 4:
 						if dict_Mask_header['NAXIS1'] == np_Cube.shape[2] and dict_Mask_header['NAXIS2'] == np_Cube.shape[1]:
 							print ('Subcube selection NOT applied to input mask. The full input mask cube matches size and WCS of the selected data subcube.')
-							mask = array([g[0].data])
+							mask = array([read_hdu(g)])
 						elif dict_Mask_header['NAXIS1'] == fullshape[2] and dict_Mask_header['NAXIS2'] == fullshape[1]:
 							print ('Subcube selection applied also to input mask. The mask subcube matches size and WCS of the selected data subcube.')
-							mask = array([g[0].section[subcube[2]:subcube[3], subcube[0]:subcube[1]]])
+							mask = array([read_hdu(g, s_[subcube[2]:subcube[3], subcube[0]:subcube[1]])])
 						else:
 							sys.stderr.write("ERROR: Neither the full mask nor the subcube of the mask match size and WCS of the selected data subcube.\n")
 							raise SystemExit(1)
-					else: mask=array([g[0].data])
+					else: mask=array([read_hdu(g)])
 				elif dict_Mask_header['NAXIS'] == 1:
 					sys.stderr.write("WARNING: The mask cube has 1 axis; interpreted as third axis; first and second axes added.\n")
 					if dict_Mask_header['CRVAL1'] != dict_Header['CRVAL1']:
@@ -442,15 +528,15 @@ def read_data(doSubcube, inFile, invertData, weightsFile, maskFile, sources, wei
 					if len(subcube) == 6:
 						if dict_Mask_header['NAXIS1'] == np_Cube.shape[0]:
 							print ('Subcube selection NOT applied to input mask. The full input mask cube matches size and WCS of the selected data subcube.')
-							mask = reshape(g[0].data, (-1, 1, 1))
+							mask = reshape(read_hdu(g), (-1, 1, 1))
 						elif dict_Mask_header['NAXIS1'] == fullshape[0]:
 							print ('Subcube selection applied also to input mask. The mask subcube matches size and WCS of the selected data subcube.')
-							mask = reshape(g[0].section[subcube[4]:subcube[5]], (-1, 1, 1))
+							mask = reshape(read_hdu(g, s_[subcube[4]:subcube[5]]), (-1, 1, 1))
 						else:
 							sys.stderr.write("ERROR: Neither the full mask nor the subcube of the mask match size and WCS of the selected data subcube.\n")
 							raise SystemExit(1)
 					elif not len(subcube):
-						mask = reshape(g[0].data, (-1, 1, 1))
+						mask = reshape(read_hdu(g), (-1, 1, 1))
 					else:
 						sys.stderr.write("ERROR: The subcube list must have 6 entries (%i given).\n" % len(subcube))
 						raise SystemExit(1)
@@ -1,10 +1,30 @@
 #!/usr/bin/python
 
+import ctypes as ct
 import numpy as np
-import scipy.ndimage as nd
 from scipy.special import erf
 from sofia import cparametrizer as cp
 from sofia import error as err
+from sofia import statistics as stat
+
+
+
+# =====================================================
+# Columnar interface of the C++ parametrisation module
+# =====================================================
+
+_param = ct.CDLL(cp.__file__)
+
+_param.parametrisation_columns.argtypes = [ct.c_int]
+_param.parametrisation_columns.restype = ct.c_size_t
+_param.parametrisation_column_name.argtypes = [ct.c_int, ct.c_size_t]
+_param.parametrisation_column_name.restype = ct.c_char_p
+_param.parametrisation_run_columns.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_long), ct.c_long, ct.c_long, ct.c_long, ct.c_size_t, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), ct.POINTER(ct.c_ubyte), ct.c_int, ct.c_int]
+_param.parametrisation_run_columns.restype = ct.c_int
+
+# Column names of the input and output tables
+INPUT_COLUMNS  = [_param.parametrisation_column_name(0, i).decode("ascii") for i in range(_param.parametrisation_columns(0))]
+OUTPUT_COLUMNS = [_param.parametrisation_column_name(1, i).decode("ascii") for i in range(_param.parametrisation_columns(1))]
 
 
 # ==============================
@@ -26,107 +46,35 @@ def dilate(cube, mask, objects, cathead, Parameters):
 	dilateChanMax = Parameters["parameters"]["dilateChanMax"]
 	
 	# Stops dilating when (flux_new - flux_old) / flux_new < dilateThreshold
-	sourceIDs = np.unique(mask)
-	# remove first element which should be zero
-	if sourceIDs[0] == 0:
-		sourceIDs = np.delete(sourceIDs,0)
-	
-	for i in range(0, len(sourceIDs)):
-		obj = objects[i]
-		xmin = max(0, obj[list(cathead).index("x_min")] - dilatePixMax)
-		xmax = min(cube.shape[2] - 1, obj[list(cathead).index("x_max")] + dilatePixMax)
-		ymin = max(0, obj[list(cathead).index("y_min")] - dilatePixMax)
-		ymax = min(cube.shape[1] - 1, obj[list(cathead).index("y_max")] + dilatePixMax)
-		zmin = max(0, obj[list(cathead).index("z_min")] - dilateChanMax)
-		zmax = min(cube.shape[0] - 1, obj[list(cathead).index("z_max")] + dilateChanMax)
-		
-		[zmin, zmax, ymin, ymax, xmin, xmax] = map(int, [zmin, zmax, ymin, ymax, xmin, xmax])
-		
-		objcube = cube[zmin:zmax+1, ymin:ymax+1, xmin:xmax+1].copy()
-		objmask = mask[zmin:zmax+1, ymin:ymax+1, xmin:xmax+1].copy()
-		allmask = mask[zmin:zmax+1, ymin:ymax+1, xmin:xmax+1].copy()
-		otherobjs = (allmask > 0) * (allmask != sourceIDs[i])
-		
-		if (otherobjs).sum():
-			# Ensure that objects with different source IDs within dilatePixMax, dilateChanMax are not
-			# included in the flux growth calculation
-			err.warning("Object {0:d} has possible overlapping objects within {1:d} pix, {2:d} chan.".format(sourceIDs[i], dilatePixMax, dilateChanMax))
-			objcube[(allmask > 0) * (allmask != sourceIDs[i])] = 0
-		
-		fluxes = []
-		
-		# Loop through Z dilation kernels until the flux converges or the maximum allowed Z dilation is reached
-		for dilchan in range(dilateChanMax + 1):
-			dd = dilchan * 2 + 1
-			dilstruct = np.ones((dd,1,1))
-			fluxes.append(objcube[nd.morphology.binary_dilation(objmask==sourceIDs[i], structure=dilstruct)].sum())
-			if dilchan > 0 and (fluxes[-1] - fluxes[-2]) / fluxes[-1] < dilateThreshold:
-				dilchan -= 1
-				break
-		# Pick the best Z dilation kernel for current object and update mask
-		dd = dilchan * 2 + 1
-		dilstruct = np.ones((dd,1,1))
-		# Only grow the mask of object sourceIDs[i] even when other objects are present in objmask
-		objmask[nd.morphology.binary_dilation(objmask==sourceIDs[i], structure=dilstruct).astype(int) == 1] = sourceIDs[i]
-
-		# Loop through XY dilation kernels until the flux converges or the maximum allowed XY dilation is reached
-		for dilpix in range(dilatePixMax + 1):
-			dd = dilpix * 2 + 1
-			dilstruct = (np.sqrt(((np.indices((dd, dd)) - dilpix)**2).sum(axis=0)) <= dilpix).astype(int)
-			dilstruct.resize((1, dilstruct.shape[0], dilstruct.shape[1]))
-			fluxes.append(objcube[nd.morphology.binary_dilation(objmask==sourceIDs[i], structure=dilstruct)].sum())
-			if dilpix > 0 and (fluxes[-1] - fluxes[-2]) / fluxes[-1] < dilateThreshold:
-				dilpix -= 1
-				break
-		# Pick the best XY dilation kernel for current object and update mask
-		dd = dilpix * 2 + 1
-		dilstruct = (np.sqrt(((np.indices((dd, dd)) - dilpix)**2).sum(axis=0)) <= dilpix).astype(int)
-		dilstruct.resize((1, dilstruct.shape[0], dilstruct.shape[1]))
-		# Only grow the mask of object sourceIDs[i] even when other objects are present in objmask
-		objmask[nd.morphology.binary_dilation(objmask==sourceIDs[i], structure=dilstruct).astype(int) == 1] = sourceIDs[i]
-		
-		err.message("Mask of source {0:d} dilated by {2:d} chan and then by {1:d} pix.".format(sourceIDs[i], dilpix, dilchan))
-		# Put back in objmask objects != sourceIDs[i] that may have been inside objmask before 
-		# dilation or may have been temporarily replaced by the dilated object sourceIDs[i]
-		if (otherobjs).sum():
-			objmask[otherobjs] = allmask[otherobjs]
-		mask[zmin:zmax+1, ymin:ymax+1, xmin:xmax+1] = objmask
-		
-		# Update n_pix, x_geo and n_chan
-		n_pix = objmask[objmask == sourceIDs[i]].sum() / sourceIDs[i]
-		ind = np.vstack(np.where(objmask == sourceIDs[i]))
-		cgeo = (ind.sum(axis=1)).astype(float) / float(n_pix)
-		x_geo, y_geo, z_geo = cgeo[2] + xmin, cgeo[1] + ymin, cgeo[0] + zmin
-		zmin, zmax = min(ind[0]), max(ind[0]) + 1
-		n_chan = zmax - zmin
-		
-		# Update n_los
-		objmask[objmask != sourceIDs[i]] = 0
-		maskSumA0 = objmask.sum(axis=0)
-		maskSumA0[maskSumA0 > 1] = 1
-		n_los = maskSumA0.sum()
-		
-
-		del objcube
-		del objmask
-		del allmask
-		del otherobjs
+	cathead = list(cathead)
+	objects = np.array(objects, dtype=float)
+	sourceIDs = objects[:, cathead.index("id")].astype(np.int64)
+	bbox = objects[:, [cathead.index(c) for c in ["x_min", "x_max", "y_min", "y_max", "z_min", "z_max"]]].astype(np.int64)
+	
+	# Sources are dilated in order of increasing ID, such that the mask of
+	# a source can only grow into pixels not yet taken by another source.
+	mask, dil, cgeo, n_pix, n_chan, n_los, overlap = stat.dilate_sources(cube, mask, sourceIDs, bbox, dilateChanMax, dilatePixMax, dilateThreshold)
+	
+	for i in range(len(sourceIDs)):
+		# Flux of other objects within dilatePixMax, dilateChanMax was not included in the flux growth calculation
+		if overlap[i]: err.warning("Object {0:d} has possible overlapping objects within {1:d} pix, {2:d} chan.".format(sourceIDs[i], dilatePixMax, dilateChanMax))
+		err.message("Mask of source {0:d} dilated by {2:d} chan and then by {1:d} pix.".format(sourceIDs[i], int(dil[i, 1]), int(dil[i, 0])))
+	
+	dilchan = dil[:, 0].astype(np.int64)
+	dilpix  = dil[:, 1].astype(np.int64)
+	objects[:, cathead.index("x_min")]  = np.maximum(0, bbox[:, 0] - dilpix)
+	objects[:, cathead.index("x_max")]  = np.minimum(cube.shape[2] - 1, bbox[:, 1] + dilpix)
+	objects[:, cathead.index("y_min")]  = np.maximum(0, bbox[:, 2] - dilpix)
+	objects[:, cathead.index("y_max")]  = np.minimum(cube.shape[1] - 1, bbox[:, 3] + dilpix)
+	objects[:, cathead.index("z_min")]  = np.maximum(0, bbox[:, 4] - dilchan)
+	objects[:, cathead.index("z_max")]  = np.minimum(cube.shape[0] - 1, bbox[:, 5] + dilchan)
+	objects[:, cathead.index("n_pix")]  = n_pix
+	objects[:, cathead.index("n_chan")] = n_chan
+	objects[:, cathead.index("n_los")]  = n_los
+	objects[:, cathead.index("x_geo")]  = cgeo[:, 0]
+	objects[:, cathead.index("y_geo")]  = cgeo[:, 1]
+	objects[:, cathead.index("z_geo")]  = cgeo[:, 2]
 	
-		objects[i,list(cathead).index("x_min")]  = max(0, obj[list(cathead).index("x_min")] - dilpix)
-		objects[i,list(cathead).index("x_max")]  = min(cube.shape[2] - 1, obj[list(cathead).index("x_max")] + dilpix)
-		objects[i,list(cathead).index("y_min")]  = max(0, obj[list(cathead).index("y_min")] - dilpix)
-		objects[i,list(cathead).index("y_max")]  = min(cube.shape[1] - 1, obj[list(cathead).index("y_max")] + dilpix)
-		objects[i,list(cathead).index("z_min")]  = max(0, obj[list(cathead).index("z_min")] - dilchan)
-		objects[i,list(cathead).index("z_max")]  = min(cube.shape[0] - 1, obj[list(cathead).index("z_max")] + dilchan)
-		objects[i,list(cathead).index("n_pix")]  = n_pix
-		objects[i,list(cathead).index("n_chan")] = n_chan
-		objects[i,list(cathead).index("n_los")]  = n_los
-		objects[i,list(cathead).index("x_geo")]  = x_geo
-		objects[i,list(cathead).index("y_geo")]  = y_geo
-		objects[i,list(cathead).index("z_geo")]  = z_geo
-		
-		
-        
 	return mask, objects
 
 
@@ -136,52 +84,45 @@ def dilate(cube, mask, objects, cathead, Parameters):
 # ==========================================
 
 def parametrise(cube, mask, objects, cathead, catformt, catparunits, Parameters, dunits):
-	cathead = np.array(cathead)
-	objects = np.array(objects)
-	initcatalog = cp.PySourceCatalog()
-	
-	for obj in objects:
-		# Check flags
-		source_flag = create_source_flags(cube, mask, cathead, obj[cathead == "id"], obj[cathead == "x_min"], obj[cathead == "x_max"], obj[cathead == "y_min"], obj[cathead == "y_max"], obj[cathead == "z_min"], obj[cathead == "z_max"])
-		
-		newSource = cp.PySource()
-		newSource.ID = obj[cathead == "id"]
-		newParamsDict = {
-			"flag": cp.PyMeasurement("flag", source_flag, 0.0, ""),
-			"x": cp.PyMeasurement("x", obj[cathead == "x_geo"], 0.0, ""),
-			"y": cp.PyMeasurement("y", obj[cathead == "y_geo"], 0.0, ""),
-			"z": cp.PyMeasurement("z", obj[cathead == "z_geo"], 0.0, ""),
-			"x_min": cp.PyMeasurement("x_min", obj[cathead == "x_min"], 0.0, ""),
-			"x_max": cp.PyMeasurement("x_max", obj[cathead == "x_max"], 0.0, ""),
-			"y_min": cp.PyMeasurement("y_min", obj[cathead == "y_min"], 0.0, ""),
-			"y_max": cp.PyMeasurement("y_max", obj[cathead == "y_max"], 0.0, ""),
-			"z_min": cp.PyMeasurement("z_min", obj[cathead == "z_min"], 0.0, ""),
-			"z_max": cp.PyMeasurement("z_max", obj[cathead == "z_max"], 0.0, "")
-			}
-		newSource.setParameters(newParamsDict)
-		initcatalog.insert(newSource)
-	
-	moduleParametrizer = cp.PyModuleParametrisation()
-	moduleParametrizer.setFlags(Parameters["parameters"]["optimiseMask"], Parameters["parameters"]["fitBusyFunction"])
-	
-	cube = cube.astype("<f4", copy=False)
-	mask = mask.astype("<i2", copy=False)
-	
-	moduleParametrizer.run(cube, mask, initcatalog)
-	results = moduleParametrizer.getCatalog()
-	
-	# Append the results to the objects array or reset
+	cathead = list(cathead)
+	objects = np.array(objects, dtype=float)
+	if objects.ndim == 1: objects = objects.reshape((-1, len(cathead)))
+	
+	cube = np.ascontiguousarray(cube, dtype=np.float32)
+	# Labels are passed on as long integers, i.e. the same type as used
+	# by the linker, so the linked mask is not copied or truncated.
+	mask = np.ascontiguousarray(mask, dtype=np.int_)
+	
+	# Fill input table, one contiguous column per parameter
+	inputCol = {"id": "id", "x": "x_geo", "y": "y_geo", "z": "z_geo"}
+	table = np.empty((len(INPUT_COLUMNS), objects.shape[0]))
+	for j, name in enumerate(INPUT_COLUMNS):
+		if name != "flag": table[j] = objects[:, cathead.index(inputCol.get(name, name))]
+	bbox = table[[INPUT_COLUMNS.index(name) for name in ("x_min", "x_max", "y_min", "y_max", "z_min", "z_max")]].T
+	table[INPUT_COLUMNS.index("flag")] = stat.source_flags(cube, mask, table[INPUT_COLUMNS.index("id")], bbox)
+	
+	# Output table is pre-filled with the existing parameters, as the
+	# module only writes those parameters that it actually measured.
 	replParam = ["x_min", "x_max", "y_min", "y_max", "z_min", "z_max", "id", "x", "y", "z", "n_pix"]
-	origParam = ["x_min", "x_max", "y_min", "y_max", "z_min", "z_max", "id", "x", "y", "z", "n_pix"]
-	d = results.getSources()
-	
-	# Select data set with maximum number of parameters
-	parsListLen = [len(d[list(d.keys())[i]].getParameters()) for i in range(0, len(d))]
-	index = parsListLen.index(max(parsListLen))
+	results = np.empty((len(OUTPUT_COLUMNS), objects.shape[0]))
+	results.fill(np.nan)
+	for j, name in enumerate(OUTPUT_COLUMNS):
+		if name in replParam and name in cathead: results[j] = objects[:, cathead.index(name)]
+	defined = np.zeros(len(OUTPUT_COLUMNS), dtype=np.uint8)
+	
+	status = _param.parametrisation_run_columns(
+		cube.ctypes.data_as(ct.POINTER(ct.c_float)),
+		mask.ctypes.data_as(ct.POINTER(ct.c_long)),
+		ct.c_long(cube.shape[2]), ct.c_long(cube.shape[1]), ct.c_long(cube.shape[0]),
+		ct.c_size_t(objects.shape[0]),
+		table.ctypes.data_as(ct.POINTER(ct.c_double)),
+		results.ctypes.data_as(ct.POINTER(ct.c_double)),
+		defined.ctypes.data_as(ct.POINTER(ct.c_ubyte)),
+		ct.c_int(Parameters["parameters"]["optimiseMask"]),
+		ct.c_int(Parameters["parameters"]["fitBusyFunction"]))
+	err.ensure(status == 0, "Parameterisation of sources failed.")
 	
 	# Add parameter names from parameterisation
-	pars = d[list(d.keys())[index]].getParameters()
-	cathead = list(cathead)
 	newunits = {
 		"id": "-",
 		"flag": "-",
@@ -232,34 +173,20 @@ def parametrise(cube, mask, objects, cathead, catformt, catparunits, Parameters,
 	catformt = list(catformt)
 	catparunits = list(catparunits)
 	
-	for i in sorted(pars):
-		if i not in replParam:
+	columns = []
+	for i in sorted(OUTPUT_COLUMNS):
+		if not defined[OUTPUT_COLUMNS.index(i)]: continue
+		if i in replParam:
+			objects[:, cathead.index(i)] = results[OUTPUT_COLUMNS.index(i)]
+		else:
 			cathead.append(i)
 			catformt.append("%12.4f")
 			catparunits.append(newunits[i])
+			columns.append(results[OUTPUT_COLUMNS.index(i)])
 	
 	# Extend the parameter array
-	tmpObjects = np.empty((objects.shape[0], len(cathead)))
-	tmpObjects[:, :] = np.nan
-	tmpObjects[:, 0:objects.shape[1]] = objects
-	objects = tmpObjects
-	
-	for i in d:
-		source_dict = d[i].getParameters()
-		
-		# Check source index
-		ID = int(source_dict["id"].getValue())
-		IDind = cathead.index("id")
-		
-		ind = np.where(objects[:,IDind]==ID)[0][0]
-
-		for j in sorted(source_dict):
-			if j in replParam:
-				objects[ind][cathead.index(origParam[replParam.index(j)])] = source_dict[j].getValue()
-			else:
-				objects[ind][cathead.index(j)] = source_dict[j].getValue()
+	if columns: objects = np.column_stack([objects] + columns)
 	
-	objects = np.array(objects)
 	cathead = np.array(cathead)
 	catparunits = np.array(catparunits)
 	catformt = np.array(catformt)
@@ -304,37 +231,6 @@ def parametrise(cube, mask, objects, cathead, catformt, catparunits, Parameters,
 
 
 
-# ===============================
-# FUNCTION: Generate source flags
-# ===============================
-
-def create_source_flags(cube, mask, cathead, obj_id, x_min, x_max, y_min, y_max, z_min, z_max):
-	flag = 0
-	[z_min, z_max, y_min, y_max, x_min, x_max] = map(int, [z_min, z_max, y_min, y_max, x_min, x_max])
-	
-	# Check spatial boundaries
-	if x_min == 0 or x_max == cube.shape[2] or y_min == 0 or y_max == cube.shape[1]:
-		flag |= 1
-	
-	# Check spectral boundaries
-	if z_min == 0 or z_max == cube.shape[0]:
-		flag |= 2
-	
-	# Check for NaN and other sources
-	obj_cube = cube[z_min:z_max+1, y_min:y_max+1, x_min:x_max+1].copy()
-	obj_mask = mask[z_min:z_max+1, y_min:y_max+1, x_min:x_max+1].copy()
-	dil = nd.morphology.binary_dilation(obj_mask==obj_id, structure=np.ones([3, 3, 3]))
-	dil_values = obj_cube[dil]
-	dil_masked = obj_mask[dil]
-	if np.isnan(dil_values).any():
-		flag |= 4
-	if(dil_masked[dil_masked > 0] != obj_id).any():
-		flag |= 8
-	
-	return flag
-
-
-
 # ==================================================
 # FUNCTION: Derive linker parameters from input mask
 # ==================================================
@@ -356,66 +252,27 @@ def parameters_from_mask(dict_Header, mask):
 	catParUnits = np.array(catParUnits)
 	catParFormt = np.array(catParFormt)
 	
-	# Create object array from index mask
-	indices = np.unique(mask).astype(int)
-	
-	# Remove first element if it is zero
-	if indices[0] == 0:
-		indices = np.delete(indices, 0)
+	# Measure basic properties of all sources in a single sweep across the mask
+	ids, bbox, centroid, n_pix, n_los = stat.region_properties(mask)
 	
 	# Make object array
-	objects = np.empty((len(indices), len(catParNames)))
+	objects = np.empty((len(ids), len(catParNames)))
 	objects[:,:] = np.nan
 	
 	# Fill with object parameters needed for parameterisation
-	for i in range(len(indices)):
-				# Add object IDs
-				objects[i, catParNames=="id"] = indices[i]
-				# Add boundaries and geometric centre
-				xmin, xmax, ymin, ymax, zmin, zmax, xgeo, ygeo, zgeo, n_pix, n_los, n_chan = src_params_from_mask(mask, indices[i])
-				objects[i, catParNames=="x_min"] = xmin
-				objects[i, catParNames=="x_max"] = xmax
-				objects[i, catParNames=="y_min"] = ymin
-				objects[i, catParNames=="y_max"] = ymax
-				objects[i, catParNames=="z_min"] = zmin
-				objects[i, catParNames=="z_max"] = zmax
-				objects[i, catParNames=="x_geo"] = xgeo
-				objects[i, catParNames=="y_geo"] = ygeo
-				objects[i, catParNames=="z_geo"] = zgeo
-				objects[i, catParNames=="n_pix"] = n_pix
-				objects[i, catParNames=="n_chan"] = n_chan
-				objects[i, catParNames=="n_los"] = n_los
+	# (upper boundaries are exclusive, i.e. max + 1)
+	objects[:, catParNames == "id"]     = ids[:, np.newaxis]
+	objects[:, catParNames == "x_min"]  = bbox[:, 0:1]
+	objects[:, catParNames == "x_max"]  = bbox[:, 1:2] + 1
+	objects[:, catParNames == "y_min"]  = bbox[:, 2:3]
+	objects[:, catParNames == "y_max"]  = bbox[:, 3:4] + 1
+	objects[:, catParNames == "z_min"]  = bbox[:, 4:5]
+	objects[:, catParNames == "z_max"]  = bbox[:, 5:6] + 1
+	objects[:, catParNames == "x_geo"]  = centroid[:, 0:1]
+	objects[:, catParNames == "y_geo"]  = centroid[:, 1:2]
+	objects[:, catParNames == "z_geo"]  = centroid[:, 2:3]
+	objects[:, catParNames == "n_pix"]  = n_pix[:, np.newaxis]
+	objects[:, catParNames == "n_chan"] = bbox[:, 5:6] + 1 - bbox[:, 4:5]
+	objects[:, catParNames == "n_los"]  = n_los[:, np.newaxis]
 	
 	return catParNames, catParUnits, catParFormt, objects, dunits
-
-
-
-# ===================================================
-# FUNCTION: Extract basic source parameters from mask
-# ===================================================
-
-def src_params_from_mask(mask, ID):
-	# Get coordinates of pixels, that contain the selected ID
-	indices = np.vstack(np.where(mask==ID))
-	
-	# Min and max (x,y,z) values represent the bounding boxes
-	xmin, xmax = min(indices[2]), max(indices[2]) + 1
-	ymin, ymax = min(indices[1]), max(indices[1]) + 1
-	zmin, zmax = min(indices[0]), max(indices[0]) + 1
-	
-	# Total number of pixes in the source
-	n_pix = indices.shape[1]
-	
-	# Geometric center
-	cgeo = (indices.sum(axis=1)).astype(float) / float(n_pix)
-	xgeo, ygeo, zgeo = cgeo[2], cgeo[1], cgeo[0]
-	
-	# Number of lines of sight
-	collapsedMap = mask[zmin:zmax, ymin:ymax, xmin:xmax].sum(axis=0)
-	collapsedMap[collapsedMap > 0] = 1
-	n_los = collapsedMap.sum()
-	
-	# Number of channels
-	n_chan = zmax - zmin
-	
-	return xmin, xmax, ymin, ymax, zmin, zmax, xgeo, ygeo, zgeo, n_pix, n_los, n_chan
@@ -2,8 +2,8 @@
 
 import math
 import numpy as np
-from scipy import ndimage
 from sofia.functions import GetRMS
+from sofia import statistics as stat
 from sofia import error as err
 
 
@@ -12,27 +12,106 @@ from sofia import error as err
 # FUNCTION: Implementation of the S+C finder
 # ==========================================
 
-def SCfinder_mem(cube, mask, header, t0, kernels=[[0, 0, 0, "b"],], threshold=3.5, sizeFilter=0, maskScaleXY=2.0, maskScaleZ=2.0, kernelUnit="pixel", edgeMode="constant", rmsMode="negative", fluxRange="all", verbose=0):
+def SCfinder_mem(cube, mask, header, t0, kernels=[[0, 0, 0, "b"],], threshold=3.5, sizeFilter=0, maskScaleXY=2.0, maskScaleZ=2.0, kernelUnit="pixel", edgeMode="constant", rmsMode="negative", fluxRange="all", cacheSize=-1, verbose=0):
 	# Define a few constants
 	FWHM_CONST    = 2.0 * math.sqrt(2.0 * math.log(2.0))   # Conversion between sigma and FWHM of Gaussian function
 	MAX_PIX_CONST = 1.0e+6                                 # Maximum number of pixels for noise calculation; sampling is set accordingly
 	
+	# Ensure that the S+C filters can operate on native-endian, single-precision data
+	err.ensure(edgeMode in stat.EDGE_MODES, "Illegal edge mode for S+C finder: '" + str(edgeMode) + "'.")
+	data = stat.as_native(cube)
+	
+	# Mask flags used both for clipping and for recording detections
+	if (mask.dtype == np.bool_ or mask.dtype == np.uint8) and mask.flags["C_CONTIGUOUS"]:
+		flags = mask.view(np.uint8)
+	else:
+		flags = (mask > 0).view(np.uint8)
+	
 	# Check for NaN in cube
-	found_nan = np.isnan(cube).any()
+	found_nan = stat.check_nan(data)
 	
 	# Set sampling sampleRms for rms measurement
-	sampleRms = max(1, int((float(cube.size) / MAX_PIX_CONST)**(1.0 / min(3, len(cube.shape)))))
+	sampleRms = max(1, int((float(data.size) / MAX_PIX_CONST)**(1.0 / min(3, len(data.shape)))))
 	
 	# Measure noise in original cube with sampling "sampleRms"
-	rms = GetRMS(cube, rmsMode=rmsMode, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=verbose, sample=sampleRms)
+	rms = GetRMS(data, rmsMode=rmsMode, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=verbose, sample=sampleRms)
+	
+	# Schedule kernels, grouping consecutive ones by spatial size
+	schedule = SCschedule(kernels, header, kernelUnit, verbose)
+	
+	# Allocate a single scratch cube to be re-used for all kernels
+	cube_smooth = np.empty(data.shape, dtype=np.float32)
+	cube_spatial = None
+	changed = np.zeros(data.shape[0], dtype=np.uint8)
+	
+	# Loop over all groups of kernels with the same spatial size
+	for (kx, ky), group in schedule:
+		# Cache the spatially smoothed cube if the group has more than one kernel and memory permits
+		use_cache = len(group) > 1 and kx + ky > 0 and (cacheSize < 0 or data.nbytes <= cacheSize * 1024 * 1024)
+		if use_cache and cube_spatial is None:
+			cube_spatial = np.empty(data.shape, dtype=np.float32)
+		elif not use_cache:
+			cube_spatial = None
+		
+		for i, (kz, kt) in enumerate(group):
+			if verbose:
+				err.linebreak()
+				err.print_progress_time(t0)
+				err.message("    Filter {0:} {1:} {2:} {3:} ...".format(kx, ky, kz, kt))
+			
+			# Copy original cube into scratch cube, replacing NaNs with zero and clipping
+			# pixels already detected, and smooth spatially; if cached, only update those
+			# channels in which new pixels were detected by the previous kernel
+			if use_cache:
+				if i == 0:
+					stat.sc_smooth_xy(cube_spatial, data, flags, maskScaleXY * rms, kx / FWHM_CONST, ky / FWHM_CONST, edge_mode=edgeMode)
+				elif changed.any():
+					stat.sc_smooth_xy(cube_spatial, data, flags, maskScaleXY * rms, kx / FWHM_CONST, ky / FWHM_CONST, edge_mode=edgeMode, planes=changed)
+				elif verbose:
+					err.message("    Re-using spatially smoothed cube ...")
+				np.copyto(cube_smooth, cube_spatial)
+			else:
+				stat.sc_smooth_xy(cube_smooth, data, flags, maskScaleXY * rms, kx / FWHM_CONST, ky / FWHM_CONST, edge_mode=edgeMode)
+			
+			# Spectral smoothing
+			if kz:
+				if   kt == "b": stat.filter_boxcar_z(cube_smooth, kz, edge_mode=edgeMode)
+				elif kt == "g": stat.filter_gauss_z(cube_smooth, kz / FWHM_CONST, edge_mode=edgeMode)
+			
+			# Re-insert the NaNs taken out earlier
+			if found_nan:
+				stat.sc_restore_nan(cube_smooth, data)
+			
+			# Calculate the RMS of the smoothed cube:
+			rms_smooth = GetRMS(cube_smooth, rmsMode=rmsMode, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=verbose, sample=sampleRms)
+			
+			# Add pixels above threshold to mask by setting bit 1
+			changed[:] = 0
+			stat.sc_update_mask(flags, cube_smooth, threshold * rms_smooth, changed)
+	
+	# Delete smoothed cubes again
+	del cube_smooth, cube_spatial
+	
+	# Copy detections back into mask if it could not be updated in place
+	if not np.may_share_memory(flags, mask):
+		np.bitwise_or(mask, flags, out=mask, casting="unsafe")
+	
+	return
+
+
+
+# =================================================================
+# FUNCTION: Group consecutive S+C kernels of equal spatial size; the
+#           order of kernels is preserved, as each kernel clips the
+#           pixels detected by the previous ones. Returns a list of
+#           ((kx, ky), [(kz, kt), ...]) in pixels
+# =================================================================
+
+def SCschedule(kernels, header, kernelUnit="pixel", verbose=0):
+	schedule = []
 	
-	# Loop over all kernels
 	for kernel in kernels:
 		[kx, ky, kz, kt] = kernel
-		if verbose:
-			err.linebreak()
-			err.print_progress_time(t0)
-			err.message("    Filter {0:} {1:} {2:} {3:} ...".format(kx, ky, kz, kt))
 		if kernelUnit == "world" or kernelUnit == "w":
 			if verbose: err.message("    Converting filter size to pixels ...")
 			kx = abs(float(kx) / header["CDELT1"])
@@ -42,37 +121,9 @@ def SCfinder_mem(cube, mask, header, t0, kernels=[[0, 0, 0, "b"],], threshold=3.
 			if kz != int(math.ceil(kz)) and verbose: err.warning("Rounding width of boxcar z kernel to next integer.")
 			kz = int(math.ceil(kz))
 		
-		# Create a copy of the original cube
-		cube_smooth = np.copy(cube)
-		
-		# Replace all NaNs with zero
-		if found_nan:
-			cube_smooth[np.isnan(cube)] = 0.0
-		
-		cube_smooth[(cube_smooth > 0) & (mask > 0)] = maskScaleXY * rms
-		cube_smooth[(cube_smooth < 0) & (mask > 0)] = -maskScaleXY * rms
-		
-		# Spatial smoothing
-		if kx + ky:
-			cube_smooth = ndimage.filters.gaussian_filter(cube_smooth, [0, ky / FWHM_CONST, kx / FWHM_CONST], mode=edgeMode)
-		
-		# Spectral smoothing
-		if kz:
-			if   kt == "b": cube_smooth = ndimage.filters.uniform_filter1d(cube_smooth, kz, axis=0, mode=edgeMode)
-			elif kt == "g": cube_smooth = ndimage.filters.gaussian_filter1d(cube_smooth, kz / FWHM_CONST, axis=0, mode=edgeMode)
-		
-		# Re-insert the NaNs taken out earlier
-		if found_nan:
-			cube_smooth[np.isnan(cube)] = np.nan
-		
-		# Calculate the RMS of the smoothed cube:
-		rms_smooth = GetRMS(cube_smooth, rmsMode=rmsMode, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=verbose, sample=sampleRms)
-		
-		# Add pixels above threshold to mask by setting bit 1
-		with np.errstate(invalid="ignore"):
-			mask |= (np.absolute(cube_smooth) >= threshold * rms_smooth)
-			#mask = np.bitwise_or(mask, np.greater_equal(np.absolute(cube_smooth), threshold * rms_smooth))
-		
-		# Delete smoothed cube again
-		del cube_smooth
-	return
+		if schedule and schedule[-1][0] == (kx, ky):
+			schedule[-1][1].append((kz, kt))
+		else:
+			schedule.append(((kx, ky), [(kz, kt)]))
+	
+	return schedule
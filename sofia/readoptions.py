@@ -171,6 +171,7 @@ def allowedDataTypes():
 	        "SCfind.fluxRange": "string", \
 	        "SCfind.kernels": "array", \
 	        "SCfind.kernelUnit": "string", \
+	        "SCfind.cacheSize": "int", \
 	        "SCfind.verbose": "bool", \
 	        "CNHI.pReq": "float", \
 	        "CNHI.qReq": "float", \
@@ -183,6 +184,7 @@ def allowedDataTypes():
 	        "wavelet.scaleZ": "int", \
 	        "wavelet.positivity": "bool", \
 	        "wavelet.iterations": "int", \
+	        "wavelet.memoryLimit": "int", \
 	        "threshold.threshold": "float", \
 	        "threshold.clipMethod": "string", \
 	        "threshold.rmsMode": "string", \
@@ -219,5 +221,6 @@ def allowedDataTypes():
 	        "writeCat.basename": "string", \
 	        "writeCat.writeASCII": "bool", \
 	        "writeCat.writeXML": "bool", \
+	        "writeCat.binaryXML": "bool", \
 	        "writeCat.writeSQL": "bool", \
 	        "writeCat.parameters": "array" }
@@ -5,6 +5,7 @@ import numpy as np
 from scipy.interpolate import InterpolatedUnivariateSpline
 from sofia.functions import GetRMS
 from sofia import error as err
+from sofia import statistics as stat
 
 """
 Function to read in a cube and scale it by the RMS. This is useful to correct for variation in noise as
@@ -23,9 +24,12 @@ Parameters
   gridSpatial:     Size of each spatial grid cell for local RMS measurement. Must be even.
   gridSpectral:    Size of each spectral grid cell for local RMS measurement. Must be even.
   interpolation:   Interpolate values between grid points? Can be "none", "linear" or "cubic"
+  noiseCube:       Return full-size noise cube? If False, None is returned instead, and except
+                   for cubic interpolation the data are divided by the noise on the fly without
+                   creating a full-size noise cube.
 """
 
-def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0, edgeZ=0, statistic="mad", fluxRange="all", method="global", windowSpatial=20, windowSpectral=20, gridSpatial=0, gridSpectral=0, interpolation="none"):
+def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0, edgeZ=0, statistic="mad", fluxRange="all", method="global", windowSpatial=20, windowSpectral=20, gridSpatial=0, gridSpectral=0, interpolation="none", noiseCube=True):
 	# Print some informational messages
 	err.message("Generating noise-scaled data cube:")
 	err.message("  Selecting " + str(method) + " noise measurement method.")
@@ -75,29 +79,38 @@ def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0,
 		radiusWindowSpatial = windowSpatial // 2
 		radiusWindowSpectral = windowSpectral // 2
 		
-		# Create empty cube (filled with NaN) to hold noise values
-		rms_cube = np.full(cube.shape, np.nan, dtype=cube.dtype)
-		
-		# Determine RMS across window centred on grid cell
-		for z in gridPointsZ:
-			for y in gridPointsY:
-				for x in gridPointsX:
-					grid = (max(0, z - radiusGridSpectral), min(dimensions[0], z + radiusGridSpectral + 1), max(0, y - radiusGridSpatial), min(dimensions[1], y + radiusGridSpatial + 1), max(0, x - radiusGridSpatial), min(dimensions[2], x + radiusGridSpatial + 1))
-					
-					window = (max(0, z - radiusWindowSpectral), min(dimensions[0], z + radiusWindowSpectral + 1), max(0, y - radiusWindowSpatial), min(dimensions[1], y + radiusWindowSpatial + 1), max(0, x - radiusWindowSpatial), min(dimensions[2], x + radiusWindowSpatial + 1))
-					
-					if not np.all(np.isnan(cube[window[0]:window[1], window[2]:window[3], window[4]:window[5]])):
-						if interpolation == "linear" or interpolation == "cubic":
-							# Write value into grid point for later interpolation
-							rms_cube[z, y, x] = GetRMS(cube[window[0]:window[1], window[2]:window[3], window[4]:window[5]], rmsMode=statistic, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=0)
-						else:
-							# Fill entire grid cell
-							rms_cube[grid[0]:grid[1], grid[2]:grid[3], grid[4]:grid[5]] = GetRMS(cube[window[0]:window[1], window[2]:window[3], window[4]:window[5]], rmsMode=statistic, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=0)
-					del grid, window
-		
-		# Carry out interpolation if requested, taking NaNs into account
+		# Measure noise in window centred on each grid point
+		if statistic == "mad" or statistic == "std":
+			# Native rolling measurement, parallelised over rows of grid points
+			rms_grid, n_empty = stat.local_noise(cube, gridPointsX, gridPointsY, gridPointsZ, radiusWindowSpatial, radiusWindowSpectral, statistic=statistic, flux_range=fluxRange)
+			err.ensure(n_empty == 0, "Cannot measure noise from " + str(fluxRange) + " flux values.\nNo " + str(fluxRange) + " fluxes found in at least one window.")
+		else:
+			rms_grid = np.full((gridPointsZ.size, gridPointsY.size, gridPointsX.size), np.nan)
+			for k, z in enumerate(gridPointsZ):
+				for j, y in enumerate(gridPointsY):
+					for i, x in enumerate(gridPointsX):
+						window = (max(0, z - radiusWindowSpectral), min(dimensions[0], z + radiusWindowSpectral + 1), max(0, y - radiusWindowSpatial), min(dimensions[1], y + radiusWindowSpatial + 1), max(0, x - radiusWindowSpatial), min(dimensions[2], x + radiusWindowSpatial + 1))
+						if not np.all(np.isnan(cube[window[0]:window[1], window[2]:window[3], window[4]:window[5]])):
+							rms_grid[k, j, i] = GetRMS(cube[window[0]:window[1], window[2]:window[3], window[4]:window[5]], rmsMode=statistic, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=0)
+						del window
+		
 		if interpolation == "linear" or interpolation == "cubic":
 			err.message("  Interpolating in between grid points (" + str(interpolation) + ").")
+		
+		if interpolation != "cubic":
+			# Divide by noise per grid cell or interpolated linearly in between grid points
+			if cube.dtype == np.float32 and cube.flags.c_contiguous and cube.flags.writeable:
+				rms_cube = stat.local_noise_apply(cube, rms_grid, gridPointsX, gridPointsY, gridPointsZ, radiusGridSpatial, radiusGridSpectral, interpolate=(interpolation == "linear"), noise_cube=noiseCube)
+			else:
+				rms_cube = stat.local_noise_apply(None, rms_grid, gridPointsX, gridPointsY, gridPointsZ, radiusGridSpatial, radiusGridSpectral, interpolate=(interpolation == "linear"), shape=cube.shape, noise_cube=True)
+				cube /= rms_cube
+				if not noiseCube: rms_cube = None
+		else:
+			# Create empty cube (filled with NaN) to hold noise values
+			rms_cube = np.full(cube.shape, np.nan, dtype=np.float32)
+			
+			# Write values into grid points for spline interpolation, taking NaNs into account
+			rms_cube[np.ix_(gridPointsZ, gridPointsY, gridPointsX)] = rms_grid
 			
 			# First across each spatial plane
 			if gridSpatial > 1:
@@ -107,30 +120,18 @@ def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0,
 						not_nan = np.logical_not(np.isnan(data_values))
 						if any(not_nan):
 							interp_coords = np.arange(0, dimensions[2])
-							if interpolation == "cubic":
-								spline = InterpolatedUnivariateSpline(gridPointsX[not_nan], data_values[not_nan])
-								rms_cube[z, y, 0:dimensions[2]] = spline(interp_coords)
-								del spline
-							else:
-								interp_values = np.interp(interp_coords, gridPointsX[not_nan], data_values[not_nan])
-								rms_cube[z, y, 0:dimensions[2]] = interp_values
-								del interp_values
-							del interp_coords
+							spline = InterpolatedUnivariateSpline(gridPointsX[not_nan], data_values[not_nan])
+							rms_cube[z, y, 0:dimensions[2]] = spline(interp_coords)
+							del spline, interp_coords
 						del data_values, not_nan
 					for x in range(dimensions[2]):
 						data_values   = rms_cube[z, gridPointsY, x]
 						not_nan = np.logical_not(np.isnan(data_values))
 						if any(not_nan):
 							interp_coords = np.arange(0, dimensions[1])
-							if interpolation == "cubic":
-								spline = InterpolatedUnivariateSpline(gridPointsY[not_nan], data_values[not_nan])
-								rms_cube[z, 0:dimensions[1], x] = spline(interp_coords)
-								del spline
-							else:
-								interp_values = np.interp(interp_coords, gridPointsY[not_nan], data_values[not_nan])
-								rms_cube[z, 0:dimensions[1], x] = interp_values
-								del interp_values
-							del interp_coords
+							spline = InterpolatedUnivariateSpline(gridPointsY[not_nan], data_values[not_nan])
+							rms_cube[z, 0:dimensions[1], x] = spline(interp_coords)
+							del spline, interp_coords
 						del data_values, not_nan
 					# Alternative option: 2-D spatial interpolation using SciPy's interp2d
 					#from scipy.interpolate import interp2d
@@ -149,26 +150,20 @@ def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0,
 						not_nan = np.logical_not(np.isnan(data_values))
 						if any(not_nan):
 							interp_coords = np.arange(0, dimensions[0])
-							if interpolation == "cubic":
-								spline = InterpolatedUnivariateSpline(gridPointsZ[not_nan], data_values[not_nan])
-								rms_cube[0:dimensions[0], y, x] = spline(interp_coords)
-								del spline
-							else:
-								interp_values = np.interp(interp_coords, gridPointsZ[not_nan], data_values[not_nan])
-								rms_cube[0:dimensions[0], y, x] = interp_values
-								del interp_values
-							del interp_coords
+							spline = InterpolatedUnivariateSpline(gridPointsZ[not_nan], data_values[not_nan])
+							rms_cube[0:dimensions[0], y, x] = spline(interp_coords)
+							del spline, interp_coords
 						del data_values, not_nan
-		
-		# Replace any invalid RMS values with NaN
-		with np.errstate(invalid="ignore"):
-			rms_cube[rms_cube <= 0] = np.nan
-		
-		# Divide data cube by RMS cube
-		cube /= rms_cube
-		
-		# Delete the RMS cube again to release its memory
-		#del rms_cube
+			
+			# Replace any invalid RMS values with NaN
+			with np.errstate(invalid="ignore"):
+				rms_cube[rms_cube <= 0] = np.nan
+			
+			# Divide data cube by RMS cube
+			cube /= rms_cube
+			
+			# Delete the RMS cube again to release its memory
+			if not noiseCube: rms_cube = None
 	
 	# GLOBAL noise measurement on entire 2D plane (faster and more memory-friendly)
 	else:
@@ -183,8 +178,10 @@ def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0,
 		# Make sure edges don't exceed cube size
 		err.ensure(z1 < z2 and y1 < y2 and x1 < x2, "Edge size exceeds cube size for at least one axis.")
 		
-		# Create empty cube (filled with 1) to hold noise values
-		rms_cube = np.ones(cube.shape, dtype=cube.dtype)
+		# Noise values of planes perpendicular to each axis (1 if not scaled)
+		rms_z = np.ones(dimensions[0])
+		rms_y = np.ones(dimensions[1])
+		rms_x = np.ones(dimensions[2])
 		
 		# Measure noise across 2D planes and scale cube accordingly
 		if scaleZ:
@@ -192,7 +189,7 @@ def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0,
 				if not np.all(np.isnan(cube[i, y1:y2, x1:x2])):
 					rms = GetRMS(cube[i, y1:y2, x1:x2], rmsMode=statistic, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=0)
 					if rms > 0:
-						rms_cube[i, :, :] *= rms
+						rms_z[i] = rms
 						cube[i, :, :] /= rms
 		
 		if scaleY:
@@ -200,7 +197,7 @@ def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0,
 				if not np.all(np.isnan(cube[z1:z2, i, x1:x2])):
 					rms = GetRMS(cube[z1:z2, i, x1:x2], rmsMode=statistic, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=0)
 					if rms > 0:
-						rms_cube[:, i, :] *= rms
+						rms_y[i] = rms
 						cube[:, i, :] /= rms
 		
 		if scaleX:
@@ -208,8 +205,19 @@ def sigma_scale(cube, scaleX=False, scaleY=False, scaleZ=True, edgeX=0, edgeY=0,
 				if not np.all(np.isnan(cube[z1:z2, y1:y2, i])):
 					rms = GetRMS(cube[z1:z2, y1:y2, i], rmsMode=statistic, fluxRange=fluxRange, zoomx=1, zoomy=1, zoomz=1, verbose=0)
 					if rms > 0:
-						rms_cube[:, :, i] *= rms
+						rms_x[i] = rms
 						cube[:, :, i] /= rms
+		
+		# Create noise cube from the per-plane values only if requested
+		rms_cube = None
+		if noiseCube:
+			rms_cube = np.ones(cube.shape, dtype=cube.dtype)
+			if scaleZ: rms_cube *= rms_z[:, np.newaxis, np.newaxis]
+			if scaleY: rms_cube *= rms_y[np.newaxis, :, np.newaxis]
+			if scaleX: rms_cube *= rms_x[np.newaxis, np.newaxis, :]
+	
+	# Cube has been modified in place
+	stat.forget(cube)
 	
 	err.message("Noise-scaled data cube generated.\n")
 	
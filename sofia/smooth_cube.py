@@ -2,6 +2,7 @@
 
 import numpy as np
 from scipy import ndimage
+from sofia import statistics as stat
 from sofia import error as err
 
 
@@ -44,7 +45,7 @@ def smooth(indata, kernel, edgeMode, kernelX, kernelY, kernelZ):
 	outdata = np.copy(indata)
 	
 	# Remove NaNs (and INFs) if necessary
-	found_nan = np.isnan(indata).sum()
+	found_nan = stat.count_nan(indata)
 	if found_nan: outdata = np.nan_to_num(outdata)
 	
 	# Smooth with the selected kernel
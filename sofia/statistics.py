@@ -1,6 +1,7 @@
 import os
 import numpy as np
 import ctypes as ct
+import weakref
 
 
 
@@ -18,8 +19,8 @@ _stat = ct.CDLL(os.environ["SOFIA_MODULE_PATH"] + "/sofia/_statistics.so")
 
 # Check for NaN
 # -------------
-_stat.check_nan.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t]
-_stat.check_nan.restype = ct.c_uint
+_stat.contains_nan.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t]
+_stat.contains_nan.restype = ct.c_uint
 
 # Set mask based on threshold
 # ---------------------------
@@ -41,6 +42,11 @@ _stat.median.restype = ct.c_float
 _stat.mad.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t, ct.c_float]
 _stat.mad.restype = ct.c_float
 
+# Noise of individual spectra
+# ---------------------------
+_stat.mad_spectra.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_double), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_double]
+_stat.mad_spectra.restype = None
+
 # Summation
 # ---------
 _stat.sum.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t, ct.c_uint]
@@ -51,6 +57,65 @@ _stat.sum.restype = ct.c_double
 _stat.moment.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_uint, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double)]
 _stat.moment.restype = ct.POINTER(ct.c_double)
 
+# S+C finder: preparation, spatial smoothing and mask update
+# ----------------------------------------------------------
+_stat.sc_smooth_xy.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_float), ct.POINTER(ct.c_ubyte), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_float, ct.c_double, ct.c_double, ct.c_int, ct.POINTER(ct.c_ubyte)]
+_stat.sc_smooth_xy.restype = None
+_stat.sc_update_mask.argtypes = [ct.POINTER(ct.c_ubyte), ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_float, ct.POINTER(ct.c_ubyte)]
+_stat.sc_update_mask.restype = ct.c_size_t
+_stat.sc_restore_nan.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_float), ct.c_size_t]
+_stat.sc_restore_nan.restype = None
+
+# Separable convolution filters
+# -----------------------------
+_stat.filter_gauss_xy.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_double, ct.c_double, ct.c_int]
+_stat.filter_gauss_xy.restype = None
+_stat.filter_gauss_z.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_double, ct.c_int]
+_stat.filter_gauss_z.restype = None
+_stat.filter_boxcar_z.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_int]
+_stat.filter_boxcar_z.restype = None
+
+# Wavelet denoiser: a-trous convolution and thresholding
+# ------------------------------------------------------
+_stat.atrous_x.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t]
+_stat.atrous_x.restype = None
+_stat.atrous_y.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t]
+_stat.atrous_y.restype = None
+_stat.atrous_z.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t]
+_stat.atrous_z.restype = None
+_stat.wavelet_threshold.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_float), ct.POINTER(ct.c_ubyte), ct.c_size_t, ct.c_float, ct.c_int, ct.c_ubyte]
+_stat.wavelet_threshold.restype = None
+_stat.median_abs.argtypes = [ct.POINTER(ct.c_float), ct.c_size_t]
+_stat.median_abs.restype = ct.c_float
+
+# Properties of labelled regions
+# ------------------------------
+_stat.label_range.argtypes = [ct.POINTER(ct.c_int32), ct.c_size_t, ct.POINTER(ct.c_int32), ct.POINTER(ct.c_int32)]
+_stat.label_range.restype = ct.c_size_t
+_stat.region_props.argtypes = [ct.POINTER(ct.c_int32), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_int32, ct.c_size_t, ct.POINTER(ct.c_int64), ct.POINTER(ct.c_double), ct.POINTER(ct.c_uint64), ct.POINTER(ct.c_uint64)]
+_stat.region_props.restype = None
+_stat.dilate_sources.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_int64), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.POINTER(ct.c_int64), ct.POINTER(ct.c_int64), ct.c_size_t, ct.c_size_t, ct.c_double, ct.POINTER(ct.c_uint64), ct.POINTER(ct.c_double), ct.POINTER(ct.c_uint64), ct.POINTER(ct.c_uint64), ct.POINTER(ct.c_uint64), ct.POINTER(ct.c_ubyte)]
+_stat.dilate_sources.restype = None
+_stat.source_flags.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_int64), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.POINTER(ct.c_int64), ct.POINTER(ct.c_int64), ct.POINTER(ct.c_ubyte)]
+_stat.source_flags.restype = None
+
+# Local noise measurement on a grid
+# ---------------------------------
+_stat.local_noise.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_double), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.POINTER(ct.c_int64), ct.c_size_t, ct.POINTER(ct.c_int64), ct.c_size_t, ct.POINTER(ct.c_int64), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_int, ct.c_int]
+_stat.local_noise.restype = ct.c_size_t
+_stat.local_noise_apply.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_float), ct.POINTER(ct.c_double), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.POINTER(ct.c_int64), ct.c_size_t, ct.POINTER(ct.c_int64), ct.c_size_t, ct.POINTER(ct.c_int64), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_int]
+_stat.local_noise_apply.restype = None
+
+# FITS ingest
+# -----------
+_stat.ingest_plane.argtypes = [ct.POINTER(ct.c_float), ct.POINTER(ct.c_float), ct.c_size_t, ct.c_size_t, ct.c_size_t, ct.c_int, ct.c_double, ct.c_double, ct.POINTER(ct.c_float)]
+_stat.ingest_plane.restype = ct.c_size_t
+
+# Kernel density estimation
+# -------------------------
+_stat.kde_evaluate.argtypes = [ct.POINTER(ct.c_double), ct.c_size_t, ct.POINTER(ct.c_double), ct.c_size_t, ct.c_size_t, ct.POINTER(ct.c_double), ct.c_double, ct.POINTER(ct.c_double)]
+_stat.kde_evaluate.restype = None
+
 # Memory de-allocation
 # --------------------
 _stat.free_memory.argtypes = [ct.POINTER(ct.c_double)]
@@ -58,10 +123,29 @@ _stat.free_memory.restype = None
 
 
 
+# ===================================================
+# Edge modes of convolution filters (see statistics.h)
+# ===================================================
+
+EDGE_MODES = {
+	"constant": 0,
+	"reflect":  1,
+	"nearest":  2,
+	"mirror":   3,
+	"wrap":     4}
+
+
+
 # ========================
 # Python function wrappers
 # ========================
 
+# Native-endian, C-contiguous copy (or view) of data
+# --------------------------------------------------
+def as_native(data, dtype=np.float32):
+	return np.ascontiguousarray(data, dtype=dtype)
+
+
 # Check for NaN
 # -------------
 def check_nan(data):
@@ -71,8 +155,12 @@ def check_nan(data):
 	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
 	arg_size = ct.c_size_t(data.size)
 	
+	# Use NaN count recorded on ingest if available
+	info = cube_info(data)
+	if info is not None: return int(info["n_nan"] > 0)
+	
 	# Call C function
-	return _stat.check_nan(arg_data, arg_size)
+	return _stat.contains_nan(arg_data, arg_size)
 
 
 # Set mask based on threshold
@@ -154,6 +242,29 @@ def mad(data, flux_range="all", cadence=1, value=np.nan):
 	return _stat.mad(arg_data, arg_size, arg_value)
 
 
+# Robust noise of each spectrum (MAD about 0 converted to standard
+# deviation), with optional second pass clipped at clip times the
+# result of the first pass; returns 2-D array of noise values
+# -----------------------------------------------------------------
+def mad_spectra(data, clip=5.0):
+	global _stat
+	
+	# Prepare arguments
+	data = as_native(data)
+	rms = np.empty((data.shape[1], data.shape[2]), dtype=np.float64)
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_rms  = rms.ctypes.data_as(ct.POINTER(ct.c_double))
+	nx = ct.c_size_t(data.shape[2])
+	ny = ct.c_size_t(data.shape[1])
+	nz = ct.c_size_t(data.shape[0])
+	arg_clip = ct.c_double(clip)
+	
+	# Call C function
+	_stat.mad_spectra(arg_data, arg_rms, nx, ny, nz, arg_clip)
+	
+	return rms
+
+
 # Summation
 # ---------
 def sum(data):
@@ -210,6 +321,406 @@ def moment(data, mom=0, mom0=None, mom1=None):
 	return moment_map
 
 
+# S+C finder: copy data into work array, replacing NaN with 0 and
+# clipping masked pixels to +/- clip, followed by spatial smoothing;
+# if planes is given, only channels with planes[z] != 0 are updated
+# ------------------------------------------------------------------
+def sc_smooth_xy(work, data, mask, clip, sigma_x, sigma_y, edge_mode="constant", planes=None):
+	global _stat
+	
+	# Prepare arguments
+	arg_work = work.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_mask = mask.ctypes.data_as(ct.POINTER(ct.c_ubyte))
+	nx = ct.c_size_t(data.shape[2])
+	ny = ct.c_size_t(data.shape[1])
+	nz = ct.c_size_t(data.shape[0])
+	arg_clip = ct.c_float(clip)
+	arg_sigma_x = ct.c_double(sigma_x)
+	arg_sigma_y = ct.c_double(sigma_y)
+	arg_edge = ct.c_int(EDGE_MODES[edge_mode])
+	if planes is not None: arg_planes = planes.ctypes.data_as(ct.POINTER(ct.c_ubyte))
+	else: arg_planes = None
+	
+	# Call C function
+	return _stat.sc_smooth_xy(arg_work, arg_data, arg_mask, nx, ny, nz, arg_clip, arg_sigma_x, arg_sigma_y, arg_edge, arg_planes)
+
+
+# S+C finder: add pixels above threshold to mask, flagging channels
+# with new detections in changed; returns number of pixels added
+# -----------------------------------------------------------------
+def sc_update_mask(mask, data, threshold, changed=None):
+	global _stat
+	
+	# Prepare arguments
+	arg_mask = mask.ctypes.data_as(ct.POINTER(ct.c_ubyte))
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	nx = ct.c_size_t(data.shape[2])
+	ny = ct.c_size_t(data.shape[1])
+	nz = ct.c_size_t(data.shape[0])
+	arg_threshold = ct.c_float(threshold)
+	if changed is not None: arg_changed = changed.ctypes.data_as(ct.POINTER(ct.c_ubyte))
+	else: arg_changed = None
+	
+	# Call C function
+	return _stat.sc_update_mask(arg_mask, arg_data, nx, ny, nz, arg_threshold, arg_changed)
+
+
+# S+C finder: re-insert NaN of data into work array
+# -------------------------------------------------
+def sc_restore_nan(work, data):
+	global _stat
+	
+	# Prepare arguments
+	arg_work = work.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_size = ct.c_size_t(data.size)
+	
+	# Call C function
+	return _stat.sc_restore_nan(arg_work, arg_data, arg_size)
+
+
+# In-place Gaussian filter across spatial planes
+# ----------------------------------------------
+def filter_gauss_xy(data, sigma_x, sigma_y, edge_mode="constant"):
+	global _stat
+	
+	# Prepare arguments
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	nx = ct.c_size_t(data.shape[2])
+	ny = ct.c_size_t(data.shape[1])
+	nz = ct.c_size_t(data.shape[0])
+	arg_sigma_x = ct.c_double(sigma_x)
+	arg_sigma_y = ct.c_double(sigma_y)
+	arg_edge = ct.c_int(EDGE_MODES[edge_mode])
+	
+	# Call C function
+	return _stat.filter_gauss_xy(arg_data, nx, ny, nz, arg_sigma_x, arg_sigma_y, arg_edge)
+
+
+# In-place Gaussian filter along spectral axis
+# --------------------------------------------
+def filter_gauss_z(data, sigma, edge_mode="constant"):
+	global _stat
+	
+	# Prepare arguments
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	nx = ct.c_size_t(data.shape[2])
+	ny = ct.c_size_t(data.shape[1])
+	nz = ct.c_size_t(data.shape[0])
+	arg_sigma = ct.c_double(sigma)
+	arg_edge = ct.c_int(EDGE_MODES[edge_mode])
+	
+	# Call C function
+	return _stat.filter_gauss_z(arg_data, nx, ny, nz, arg_sigma, arg_edge)
+
+
+# In-place boxcar filter along spectral axis
+# ------------------------------------------
+def filter_boxcar_z(data, width, edge_mode="constant"):
+	global _stat
+	
+	# Prepare arguments
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	nx = ct.c_size_t(data.shape[2])
+	ny = ct.c_size_t(data.shape[1])
+	nz = ct.c_size_t(data.shape[0])
+	arg_width = ct.c_size_t(width)
+	arg_edge = ct.c_int(EDGE_MODES[edge_mode])
+	
+	# Call C function
+	return _stat.filter_boxcar_z(arg_data, nx, ny, nz, arg_width, arg_edge)
+
+
+# A-trous convolution of data with kernel along the given axis
+# (0 = z, 1 = y, 2 = x) with periodic boundaries; the kernel taps
+# are step pixels apart, and the result is written to out
+# --------------------------------------------------------------
+def atrous(out, data, kernel, step, axis):
+	global _stat
+	
+	# Select C function
+	func = (_stat.atrous_z, _stat.atrous_y, _stat.atrous_x)[axis]
+	
+	# Prepare arguments
+	kernel = as_native(kernel)
+	arg_out = out.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	nx = ct.c_size_t(data.shape[2])
+	ny = ct.c_size_t(data.shape[1])
+	nz = ct.c_size_t(data.shape[0])
+	arg_kernel = kernel.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_size = ct.c_size_t(kernel.size)
+	arg_step = ct.c_size_t(step)
+	
+	# Call C function
+	return func(arg_out, arg_data, nx, ny, nz, arg_kernel, arg_size, arg_step)
+
+
+# Hard thresholding of wavelet coefficients with multi-resolution
+# support; mrs holds the support of up to eight sub-bands per byte,
+# and bit selects the sub-band to be used
+# -----------------------------------------------------------------
+def wavelet_threshold(reconstruction, coeff, mrs, threshold, fix_mrs=False, bit=1):
+	global _stat
+	
+	# Prepare arguments
+	arg_reconstruction = reconstruction.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_coeff = coeff.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_mrs = mrs.ctypes.data_as(ct.POINTER(ct.c_ubyte))
+	arg_size = ct.c_size_t(coeff.size)
+	arg_threshold = ct.c_float(threshold)
+	arg_fix_mrs = ct.c_int(int(fix_mrs))
+	arg_bit = ct.c_ubyte(bit)
+	
+	# Call C function
+	return _stat.wavelet_threshold(arg_reconstruction, arg_coeff, arg_mrs, arg_size, arg_threshold, arg_fix_mrs, arg_bit)
+
+
+# Median of absolute values without copying the data
+# ---------------------------------------------------
+def median_abs(data):
+	global _stat
+	
+	# Prepare arguments
+	arg_data = data.ctypes.data_as(ct.POINTER(ct.c_float))
+	arg_size = ct.c_size_t(data.size)
+	
+	# Call C function
+	return _stat.median_abs(arg_data, arg_size)
+
+
+# Properties of all labelled regions in a mask, measured in a single
+# sweep; returns the labels present in the mask in ascending order,
+# their inclusive bounding boxes (x_min, x_max, y_min, y_max, z_min,
+# z_max), geometric centroids (x, y, z) and their numbers of pixels
+# and lines of sight
+# ------------------------------------------------------------------
+def region_properties(mask):
+	global _stat
+	
+	# Prepare arguments
+	mask = as_native(mask, dtype=np.int32)
+	label_min = ct.c_int32(0)
+	label_max = ct.c_int32(0)
+	
+	# Determine range of labels
+	if not _stat.label_range(mask.ctypes.data_as(ct.POINTER(ct.c_int32)), ct.c_size_t(mask.size), ct.byref(label_min), ct.byref(label_max)):
+		return np.zeros(0, dtype=np.int64), np.zeros((0, 6), dtype=np.int64), np.zeros((0, 3)), np.zeros(0, dtype=np.uint64), np.zeros(0, dtype=np.uint64)
+	
+	# Map sparse labels onto dense range to limit size of tables
+	if label_max.value - label_min.value >= mask.size:
+		labels = np.unique(mask)
+		labels = labels[labels != 0].astype(np.int64)
+		dense = (np.searchsorted(labels, mask) + 1).astype(np.int32)
+		dense[mask == 0] = 0
+		mask = dense
+		label_min.value = 1
+	else:
+		labels = np.arange(label_min.value, label_max.value + 1, dtype=np.int64)
+	
+	# Create output arrays
+	bbox     = np.empty((labels.size, 6), dtype=np.int64)
+	centroid = np.empty((labels.size, 3), dtype=np.float64)
+	n_pix    = np.empty(labels.size, dtype=np.uint64)
+	n_los    = np.empty(labels.size, dtype=np.uint64)
+	
+	# Call C function
+	_stat.region_props(mask.ctypes.data_as(ct.POINTER(ct.c_int32)), ct.c_size_t(mask.shape[2]), ct.c_size_t(mask.shape[1]), ct.c_size_t(mask.shape[0]), label_min, ct.c_size_t(labels.size), bbox.ctypes.data_as(ct.POINTER(ct.c_int64)), centroid.ctypes.data_as(ct.POINTER(ct.c_double)), n_pix.ctypes.data_as(ct.POINTER(ct.c_uint64)), n_los.ctypes.data_as(ct.POINTER(ct.c_uint64)))
+	
+	# Discard labels not present in mask
+	present = n_pix > 0
+	return labels[present], bbox[present], centroid[present], n_pix[present], n_los[present]
+
+
+# Dilate the masks of the given sources (with positive labels ids and
+# bounding boxes bbox as returned by region_properties) until the
+# relative flux increase drops below threshold, first spectrally by up
+# to chan_max channels and then spatially by up to pix_max pixels;
+# returns the mask (modified in place if already of native int64
+# type), the number of channels and pixels by which each source was
+# dilated, the new geometric centroids, numbers of pixels, channels
+# and lines of sight, and whether other sources were nearby
+# --------------------------------------------------------------------
+def dilate_sources(data, mask, ids, bbox, chan_max, pix_max, threshold):
+	global _stat
+	
+	# Prepare arguments
+	data = as_native(data)
+	mask = as_native(mask, dtype=np.int64)
+	ids  = as_native(ids, dtype=np.int64)
+	bbox = as_native(bbox, dtype=np.int64)
+	
+	# Create output arrays
+	dil      = np.empty((ids.size, 2), dtype=np.uint64)
+	centroid = np.empty((ids.size, 3), dtype=np.float64)
+	n_pix    = np.empty(ids.size, dtype=np.uint64)
+	n_chan   = np.empty(ids.size, dtype=np.uint64)
+	n_los    = np.empty(ids.size, dtype=np.uint64)
+	overlap  = np.empty(ids.size, dtype=np.uint8)
+	
+	# Call C function
+	_stat.dilate_sources(data.ctypes.data_as(ct.POINTER(ct.c_float)), mask.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(mask.shape[2]), ct.c_size_t(mask.shape[1]), ct.c_size_t(mask.shape[0]), ct.c_size_t(ids.size), ids.ctypes.data_as(ct.POINTER(ct.c_int64)), bbox.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(chan_max), ct.c_size_t(pix_max), ct.c_double(threshold), dil.ctypes.data_as(ct.POINTER(ct.c_uint64)), centroid.ctypes.data_as(ct.POINTER(ct.c_double)), n_pix.ctypes.data_as(ct.POINTER(ct.c_uint64)), n_chan.ctypes.data_as(ct.POINTER(ct.c_uint64)), n_los.ctypes.data_as(ct.POINTER(ct.c_uint64)), overlap.ctypes.data_as(ct.POINTER(ct.c_ubyte)))
+	
+	return mask, dil, centroid, n_pix, n_chan, n_los, overlap.astype(bool)
+
+
+# Flags of the given sources (with labels ids and bounding boxes bbox
+# of x_min, x_max, y_min, y_max, z_min, z_max as in the catalogue):
+# 1 = spatial edge, 2 = spectral edge, 4 = NaN and 8 = other source
+# adjacent to source mask within bounding box
+# --------------------------------------------------------------------
+def source_flags(data, mask, ids, bbox):
+	global _stat
+	
+	# Prepare arguments
+	data = as_native(data)
+	mask = as_native(mask, dtype=np.int64)
+	ids  = as_native(ids, dtype=np.int64)
+	bbox = as_native(bbox, dtype=np.int64)
+	
+	# Create output array
+	flags = np.empty(ids.size, dtype=np.uint8)
+	
+	# Call C function
+	_stat.source_flags(data.ctypes.data_as(ct.POINTER(ct.c_float)), mask.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(mask.shape[2]), ct.c_size_t(mask.shape[1]), ct.c_size_t(mask.shape[0]), ct.c_size_t(ids.size), ids.ctypes.data_as(ct.POINTER(ct.c_int64)), bbox.ctypes.data_as(ct.POINTER(ct.c_int64)), flags.ctypes.data_as(ct.POINTER(ct.c_ubyte)))
+	
+	return flags
+
+
+# Noise ("mad" or "std" about 0) in windows of size 2 * radius_xy + 1
+# spatially and 2 * radius_z + 1 spectrally centred on the grid points
+# given by the coordinates grid_x, grid_y and grid_z; returns array of
+# size n_gz x n_gy x n_gx (NaN for windows without valid data) and the
+# number of windows with valid data but no values in flux range
+# --------------------------------------------------------------------
+def local_noise(data, grid_x, grid_y, grid_z, radius_xy, radius_z, statistic="mad", flux_range="all"):
+	global _stat
+	
+	# Define flux range and statistic values
+	flux_ranges = {
+		"all": 0,
+		"negative": -1,
+		"positive": 1}
+	statistics = {
+		"std": 0,
+		"mad": 1}
+	
+	# Prepare arguments
+	data   = as_native(data)
+	grid_x = as_native(grid_x, dtype=np.int64)
+	grid_y = as_native(grid_y, dtype=np.int64)
+	grid_z = as_native(grid_z, dtype=np.int64)
+	rms    = np.empty((grid_z.size, grid_y.size, grid_x.size), dtype=np.float64)
+	
+	# Call C function
+	n_empty = _stat.local_noise(data.ctypes.data_as(ct.POINTER(ct.c_float)), rms.ctypes.data_as(ct.POINTER(ct.c_double)), ct.c_size_t(data.shape[2]), ct.c_size_t(data.shape[1]), ct.c_size_t(data.shape[0]), grid_x.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(grid_x.size), grid_y.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(grid_y.size), grid_z.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(grid_z.size), ct.c_size_t(radius_xy), ct.c_size_t(radius_z), ct.c_int(statistics[statistic]), ct.c_int(flux_ranges[flux_range]))
+	
+	return rms, n_empty
+
+
+# Divide data (float32, modified in place) by the noise measured on the
+# grid by local_noise(), either across entire grid cells of size 2 *
+# radius_xy + 1 spatially and 2 * radius_z + 1 spectrally or with linear
+# interpolation in between grid points along x, y and z; returns the
+# noise cube if requested, otherwise None. If data is None, only the
+# noise cube is created.
+# ----------------------------------------------------------------------
+def local_noise_apply(data, rms, grid_x, grid_y, grid_z, radius_xy, radius_z, interpolate=False, shape=None, noise_cube=False):
+	global _stat
+	
+	# Prepare arguments
+	if data is not None: shape = data.shape
+	noise  = np.empty(shape, dtype=np.float32) if noise_cube else None
+	rms    = as_native(rms, dtype=np.float64)
+	grid_x = as_native(grid_x, dtype=np.int64)
+	grid_y = as_native(grid_y, dtype=np.int64)
+	grid_z = as_native(grid_z, dtype=np.int64)
+	arg_data  = data.ctypes.data_as(ct.POINTER(ct.c_float)) if data is not None else None
+	arg_noise = noise.ctypes.data_as(ct.POINTER(ct.c_float)) if noise is not None else None
+	
+	# Call C function
+	_stat.local_noise_apply(arg_data, arg_noise, rms.ctypes.data_as(ct.POINTER(ct.c_double)), ct.c_size_t(shape[2]), ct.c_size_t(shape[1]), ct.c_size_t(shape[0]), grid_x.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(grid_x.size), grid_y.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(grid_y.size), grid_z.ctypes.data_as(ct.POINTER(ct.c_int64)), ct.c_size_t(grid_z.size), ct.c_size_t(radius_xy), ct.c_size_t(radius_z), ct.c_int(interpolate))
+	
+	return noise
+
+
+# Copy a single plane of FITS data (2-D, single precision, with con-
+# tiguous rows, e.g. a section of a memory map) into the contiguous
+# native-endian array data, applying scale and zero; returns the num-
+# ber of NaN values and the minimum and maximum of all other values
+# -------------------------------------------------------------------
+def ingest_plane(data, source, scale=1.0, zero=0.0):
+	global _stat
+	
+	# Prepare arguments
+	data_range = np.empty(2, dtype=np.float32)
+	
+	# Call C function
+	n_nan = _stat.ingest_plane(data.ctypes.data_as(ct.POINTER(ct.c_float)), source.ctypes.data_as(ct.POINTER(ct.c_float)), ct.c_size_t(source.shape[1]), ct.c_size_t(source.shape[0]), ct.c_size_t(source.strides[0] // 4), ct.c_int(not source.dtype.isnative), ct.c_double(scale), ct.c_double(zero), data_range.ctypes.data_as(ct.POINTER(ct.c_float)))
+	
+	return n_nan, data_range[0], data_range[1]
+
+
+# Properties of a cube recorded on ingest (number of NaN values,
+# minimum and maximum), keyed by the identity of the array. Entries
+# are dropped automatically when the array is garbage-collected, but
+# any code modifying a cube in place must call forget() on it.
+# -------------------------------------------------------------------
+_cube_info = {}
+
+def remember(data, n_nan, data_min, data_max):
+	key = id(data)
+	_cube_info[key] = (weakref.ref(data, lambda ref: _cube_info.pop(key, None)), {"n_nan": n_nan, "min": data_min, "max": data_max})
+	return
+
+def cube_info(data):
+	entry = _cube_info.get(id(data))
+	if entry is None or entry[0]() is not data: return None
+	return entry[1]
+
+def forget(data):
+	_cube_info.pop(id(data), None)
+	return
+
+
+# Number of NaN values in data
+# ----------------------------
+def count_nan(data):
+	info = cube_info(data)
+	if info is not None: return info["n_nan"]
+	return np.isnan(data).sum()
+
+
+# Minimum and maximum of data, ignoring NaN
+# -----------------------------------------
+def nan_range(data):
+	info = cube_info(data)
+	if info is not None: return info["min"], info["max"]
+	return np.nanmin(data), np.nanmax(data)
+
+
+# Sum of Gaussian kernels centred on points at each of the targets
+# (both arrays of shape (d, n) as used by SciPy), with the kernel
+# given by whiten, the transpose of the Cholesky factor of the in-
+# verse covariance matrix; contributions beyond cutoff kernel widths
+# are neglected and the result is not normalised
+# -------------------------------------------------------------------
+def kde_evaluate(points, targets, whiten, cutoff=8.0):
+	global _stat
+	
+	# Prepare arguments
+	points = as_native(points, dtype=np.float64)
+	targets = as_native(targets, dtype=np.float64)
+	whiten = as_native(whiten, dtype=np.float64)
+	density = np.empty(targets.shape[1], dtype=np.float64)
+	
+	# Call C function
+	_stat.kde_evaluate(points.ctypes.data_as(ct.POINTER(ct.c_double)), ct.c_size_t(points.shape[1]), targets.ctypes.data_as(ct.POINTER(ct.c_double)), ct.c_size_t(targets.shape[1]), ct.c_size_t(points.shape[0]), whiten.ctypes.data_as(ct.POINTER(ct.c_double)), ct.c_double(cutoff), density.ctypes.data_as(ct.POINTER(ct.c_double)))
+	
+	return density
+
+
 # Determine byte order of data
 # ----------------------------
 
@@ -604,7 +604,7 @@ class PyModuleParametrisationInterfaceTests(unittest.TestCase):
 		print 'Testing PyModuleParametrisation: run method type safety'
 		p = cp.PyModuleParametrisation()
 		cube = np.zeros((100, 100, 100), dtype=np.float32)
-		mask = np.zeros((100, 100, 100), dtype=np.int16)
+		mask = np.zeros((100, 100, 100), dtype=np.int_)
 		initcatalog = cp.PySourceCatalog()
 		doMaskOptimization = True
 		doBusyFitting = True
@@ -667,7 +667,7 @@ class PyModuleParametrisationInterfaceTests(unittest.TestCase):
 		
 		
 		cube = np.random.normal(0.0, 0.01, (100, 100, 100)).astype(np.float32)
-		mask = np.zeros((100, 100, 100), dtype=np.int16)
+		mask = np.zeros((100, 100, 100), dtype=np.int_)
 		
 		# add some sources
 		initcatalog = cp.PySourceCatalog()
@@ -0,0 +1,46 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+
+import time
+import unittest
+import numpy as np
+from sofia import pyfind
+
+
+class SCfinderTests(unittest.TestCase):
+	"""This tests the S+C finder against sequential application of its kernels"""
+	
+	kernels = [[0, 0, 0, "b"], [0, 0, 3, "b"], [3, 3, 0, "b"], [3, 3, 3, "b"], [3, 3, 7, "g"], [6, 6, 0, "b"], [6, 6, 3, "b"], [3, 3, 15, "b"]]
+	
+	def makeCube(self):
+		np.random.seed(1)
+		cube = np.random.normal(0.0, 1.0, (48, 64, 64)).astype(np.float32)
+		z, y, x = np.indices(cube.shape)
+		for (z0, y0, x0, s) in ((12, 20, 20, 2.0), (30, 40, 44, 4.0), (20, 50, 12, 3.0)):
+			cube += 1.5 * np.exp(-0.5 * (((x - x0) / s)**2 + ((y - y0) / s)**2 + ((z - z0) / 4.0)**2))
+		cube[5, 10:14, 10:14] = np.nan
+		return cube
+	
+	def sequential(self, cube, cacheSize):
+		mask = np.zeros(cube.shape, dtype=np.bool_)
+		for kernel in self.kernels:
+			pyfind.SCfinder_mem(cube, mask, {}, time.time(), kernels=[kernel], threshold=4.0, rmsMode="std", cacheSize=cacheSize)
+		return mask
+	
+	def testSchedulePreservesOrder(self):
+		schedule = pyfind.SCschedule(self.kernels, {})
+		self.assertEqual([size for (size, group) in schedule], [(0, 0), (3, 3), (6, 6), (3, 3)])
+		self.assertEqual(sum([len(group) for (size, group) in schedule]), len(self.kernels))
+	
+	def testInterleavedKernels(self):
+		cube = self.makeCube()
+		expected = self.sequential(cube, 0)
+		self.assertTrue(expected.any())
+		for cacheSize in (-1, 0):
+			mask = np.zeros(cube.shape, dtype=np.bool_)
+			pyfind.SCfinder_mem(cube, mask, {}, time.time(), kernels=self.kernels, threshold=4.0, rmsMode="std", cacheSize=cacheSize)
+			self.assertTrue(np.array_equal(mask, expected))
+
+
+if __name__ == '__main__':
+	unittest.main()
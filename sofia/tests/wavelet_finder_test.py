@@ -0,0 +1,49 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+
+import unittest
+import numpy as np
+from sofia import wavelet_finder as wf
+
+
+class DenoiseSlabTests(unittest.TestCase):
+	"""This tests that slab mode of the 2D-1D wavelet denoiser respects the memory limit"""
+	
+	memoryLimit = 1
+	
+	def setUp(self):
+		np.random.seed(1)
+		self.data = np.random.normal(0.0, 1.0, (16, 64, 64)).astype(np.float32)
+		self.rows = []
+		self.original = wf._denoise_2d1d
+		
+		def record(data, *args, **kwargs):
+			self.rows.append(data.shape[1])
+			return self.original(data, *args, **kwargs)
+		
+		wf._denoise_2d1d = record
+	
+	def tearDown(self):
+		wf._denoise_2d1d = self.original
+	
+	def rowSize(self, scaleXY, scaleZ):
+		xy_scales, z_scales = wf.scales_2d1d(self.data.shape, scaleXY, scaleZ)
+		return wf.row_size_2d1d(self.data.shape, xy_scales, z_scales)
+	
+	def testDefaultScales(self):
+		"""with automatic scales, the halo exceeds the memory limit and the entire cube must be processed"""
+		wf.denoise_2d1d(self.data, memoryLimit=self.memoryLimit)
+		limit = self.memoryLimit * 1024 * 1024 // self.rowSize(-1, -1)
+		self.assertTrue(limit < self.data.shape[1])
+		self.assertEqual(self.rows, [self.data.shape[1]])
+	
+	def testExplicitScales(self):
+		"""with few spatial scales, each slab must fit into the memory limit"""
+		wf.denoise_2d1d(self.data, scaleXY=2, iterations=1, memoryLimit=self.memoryLimit)
+		limit = self.memoryLimit * 1024 * 1024 // self.rowSize(2, -1)
+		self.assertTrue(len(self.rows) > 1)
+		self.assertTrue(all(rows <= limit for rows in self.rows))
+
+
+if __name__ == '__main__':
+	unittest.main()
@@ -1,50 +1,150 @@
 import numpy as np
 
-#from .pyudwt import Denoise2D1DHardMRS
-from sofia import wavelet as wv
+from sofia import error as err
+from sofia import statistics as stat
 
 b3spline = np.array([1.0, 4.0, 6.0, 4.0, 1.0]) / 16.0
 
-# Try to use MUCH faster median implementation
-# from bottleneck, else fallback to numpy.median
-try:
-	from bottleneck import median as the_median
-except ImportError:
-	the_median = np.median
 
-
-class Denoise2D1DAdaptiveMRS(wv.Denoise2D1DHardMRS):
+class Denoise2D1DAdaptiveMRS(object):
 	"""
 	De-noise a three-dimensional data cube using the 2D1D wavelet
 	transform with a multi-resolution support as discussed in 
 	Starck et al. 2011 and Floeer & Winkel 2012.
 	
 	The transform assumes that the first axis is the spectral axis.
-	"""
 	
-	def __init__(self, sigma, *args, **kwargs):
+	This replaces the former Cython classes WaveletDecomposition2D1D,
+	Denoise2D1DHard and Denoise2D1DHardMRS; the a-trous convolutions
+	and the thresholding are carried out by the multi-threaded C
+	functions of the statistics module. The results are identical.
+	"""
 	
+	def __init__(self, sigma, data, xy_scales=-1, z_scales=-1, total_power=False, xy_approx=False, z_approx=False):
+		
 		self.sigma = sigma
-	
-		self.xy_mother_function = b3spline
-		self.z_mother_function = b3spline
 		
-		super(Denoise2D1DAdaptiveMRS, self).__init__(*args, **kwargs)
+		self.xy_mother_function = b3spline.astype(np.single)
+		self.z_mother_function = b3spline.astype(np.single)
+		
+		self.data = stat.as_native(data)
+		self.work = np.zeros((3,) + self.data.shape, dtype=np.single)
+		self.reconstruction = np.zeros(self.data.shape, dtype=np.single)
+		
+		self.xy_scales, self.z_scales = scales_2d1d(self.data.shape, xy_scales, z_scales)
+		
+		self.total_power = bool(total_power)
+		self.xy_approx = bool(xy_approx)
+		self.z_approx = bool(z_approx)
+		self.positivity = False
+		
+		xy_scale_range = self.xy_scales + int(self.xy_approx)
+		z_scale_range = self.z_scales + int(self.z_approx)
+		self.mrs = np.zeros((xy_scale_range, (z_scale_range + 7) // 8) + self.data.shape, dtype=np.uint8)
+		self.fix_mrs = False
 		
 		self.thresholds = np.zeros((self.xy_scales + 1, self.z_scales + 1))
 	
 	
-	def handle_coefficients(self, work_array, xy_scale, z_scale):
+	def decompose(self):
+		"""
+		Perform one iteration of the wavelet decomposition of the
+		residual between data and current reconstruction. For each
+		combination of spatial and spectral scale, the coefficients are
+		calculated and handle_coefficients is called.
+		"""
 		
-		subband_rms = the_median(np.abs(self.work[work_array])) / 0.6745
-		subband_threshold = subband_rms * self.sigma
+		work = self.work
+		np.subtract(self.data, self.reconstruction, out=work[0])
 		
-		self.thresholds[xy_scale, z_scale] = subband_threshold
+		xy_scale_factor = 1
+		coarse_xy = 0
+		fine_xy = 1
+		
+		for xy_scale in range(self.xy_scales + 1):
+			
+			if xy_scale < self.xy_scales:
+				# Smooth the coarse data spatially; the current coarse scale ends up in fine_xy
+				stat.atrous(work[2], work[coarse_xy], self.xy_mother_function, xy_scale_factor, axis=2)
+				stat.atrous(work[fine_xy], work[2], self.xy_mother_function, xy_scale_factor, axis=1)
+				
+				# Create the wavelet coefficients in coarse_xy and exchange the indices
+				work[coarse_xy] -= work[fine_xy]
+				coarse_xy, fine_xy = fine_xy, coarse_xy
+			else:
+				# In the last iteration, the maximally smoothed spatial
+				# scale is subjected to the spectral decomposition
+				fine_xy = coarse_xy
+			
+			z_scale_factor = 1
+			coarse_z = fine_xy
+			fine_z = 2
+			
+			for z_scale in range(self.z_scales):
+				# Smooth spectrally and create the wavelet coefficients in coarse_z
+				stat.atrous(work[fine_z], work[coarse_z], self.z_mother_function, z_scale_factor, axis=0)
+				work[coarse_z] -= work[fine_z]
+				
+				# Exchange the indices without overwriting coarse_xy
+				if z_scale % 2 == 0:
+					coarse_z = 2
+					fine_z = fine_xy
+				else:
+					coarse_z = fine_xy
+					fine_z = 2
+				
+				self.handle_coefficients(fine_z, xy_scale, z_scale)
+				
+				z_scale_factor *= 2
+			
+			# Handle the smooth scale of the data
+			self.handle_coefficients(coarse_z, xy_scale, self.z_scales)
+			
+			xy_scale_factor *= 2
+		
+		if self.positivity:
+			np.maximum(self.reconstruction, 0.0, out=self.reconstruction)
+	
+	
+	def handle_coefficients(self, work_array, xy_scale, z_scale):
 		
-		super(Denoise2D1DAdaptiveMRS, self).handle_coefficients(work_array, xy_scale, z_scale)
+		if (xy_scale < self.xy_scales or self.xy_approx) and (z_scale < self.z_scales or self.z_approx):
+			subband_rms = stat.median_abs(self.work[work_array]) / 0.6745
+			subband_threshold = subband_rms * self.sigma
+			
+			self.thresholds[xy_scale, z_scale] = subband_threshold
+			
+			stat.wavelet_threshold(self.reconstruction, self.work[work_array], self.mrs[xy_scale, z_scale // 8], subband_threshold, self.fix_mrs, 1 << (z_scale % 8))
+		elif z_scale == self.z_scales and xy_scale == self.xy_scales and self.total_power:
+			self.reconstruction += self.work[work_array]
+
+
+def scales_2d1d(shape, scaleXY=-1, scaleZ=-1):
+	"""
+	Return the number of spatial and spectral scales used by the
+	decomposition of a cube of the given shape (see
+	Denoise2D1DAdaptiveMRS).
+	"""
+	
+	if scaleXY < 0: scaleXY = np.floor(np.log(max(shape[1], shape[2])) / np.log(2.0))
+	if scaleZ < 0: scaleZ = np.floor(np.log(shape[0]) / np.log(2.0))
+	
+	return int(np.floor(scaleXY)), int(np.floor(scaleZ))
+
+
+def row_size_2d1d(shape, xy_scales, z_scales, xy_approx=False, z_approx=False):
+	"""
+	Return the estimated number of bytes required per row along the
+	second axis by denoise_2d1d for a cube of the given shape: data,
+	valid, work (3x), reconstruction and multi-resolution support.
+	"""
+	
+	xy_range = xy_scales + int(bool(xy_approx))
+	z_range = z_scales + int(bool(z_approx))
+	return shape[0] * shape[2] * (4 + 1 + 12 + 4 + xy_range * ((z_range + 7) // 8))
 
 
-def denoise_2d1d(data, threshold=5.0, scaleXY=-1, scaleZ=-1, positivity=True, iterations=3, valid=None, **kwargs):
+def denoise_2d1d(data, threshold=5.0, scaleXY=-1, scaleZ=-1, positivity=True, iterations=3, valid=None, memoryLimit=-1, overwrite=False, **kwargs):
 	"""
 	
 	Inputs
@@ -75,15 +175,29 @@ def denoise_2d1d(data, threshold=5.0, scaleXY=-1, scaleZ=-1, positivity=True, it
 	    False values are set to 0. prior to reconstruction.
 	    Gets deduced from the data if not provided.
 	
+	memoryLimit : int, optional
+	    Maximum amount of memory in MB to be used by the decomposition. If
+	    the decomposition of the entire cube would need more than that, the
+	    cube is processed in overlapping slabs along the second axis (see
+	    denoise_2d1d_slabs). A value of -1 means no limit. The overlap
+	    between slabs grows as 2^scaleXY, so slab mode requires scaleXY to
+	    be set explicitly to a small value; if the overlap does not fit into
+	    the memory limit, the entire cube is processed with a warning.
+	
+	overwrite : bool, optional
+	    If True, the reconstruction is written into data, which must be a
+	    writeable array, and data is returned. This avoids allocating an
+	    additional output array in slab mode.
+	
 	Other arguments are passed to the denoising class. Possible arguments are:
 	    xy_approx : bool
 	        Whether to consider the wavelet sub-bands representing the spatial
 	        approximation during reconstruction
-	
+	    
 	    z_approx : bool
 	        Whether to consider the wavelet sub-bands representing the spectral
 	        approximation during reconstruction
-	
+	    
 	    total_power : bool
 	        Whether to add the smooth approximation to the reconstruction
 	
@@ -95,7 +209,79 @@ def denoise_2d1d(data, threshold=5.0, scaleXY=-1, scaleZ=-1, positivity=True, it
 	    The reconstructed data
 	"""
 	
-	data = np.array(data, dtype=np.single)
+	if memoryLimit >= 0:
+		xy_scales, z_scales = scales_2d1d(data.shape, scaleXY, scaleZ)
+		row_size = row_size_2d1d(data.shape, xy_scales, z_scales, kwargs.get("xy_approx", False), kwargs.get("z_approx", False))
+		
+		# Halo required to make the reconstruction of the core region of
+		# a slab independent of the (periodic) boundaries of the slab; it
+		# can never usefully exceed the size of the cube
+		halo = min(iterations * (2 ** (xy_scales + 1) - 2), data.shape[1])
+		core = int(memoryLimit * 1024 * 1024 // row_size) - 2 * halo
+		
+		if core + 2 * halo < data.shape[1]:
+			# Slabs of at least one row plus halo must fit into the memory
+			# limit, otherwise slab mode would only add overhead by covering
+			# (almost) the entire cube with each slab
+			if core >= 1:
+				return denoise_2d1d_slabs(data, core, halo, threshold, xy_scales, z_scales, positivity, iterations, valid, overwrite, **kwargs)
+			err.warning("Wavelet filter: halo of " + str(halo) + " pixels required for " + str(xy_scales) + " spatial scales does not fit into memory limit.\nProcessing entire cube instead; set scaleXY explicitly to a small value to use slab mode.")
+	
+	reconstruction = _denoise_2d1d(np.array(data, dtype=np.single), threshold, scaleXY, scaleZ, positivity, iterations, valid, **kwargs)
+	
+	if overwrite:
+		data[...] = reconstruction
+		return data
+	return reconstruction
+
+
+def denoise_2d1d_slabs(data, core, halo, threshold, scaleXY, scaleZ, positivity, iterations, valid, overwrite, **kwargs):
+	"""
+	Memory-lean version of denoise_2d1d that processes the cube in slabs
+	of core pixels along the second axis, each extended by halo pixels
+	on either side. Only the core of each slab is written to the output,
+	so peak memory is determined by the slab size rather than the size of
+	the cube. The number of scales must be given explicitly so that all
+	slabs are decomposed in the same way. Note that the noise level of
+	each wavelet sub-band is measured across the slab, and the result
+	will hence differ slightly from that of decomposing the entire cube.
+	
+	If overwrite is True, the reconstruction is written into data, and
+	the original values of the rows needed in the halo of the next slab
+	are retained in a small buffer.
+	"""
+	
+	n_rows = data.shape[1]
+	output = data if overwrite else np.empty(data.shape, dtype=np.single)
+	backup = None
+	
+	err.message("  Processing cube in " + str((n_rows + core - 1) // core) + " slabs of " + str(core) + " + 2 x " + str(halo) + " pixels.")
+	
+	for y0 in range(0, n_rows, core):
+		y1 = min(y0 + core, n_rows)
+		lo = max(y0 - halo, 0)
+		hi = min(y1 + halo, n_rows)
+		
+		slab = np.array(data[:, lo:hi, :], dtype=np.single)
+		if backup is not None: slab[:, :y0 - lo, :] = backup
+		
+		# Retain original rows needed by the next slab before overwriting them
+		if overwrite: backup = slab[:, max(y1 - halo, 0) - lo:y1 - lo, :].copy()
+		
+		slab_valid = None if valid is None else valid[:, lo:hi, :]
+		reconstruction = _denoise_2d1d(slab, threshold, scaleXY, scaleZ, positivity, iterations, slab_valid, **kwargs)
+		output[:, y0:y1, :] = reconstruction[:, y0 - lo:y1 - lo, :]
+		
+		del slab, reconstruction
+	
+	return output
+
+
+def _denoise_2d1d(data, threshold, scaleXY, scaleZ, positivity, iterations, valid, **kwargs):
+	"""
+	Decompose and reconstruct data, which must be a C-contiguous array
+	of native 32-bit floats that may be modified.
+	"""
 	
 	if valid is None:
 		valid = np.isfinite(data)
@@ -10,10 +10,11 @@ import numpy as np
 import scipy.constants
 from astropy import wcs
 from astropy.io import fits
-from astropy import units as u
-from astropy.coordinates import Longitude, Latitude
 from sofia import error as err
 
+# Conversion factor from degrees to hours of right ascension
+DEG_TO_HOUR = 1.0 / 15.0
+
 
 # -------------------------------------
 # ---- FUNCTION TO IMPLEMENT SGN() ----
@@ -107,11 +108,58 @@ def fix_gipsy_header(header_orig):
 			return header
 
 
-def add_wcs_coordinates(objects, catParNames, catParFormt, catParUnits, Parameters):
+# -------------------------------------------------------
+# ---- FUNCTION TO CREATE IAU-COMPLIANT SOURCE NAMES ----
+# -------------------------------------------------------
+
+def sexagesimal(value, precision):
+	# Split values into sign, integer degrees (or hours), integer minutes and
+	# seconds, rounding up and carrying over like astropy's to_string() method
+	value = np.asarray(value, dtype=float)
+	frac, deg = np.modf(np.abs(value))
+	frac, mnt = np.modf(frac * 60.0)
+	sec = frac * 60.0
+	carry = sec >= 60.0 - 10.0**(-precision)
+	sec[carry] = 0.0
+	mnt[carry] += 1.0
+	carry = mnt >= 60.0
+	mnt[carry] = 0.0
+	deg[carry] += 1.0
+	return np.where(np.signbit(value), "-", "+").tolist(), deg.tolist(), mnt.tolist(), sec.tolist()
+
+
+def iau_names(lon, lat, iau_coord, iau_equinox):
+	# Positions are split into sexagesimal fields for all sources at once, so
+	# that only string formatting is left to be done per source
+	lon = np.asarray(lon, dtype=float)
+	lat = np.asarray(lat, dtype=float)
+	
+	if iau_coord == "equ":
+		ra = sexagesimal(np.mod(lon, 360.0) * DEG_TO_HOUR, 2)
+		dec = sexagesimal(lat, 1)
+		return ["SoFiA %s%02.0f%02d%05.2f%s%02.0f%02d%04.1f" % (iau_equinox, h, m, s, sign, d, am, asec) for h, m, s, sign, d, am, asec in zip(ra[1], ra[2], ra[3], dec[0], dec[1], dec[2], dec[3])]
+	
+	return ["SoFiA %s%08.4f%s%07.4f" % (iau_equinox, x, "-" if y < 0.0 else "+", abs(y)) for x, y in zip(lon.tolist(), lat.tolist())]
+
+
+# ----------------------------------------------------------------
+# ---- FUNCTION TO ADD WCS COORDINATES AND NAMES TO CATALOGUE ----
+# ----------------------------------------------------------------
+
+def add_wcs_coordinates(objects, catParNames, catParFormt, catParUnits, Parameters, header=None, subcube=[]):
+	# The header already read by import_data.read_data() can be passed on along
+	# with the sub-cube offsets applied to it; otherwise it is read from file.
 	try:
-		hdulist = fits.open(Parameters["import"]["inFile"])
-		header = hdulist[0].header
-		hdulist.close()
+		if header is None:
+			hdulist = fits.open(Parameters["import"]["inFile"])
+			header = hdulist[0].header
+			hdulist.close()
+		else:
+			# Work on copy of header and undo sub-cube offset, as source positions
+			# refer to the full cube at this point
+			header = header.copy()
+			for axis in range(min(3, header["NAXIS"], len(subcube) // 2)):
+				header["CRPIX%i" % (axis + 1)] += subcube[2 * axis]
 		
 		# Fix headers where "per second" is written "/S" instead of "/s"
 		# (assuming they mean "per second" and not "per Siemens").
@@ -185,8 +233,6 @@ def add_wcs_coordinates(objects, catParNames, catParFormt, catParUnits, Paramete
 		n_src = objects.shape[0]
 		n_par = objects.shape[1]
 		
-		iau_names = np.empty([n_src, 1], dtype=object)
-		
 		if header["ctype1"][:4] == "RA--":
 			# Equatorial coordinates; try to figure out equinox:
 			iau_coord = "equ"
@@ -209,24 +255,10 @@ def add_wcs_coordinates(objects, catParNames, catParFormt, catParUnits, Paramete
 			iau_coord = ""
 			iau_equinox = ""
 		
-		for src in xrange(n_src):
-			lon = objects[src][n_par - 3]
-			lat = objects[src][n_par - 2]
-			
-			if iau_coord == "equ":
-				ra = Longitude(lon, unit=u.deg)
-				dec = Latitude(lat, unit=u.deg)
-				iau_pos = ra.to_string(unit=u.h, decimal=False, sep="", precision=2, alwayssign=False, pad=True, fields=3)
-				iau_pos += dec.to_string(unit=u.deg, decimal=False, sep="", precision=1, alwayssign=True, pad=True, fields=3)
-			else:
-				iau_pos = "{0:08.4f}".format(lon)
-				if lat < 0.0: iau_pos += "-"
-				else: iau_pos += "+"
-				iau_pos += "{0:07.4f}".format(abs(lat))
-			
-			iau_names[src][0] = "SoFiA " + iau_equinox + iau_pos
+		names = np.empty([n_src, 1], dtype=object)
+		names[:,0] = iau_names(objects[:, n_par - 3], objects[:, n_par - 2], iau_coord, iau_equinox)
 		
-		objects = np.concatenate((objects, iau_names), axis = 1)
+		objects = np.concatenate((objects, names), axis = 1)
 		catParUnits = tuple(list(catParUnits) + ["-"])
 		catParNames = tuple(list(catParNames) + ["name"])
 		catParFormt = tuple(list(catParFormt) + ["%30s"])
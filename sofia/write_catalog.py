@@ -2,24 +2,31 @@
 # -*- coding: utf-8 -*-
 
 import os
+import re
+import base64
 import numpy as np
-from xml.etree.ElementTree import Element, SubElement, tostring
-from xml.dom import minidom
+from xml.sax.saxutils import escape
 from gzip import open as gzopen
 from sofia import functions as func
 from sofia import error as err
 from sofia import __version__ as sofia_version
 
 
-# --------------------------------
-# Function to auto-indent XML code
-# --------------------------------
+# Number of catalogue rows formatted and written at a time
+CHUNK_ROWS = 10000
 
-def prettify(elem):
-	# Indent is set to "" here to save disk space; default would be "\t".
-	rough_string = tostring(elem, "utf-8")
-	reparsed = minidom.parseString(rough_string)
-	return reparsed.toprettyxml(indent="")
+
+# --------------------------------------------
+# Function to open catalogue for text output;
+# returns file and function for writing text
+# --------------------------------------------
+
+def openCatalogue(outName, flagCompress):
+	if flagCompress:
+		f = gzopen(outName, "wb")
+		return f, lambda text: f.write(text.encode("utf-8"))
+	f = open(outName, "w")
+	return f, f.write
 
 
 # -----------------------------------
@@ -30,14 +37,15 @@ def sqlHeaderItem(item):
 	return "`" + item + "`"
 
 
-# ---------------------------------
-# Function to create SQL data entry
-# ---------------------------------
+# ------------------------------------------
+# Function to create SQL data entries for an
+# entire column of the catalogue
+# ------------------------------------------
 
-def sqlDataItem(item, dataFormat):
-	if "f" in dataFormat or "e" in dataFormat: return str(float(item))
-	if "i" in dataFormat or "d" in dataFormat: return str(int(item))
-	return "\'" + str(item) + "\'"
+def sqlDataColumn(column, dataFormat):
+	if "f" in dataFormat or "e" in dataFormat: return [str(float(item)) for item in column]
+	if "i" in dataFormat or "d" in dataFormat: return [str(int(item)) for item in column]
+	return ["\'" + str(item) + "\'" for item in column]
 
 
 # -----------------------------------------
@@ -50,11 +58,32 @@ def sqlFormat(item):
 	return " varchar(256) NOT NULL"
 
 
+# ------------------------------------------
+# Function to create XML attribute string
+# ------------------------------------------
+
+def xmlAttributes(attributes):
+	return "".join([" %s=\"%s\"" % (key, escape(str(value), {"\"": "&quot;"})) for key, value in attributes])
+
+
+# --------------------------------------------------------
+# Function to create VOTable BINARY2 record type of the
+# given columns: null flags followed by big-endian values
+# --------------------------------------------------------
+
+def binaryRecordType(catFormat, columns):
+	fields = [("flags", "u1", ((len(columns) + 7) // 8,))]
+	for i, index in enumerate(columns):
+		if "s" in catFormat[index]: fields.append(("c%i" % i, "S30"))
+		else: fields.append(("c%i" % i, ">f8"))
+	return np.dtype(fields)
+
+
 # ----------------------------------
 # Function to write source catalogue
 # ----------------------------------
 
-def write_catalog_from_array(mode, objects, catHeader, catUnits, catFormat, parList, outName, flagCompress, flagOverwrite, flagUncertainties):
+def write_catalog_from_array(mode, objects, catHeader, catUnits, catFormat, parList, outName, flagCompress, flagOverwrite, flagUncertainties, flagBinary=False):
 	# Check output format and compression
 	availableModes = ["ASCII", "XML", "SQL"]
 	if mode not in availableModes:
@@ -84,18 +113,18 @@ def write_catalog_from_array(mode, objects, catHeader, catUnits, catFormat, parL
 		err.error("No valid output parameters selected. No output catalogue written.", fatal=False)
 		return
 	
+	# Extract the requested columns once; the catalogue is then written
+	# in chunks of CHUNK_ROWS rows, each formatted with a single format
+	# string per row, without ever holding the entire output in memory.
+	columns = [list(catHeader).index(par) for par in parList]
+	if not isinstance(objects, np.ndarray): objects = np.array(objects, dtype=object)
+	table = objects.reshape((-1, len(catHeader)))[:, columns]
+	nRows = table.shape[0]
+	
 	
 	# Create and write catalogue in requested format
 	# -------------------------------------------------------------------------
 	if mode == "XML":
-		# Define basic XML header information
-		votable          = Element("VOTABLE")
-		resource         = SubElement(votable, "RESOURCE", name="SoFiA catalogue (version %s)" % sofia_version)
-		description      = SubElement(resource, "DESCRIPTION")
-		description.text = "Source catalogue from the Source Finding Application (SoFiA) version %s" % sofia_version
-		coosys           = SubElement(resource, "COOSYS", ID="J2000")
-		table            = SubElement(resource, "TABLE", ID="sofia_cat", name="sofia_cat")
-		
 		# Load list of parameters and unified content descriptors (UCDs)
 		ucdList = {}
 		fileUcdPath = os.environ["SOFIA_PIPELINE_PATH"]
@@ -109,35 +138,69 @@ def write_catalog_from_array(mode, objects, catHeader, catUnits, catFormat, parL
 		except:
 			err.warning("Failed to read UCD file.")
 		
+		try:
+			f1, write = openCatalogue(outName, flagCompress)
+		except:
+			err.error("Failed to write to XML catalogue: " + outName + ".", fatal=False)
+			return
+		
+		# Write basic XML header information
+		write("<?xml version=\"1.0\" ?>\n<VOTABLE>\n")
+		write("<RESOURCE%s>\n" % xmlAttributes([("name", "SoFiA catalogue (version %s)" % sofia_version)]))
+		write("<DESCRIPTION>%s</DESCRIPTION>\n" % escape("Source catalogue from the Source Finding Application (SoFiA) version %s" % sofia_version))
+		write("<COOSYS ID=\"J2000\"/>\n")
+		write("<TABLE ID=\"sofia_cat\" name=\"sofia_cat\">\n")
+		
 		# Create parameter fields
-		for par in parList:
+		for par, index in zip(parList, columns):
 			ucdEntity = ucdList[par] if par in ucdList else ""
-			index = list(catHeader).index(par)
 			if catFormat[index] == "%30s":
-				field = SubElement(table, "FIELD", name=par, ucd=ucdEntity, datatype="char", arraysize="30", unit=catUnits[index])
+				write("<FIELD%s/>\n" % xmlAttributes([("name", par), ("ucd", ucdEntity), ("datatype", "char"), ("arraysize", "30"), ("unit", catUnits[index])]))
 			else:
-				field = SubElement(table, "FIELD", name=par, ucd=ucdEntity, datatype="float", unit=catUnits[index])
+				write("<FIELD%s/>\n" % xmlAttributes([("name", par), ("ucd", ucdEntity), ("datatype", "double" if flagBinary else "float"), ("unit", catUnits[index])]))
 		
-		# Create data table entries
-		data = SubElement(table, "DATA")
-		tabledata = SubElement(data, "TABLEDATA")
+		write("<DATA>\n")
 		
-		for obj in objects:
-			tr = SubElement(tabledata, "TR")
-			for par in parList:
-				td = SubElement(tr, "TD")
-				index = list(catHeader).index(par)
-				td.text = (catFormat[index] % obj[index]).strip()
+		if flagBinary:
+			# BINARY2 serialisation: records of null flags (set for NaN values) and big-endian
+			# values, base64-encoded; leftover bytes are carried over to the next chunk, as
+			# only multiples of 3 bytes can be encoded without padding.
+			recordType = binaryRecordType(catFormat, columns)
+			numeric = [i for i, index in enumerate(columns) if "s" not in catFormat[index]]
+			leftover = b""
+			write("<BINARY2>\n<STREAM encoding=\"base64\">\n")
+			for row in range(0, nRows, CHUNK_ROWS):
+				chunk = table[row:row + CHUNK_ROWS]
+				records = np.zeros(chunk.shape[0], dtype=recordType)
+				for i, index in enumerate(columns):
+					if i in numeric:
+						values = chunk[:, i].astype(float)
+						records["c%i" % i] = values
+						records["flags"][:, i // 8] |= np.isnan(values).astype("u1") << (7 - i % 8)
+					else:
+						records["c%i" % i] = [(catFormat[index] % value).strip().encode("utf-8") for value in chunk[:, i]]
+				data = leftover + records.tobytes()
+				cut = len(data) - len(data) % 3 if row + CHUNK_ROWS < nRows else len(data)
+				leftover = data[cut:]
+				write(base64.b64encode(data[:cut]).decode("ascii") + "\n")
+			write("</STREAM>\n</BINARY2>\n")
+		elif nRows:
+			# TABLEDATA serialisation: values are formatted without field width, which is the
+			# same as stripping leading and trailing blanks, and strings are escaped beforehand.
+			rowFormat = "<TR>\n" + "".join(["<TD>" + ("%s" if "s" in catFormat[index] else re.sub("^%[0-9]*", "%", catFormat[index])) + "</TD>\n" for index in columns]) + "</TR>\n"
+			strings = [i for i, index in enumerate(columns) if "s" in catFormat[index]]
+			write("<TABLEDATA>\n")
+			for row in range(0, nRows, CHUNK_ROWS):
+				chunk = table[row:row + CHUNK_ROWS].tolist()
+				for values in chunk:
+					for i in strings: values[i] = escape((catFormat[columns[i]] % values[i]).strip())
+				write("".join([rowFormat % tuple(values) for values in chunk]))
+			write("</TABLEDATA>\n")
+		else:
+			write("<TABLEDATA/>\n")
 		
-		# Write XML catalogue:
-		try:
-			f1 = gzopen(outName, "wb") if flagCompress else open(outName, "w")
-		except:
-			err.error("Failed to write to XML catalogue: " + outName + ".", fatal=False)
-			return
-		f1.write(prettify(votable))
-		#f1.write(tostring(votable, "utf-8")) // without prettifying, which is faster and uses much less memory
-		f1.close
+		write("</DATA>\n</TABLE>\n</RESOURCE>\n</VOTABLE>\n")
+		f1.close()
 	
 	# -----------------------------------------------------------------End-XML-
 	
@@ -150,49 +213,31 @@ def write_catalog_from_array(mode, objects, catHeader, catUnits, catFormat, parL
 		content = "-- SoFiA catalogue (version %s)\n\nSET SQL_MODE = \"NO_AUTO_VALUE_ON_ZERO\";\n\n" % sofia_version
 		
 		# Construct and write table structure:
-		flagProgress = False
 		content += "CREATE TABLE IF NOT EXISTS `SoFiA-Catalogue` (\n"
 		if noID: content += "  `id` INT NOT NULL,\n"
-		for par in parList:
-			index = list(catHeader).index(par)
-			if flagProgress: content += ",\n"
-			content += "  " + sqlHeaderItem(par) + sqlFormat(catFormat[index])
-			flagProgress = True
+		content += ",\n".join(["  " + sqlHeaderItem(par) + sqlFormat(catFormat[index]) for par, index in zip(parList, columns)])
 		content += ",\n  PRIMARY KEY (`id`),\n  KEY (`id`)\n) DEFAULT CHARSET=utf8 COMMENT=\'SoFiA source catalogue\';\n\n"
 		
 		# Insert data:
-		flagProgress = False
 		content += "INSERT INTO `SoFiA-Catalogue` ("
 		if noID: content += "`id`, "
-		for par in parList:
-			if flagProgress: content += ", "
-			content += sqlHeaderItem(par)
-			flagProgress = True
+		content += ", ".join([sqlHeaderItem(par) for par in parList])
 		content += ") VALUES\n"
 		
-		source_count = 0
-		for obj in objects:
-			flagProgress = False
-			source_count += 1
-			content += "("
-			if noID: content += str(source_count) + ", "
-			
-			for par in parList:
-				index = list(catHeader).index(par)
-				if flagProgress: content += ", "
-				content += sqlDataItem(obj[index], catFormat[index])
-				flagProgress = True
-			
-			if(source_count < len(objects)): content += "),\n"
-			else: content += ");\n"
-		
 		# Write catalogue
 		try:
-			fp = gzopen(outName, "wb") if flagCompress else open(outName, "w")
+			fp, write = openCatalogue(outName, flagCompress)
 		except:
 			err.error("Failed to write to SQL catalogue: " + outName + ".", fatal=False)
 			return
-		fp.write(content)
+		write(content)
+		
+		for row in range(0, nRows, CHUNK_ROWS):
+			chunk = table[row:row + CHUNK_ROWS]
+			entries = [sqlDataColumn(chunk[:, i], catFormat[index]) for i, index in enumerate(columns)]
+			if noID: entries.insert(0, [str(source_count + 1) for source_count in range(row, row + chunk.shape[0])])
+			write(",\n".join(["(" + ", ".join(values) + ")" for values in zip(*entries)]))
+			write(",\n" if row + CHUNK_ROWS < nRows else ";\n")
 		fp.close()
 	
 	# -----------------------------------------------------------------End-SQL-
@@ -210,8 +255,7 @@ def write_catalog_from_array(mode, objects, catHeader, catUnits, catFormat, parL
 		colCount   =  0
 		header     = "SoFiA catalogue (version %s)\n" % sofia_version
 		
-		for par in parList:
-			index = list(catHeader).index(par)
+		for index in columns:
 			headerName += catHeader[index].rjust(lenCathead[index])
 			headerUnit += catUnits[index].rjust(lenCathead[index])
 			headerCol  += ("(%i)" % (colCount + 1)).rjust(lenCathead[index])
@@ -219,15 +263,13 @@ def write_catalog_from_array(mode, objects, catHeader, catUnits, catFormat, parL
 			colCount += 1
 		header += headerName[3:] + '\n' + headerUnit[3:] + '\n' + headerCol[3:]
 		
-		# Create catalogue
-		outObjects = []
-		for obj in objects:
-			outObjects.append([])
-			for par in parList: outObjects[-1].append(obj[list(catHeader).index(par)])
-		
-		# Write ASCII catalogue
+		# Write ASCII catalogue (in the same format as numpy.savetxt)
 		try:
-			np.savetxt(outName, np.array(outObjects, dtype=object), fmt=outFormat, header=header)
+			fp, write = openCatalogue(outName, flagCompress)
+			write("# " + header.replace("\n", "\n# ") + "\n")
+			for row in range(0, nRows, CHUNK_ROWS):
+				write("".join([outFormat % tuple(values) + "\n" for values in table[row:row + CHUNK_ROWS].tolist()]))
+			fp.close()
 		
 		except:
 			err.error("Failed to write to ASCII catalogue: " + outName + ".", fatal=False)
@@ -287,7 +287,7 @@ if Parameters["steps"]["doSmooth"]:
 
 # ---- NOISE SCALING ----
 if Parameters["steps"]["doScaleNoise"]:
-	np_Cube, noise_cube = sigma_cube.sigma_scale(np_Cube, **Parameters["scaleNoise"])
+	np_Cube, noise_cube = sigma_cube.sigma_scale(np_Cube, noiseCube=Parameters["steps"]["doWriteNoiseCube"], **Parameters["scaleNoise"])
 	if Parameters["pipeline"]["trackMemory"]: print_memory_usage(t0)
 
 # --- WAVELET ---
@@ -296,9 +296,10 @@ if Parameters["steps"]["doWavelet"]:
 	# WARNING: There is a lot of time and memory overhead from transposing the cube forth and back!
 	# WARNING: This will need to be addressed in the future.
 	np_Cube = np.transpose(np_Cube, axes=[2, 1, 0])
-	np_Cube = wavelet_finder.denoise_2d1d(np_Cube, **Parameters["wavelet"])
+	# Reconstruction is written back into the cube if it is a writeable array of native floats
+	np_Cube = wavelet_finder.denoise_2d1d(np_Cube, overwrite=(np_Cube.dtype == np.float32 and np_Cube.flags.writeable), **Parameters["wavelet"])
 	np_Cube = np.transpose(np_Cube, axes=[2, 1, 0])
-	np_Cube = np_Cube.copy()
+	np_Cube = np.ascontiguousarray(np_Cube)
 	if Parameters["pipeline"]["trackMemory"]: print_memory_usage(t0)
 
 # --- FLAG ERRORS ---
@@ -573,6 +574,8 @@ if not NRdet:
 # ---- RELOAD ORIGINAL DATA CUBE FOR PARAMETERISATION IF IT HAS BEEN CHANGED ----
 # -------------------------------------------------------------------------------
 
+# The cube has been altered by smoothing, noise scaling or weighting, so the original values are read again;
+# keeping a copy of the original cube instead would double the peak memory usage.
 if Parameters["steps"]["doSmooth"] or Parameters["steps"]["doScaleNoise"] or Parameters["import"]["weightsFile"] or Parameters["import"]["weightsFunction"]:
 	err.message("Reloading data cube for parameterisation")
 	del np_Cube, dict_Header
@@ -710,7 +713,7 @@ if len(subcube) and object_array_exists:
 
 if Parameters["steps"]["doWriteCat"] and object_array_exists:
 	err.print_progress_message("Adding WCS position to catalogue", t0)
-	objects, catParNames, catParFormt, catParUnits = wcs_coordinates.add_wcs_coordinates(objects, catParNames, catParFormt, catParUnits, Parameters)
+	objects, catParNames, catParFormt, catParUnits = wcs_coordinates.add_wcs_coordinates(objects, catParNames, catParFormt, catParUnits, Parameters, dict_Header, subcube)
 
 
 
@@ -727,7 +730,7 @@ if Parameters["steps"]["doWriteCat"] and object_array_exists:
 		catParFormt=tuple(catParFormt)
 	
 	if Parameters["writeCat"]["writeXML"]:
-		write_catalog.write_catalog_from_array("XML", objects, catParNames, catParUnits, catParFormt, Parameters["writeCat"]["parameters"], outputCatXml, Parameters["writeCat"]["compress"], Parameters["writeCat"]["overwrite"], Parameters["parameters"]["getUncertainties"])
+		write_catalog.write_catalog_from_array("XML", objects, catParNames, catParUnits, catParFormt, Parameters["writeCat"]["parameters"], outputCatXml, Parameters["writeCat"]["compress"], Parameters["writeCat"]["overwrite"], Parameters["parameters"]["getUncertainties"], Parameters["writeCat"]["binaryXML"])
 	
 	if Parameters["writeCat"]["writeASCII"]:
 		write_catalog.write_catalog_from_array("ASCII", objects, catParNames, catParUnits, catParFormt, Parameters["writeCat"]["parameters"], outputCatAscii, Parameters["writeCat"]["compress"], Parameters["writeCat"]["overwrite"], Parameters["parameters"]["getUncertainties"])
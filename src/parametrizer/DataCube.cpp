@@ -74,10 +74,10 @@ template <typename T> int DataCube<T>::createNewCube(long dx, long dy, long dz)
 {
 	this->clear();
 	
-	if(typeid(T) != typeid(char) and typeid(T) != typeid(short) and typeid(T) != typeid(long) and typeid(T) != typeid(float) and typeid(T) != typeid(double))
+	if(typeid(T) != typeid(char) and typeid(T) != typeid(short) and typeid(T) != typeid(int) and typeid(T) != typeid(long) and typeid(T) != typeid(float) and typeid(T) != typeid(double))
 	{
 		std::cerr << "Error (DataCube): Unsupported data type of new cube;\n";
-		std::cerr << "                  must be char, short, long, float, or double.\n";
+		std::cerr << "                  must be char, short, int, long, float, or double.\n";
 		return 1;
 	}
 	
@@ -109,6 +109,7 @@ template <typename T> int DataCube<T>::createNewCube(long dx, long dy, long dz)
 	
 	if(typeid(T)      == typeid(float))  this->setHeader("BITPIX", "-32");
 	else if(typeid(T) == typeid(short))  this->setHeader("BITPIX",  "16");
+	else if(typeid(T) == typeid(int))    this->setHeader("BITPIX",  "32");
 	else if(typeid(T) == typeid(long))   this->setHeader("BITPIX",  "32");
 	else if(typeid(T) == typeid(double)) this->setHeader("BITPIX", "-64");
 	else if(typeid(T) == typeid(char))   this->setHeader("BITPIX",   "8");
@@ -147,10 +148,10 @@ template <typename T> int DataCube<T>::createNewCubeFromPointer(long dx, long dy
 {
 	this->clear();
 	
-	if(typeid(T) != typeid(char) and typeid(T) != typeid(short) and typeid(T) != typeid(long) and typeid(T) != typeid(float) and typeid(T) != typeid(double))
+	if(typeid(T) != typeid(char) and typeid(T) != typeid(short) and typeid(T) != typeid(int) and typeid(T) != typeid(long) and typeid(T) != typeid(float) and typeid(T) != typeid(double))
 	{
 		std::cerr << "Error (DataCube): Unsupported data type of new cube;\n";
-		std::cerr << "                  must be char, short, long, float, or double.\n";
+		std::cerr << "                  must be char, short, int, long, float, or double.\n";
 		return 1;
 	}
 	
@@ -175,6 +176,7 @@ template <typename T> int DataCube<T>::createNewCubeFromPointer(long dx, long dy
 	
 	if(typeid(T)      == typeid(float))  this->setHeader("BITPIX", "-32");
 	else if(typeid(T) == typeid(short))  this->setHeader("BITPIX",  "16");
+	else if(typeid(T) == typeid(int))    this->setHeader("BITPIX",  "32");
 	else if(typeid(T) == typeid(long))   this->setHeader("BITPIX",  "32");
 	else if(typeid(T) == typeid(double)) this->setHeader("BITPIX", "-64");
 	else if(typeid(T) == typeid(char))   this->setHeader("BITPIX",   "8");
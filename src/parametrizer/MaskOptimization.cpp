@@ -4,7 +4,7 @@
 #include "helperFunctions.h"
 #include "MaskOptimization.h"
 
-MaskOptimization::MaskOptimization(long dx, long dy, long dz)
+template <typename T> MaskOptimization<T>::MaskOptimization(long dx, long dy, long dz)
 {
 	dataCube = 0;
 	maskCube = 0;
@@ -26,7 +26,7 @@ MaskOptimization::MaskOptimization(long dx, long dy, long dz)
 
 // Function to optimise mask:
 
-int MaskOptimization::optimize(DataCube<float> *d, DataCube<short> *m, Source *s)
+template <typename T> int MaskOptimization<T>::optimize(DataCube<float> *d, DataCube<T> *m, Source *s)
 {
 	if(loadData(d, m, s) != 0)
 	{
@@ -59,7 +59,7 @@ int MaskOptimization::optimize(DataCube<float> *d, DataCube<short> *m, Source *s
 
 // Function to load and check data:
 
-int MaskOptimization::loadData(DataCube<float> *d, DataCube<short> *m, Source *s)
+template <typename T> int MaskOptimization<T>::loadData(DataCube<float> *d, DataCube<T> *m, Source *s)
 {
 	if(d == 0 or m == 0 or s == 0)
 	{
@@ -169,7 +169,7 @@ int MaskOptimization::loadData(DataCube<float> *d, DataCube<short> *m, Source *s
 // Function to create moment-zero map:
 // WARNING: No cut-off is allowed here, because moment map used later in ellipse-growing!
 
-int MaskOptimization::createMomentMap()
+template <typename T> int MaskOptimization<T>::createMomentMap()
 {
 	long dx = subRegionX2 - subRegionX1 + 1L;
 	long dy = subRegionY2 - subRegionY1 + 1L;
@@ -215,7 +215,7 @@ int MaskOptimization::createMomentMap()
 
 // Function to fit ellipse to moment map:
 
-int MaskOptimization::fitEllipse()
+template <typename T> int MaskOptimization<T>::fitEllipse()
 {
 	if(!momentMap.isDefined())
 	{
@@ -236,6 +236,9 @@ int MaskOptimization::fitEllipse()
 	
 	// Calculate second spatial moments:
 	
+	const double posX = source->getParameter("x");
+	const double posY = source->getParameter("y");
+	
 	for(long x = subRegionX1; x <= subRegionX2; x++)
 	{
 		for(long y = subRegionY1; y < subRegionY2; y++)
@@ -244,9 +247,9 @@ int MaskOptimization::fitEllipse()
 			
 			if(value > 0.0)
 			{
-				momX  += (static_cast<double>(x) - source->getParameter("x")) * (static_cast<double>(x) - source->getParameter("x")) * value;
-				momY  += (static_cast<double>(y) - source->getParameter("y")) * (static_cast<double>(y) - source->getParameter("y")) * value;
-				momXY += (static_cast<double>(x) - source->getParameter("x")) * (static_cast<double>(y) - source->getParameter("y")) * value;
+				momX  += (static_cast<double>(x) - posX) * (static_cast<double>(x) - posX) * value;
+				momY  += (static_cast<double>(y) - posY) * (static_cast<double>(y) - posY) * value;
+				momXY += (static_cast<double>(x) - posX) * (static_cast<double>(y) - posY) * value;
 				sum   += value;
 			}
 		}
@@ -282,7 +285,7 @@ int MaskOptimization::fitEllipse()
 
 // Function to grow ellipse to maximise enclosed flux:
 
-int MaskOptimization::growEllipse()
+template <typename T> int MaskOptimization<T>::growEllipse()
 {
 	if(!momentMap.isDefined())
 	{
@@ -366,6 +369,14 @@ int MaskOptimization::growEllipse()
 		// Modify mask cube:
 		unsigned long pixelCount = 0;
 		
+		// IDs of bounding box parameters, which are checked for every pixel:
+		const unsigned int idXMin = measurementNameId("x_min");
+		const unsigned int idXMax = measurementNameId("x_max");
+		const unsigned int idYMin = measurementNameId("y_min");
+		const unsigned int idYMax = measurementNameId("y_max");
+		const unsigned int idZMin = measurementNameId("z_min");
+		const unsigned int idZMax = measurementNameId("z_max");
+		
 		for(long x = subRegionX1; x <= subRegionX2; x++)
 		{
 			for(long y = subRegionY1; y <= subRegionY2; y++)
@@ -394,12 +405,12 @@ int MaskOptimization::growEllipse()
 							++pixelCount;
 							
 							// Update bounding box:
-							if(x < source->getParameter("x_min")) source->setParameter("x_min", x);
-							if(x > source->getParameter("x_max")) source->setParameter("x_max", x);
-							if(y < source->getParameter("y_min")) source->setParameter("y_min", y);
-							if(y > source->getParameter("y_max")) source->setParameter("y_max", y);
-							if(z < source->getParameter("z_min")) source->setParameter("z_min", z);
-							if(z > source->getParameter("z_max")) source->setParameter("z_max", z);
+							if(x < source->getParameter(idXMin)) source->setParameter("x_min", x);
+							if(x > source->getParameter(idXMax)) source->setParameter("x_max", x);
+							if(y < source->getParameter(idYMin)) source->setParameter("y_min", y);
+							if(y > source->getParameter(idYMax)) source->setParameter("y_max", y);
+							if(z < source->getParameter(idZMin)) source->setParameter("z_min", z);
+							if(z > source->getParameter(idZMax)) source->setParameter("z_max", z);
 						}
 					}
 				}
@@ -411,3 +422,13 @@ int MaskOptimization::growEllipse()
 	
 	return 0;
 }
+
+
+
+// ######################################################### //
+// Instantiate templates for all supported mask label types: //
+// ######################################################### //
+
+template class MaskOptimization<short>;
+template class MaskOptimization<int>;
+template class MaskOptimization<long>;
@@ -12,16 +12,16 @@
 #define MASKOPTIMIZATION_ELLIPSE_GROWTH          1.0
 
 
-class MaskOptimization
+template <typename T> class MaskOptimization
 {
 public:
 	MaskOptimization(long dx = 0L, long dy = 0L, long dz = 0L);
 	
-	int optimize(DataCube<float> *d, DataCube<short> *m, Source *s);
+	int optimize(DataCube<float> *d, DataCube<T> *m, Source *s);
 	
 private:
 	DataCube<float> *dataCube;
-	DataCube<short> *maskCube;
+	DataCube<T> *maskCube;
 	Source          *source;
 	DataCube<float>  momentMap;
 	
@@ -40,7 +40,7 @@ private:
 	long subRegionZ1;
 	long subRegionZ2;
 	
-	int loadData(DataCube<float> *d, DataCube<short> *m, Source *s);
+	int loadData(DataCube<float> *d, DataCube<T> *m, Source *s);
 	int createMomentMap();
 	int fitEllipse();
 	int growEllipse();
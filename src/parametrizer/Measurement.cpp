@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cmath>
+#include <deque>
 
 #include "Measurement.h"
 
@@ -12,21 +13,47 @@ template <typename T> const std::map<unsigned int, std::pair<double, std::string
 
 
 
-// Constructors
+// Table of interned measurement names; names are kept in a deque, so
+// that references to them remain valid when new names are added.
 
-template <typename T> Measurement<T>::Measurement()
+static std::deque<std::string> &internedNames()
 {
-	clear();
+	static std::deque<std::string> names(1, std::string());
 	
-	return;
+	return names;
+}
+
+unsigned int measurementNameId(const std::string &name)
+{
+	static std::map<std::string, unsigned int> ids;
+	
+	if(name.empty()) return 0;
+	
+	std::map<std::string, unsigned int>::const_iterator iter = ids.find(name);
+	if(iter != ids.end()) return iter->second;
+	
+	std::deque<std::string> &names = internedNames();
+	const unsigned int id = static_cast<unsigned int>(names.size());
+	names.push_back(name);
+	ids.insert(std::pair<std::string, unsigned int>(name, id));
+	
+	return id;
+}
+
+const std::string &measurementName(unsigned int id)
+{
+	const std::deque<std::string> &names = internedNames();
+	
+	return id < names.size() ? names[id] : names[0];
 }
 
-template <typename T> Measurement<T>::Measurement(const Measurement<T> &measurement)
+
+
+// Constructor
+
+template <typename T> Measurement<T>::Measurement()
 {
-	name        = measurement.name;
-	value       = measurement.value;
-	uncertainty = measurement.uncertainty;
-	unit        = measurement.unit;
+	clear();
 	
 	return;
 }
@@ -37,7 +64,7 @@ template <typename T> Measurement<T>::Measurement(const Measurement<T> &measurem
 
 template <typename T> void Measurement<T>::clear()
 {
-	name.clear();
+	nameId = 0;
 	value = static_cast<T>(0.0);
 	uncertainty = static_cast<T>(0.0);
 	unit.clear();
@@ -53,7 +80,7 @@ template <typename T> void Measurement<T>::set(const std::string &newName, T new
 {
 	if(newUncertainty < static_cast<T>(0.0)) newUncertainty *= static_cast<T>(-1.0);
 	
-	name        = newName;
+	nameId      = measurementNameId(newName);
 	value       = newValue;
 	uncertainty = newUncertainty;
 	unit        = newUnit;
@@ -75,7 +102,7 @@ template <typename T> int Measurement<T>::set(const std::string &newName, T newV
 
 template <typename T> void Measurement<T>::setName(const std::string &newName)
 {
-	name = newName;
+	nameId = measurementNameId(newName);
 	return;
 }
 
@@ -138,7 +165,12 @@ template <typename T> int Measurement<T>::set(const std::string &newName, T newV
 
 template <typename T> std::string Measurement<T>::getName()
 {
-	return name;
+	return measurementName(nameId);
+}
+
+template <typename T> unsigned int Measurement<T>::getNameId()
+{
+	return nameId;
 }
 
 template <typename T> T Measurement<T>::getValue()
@@ -169,7 +201,7 @@ template <typename T> std::string Measurement<T>::print(unsigned int mode, int d
 	
 	std::string result;
 	
-	if(mode == MEASUREMENT_FULL) result.append(name + " = ");
+	if(mode == MEASUREMENT_FULL) result.append(measurementName(nameId) + " = ");
 	
 	if(mode != MEASUREMENT_UNIT) result.append(numberToString<T>(value, decimals, scientific));
 	
@@ -232,25 +264,13 @@ template <typename T> int Measurement<T>::invert()
 	this->uncertainty /= this->value * this->value;
 	this->value        = static_cast<T>(1.0) / this->value;
 	(this->unit).invert();
-	this->name = this->name + "⁻¹";
+	this->nameId = measurementNameId(measurementName(this->nameId) + "⁻¹");
 	
 	return 0;
 }
 
 
 
-// Assignment operator (hopefully exception-safe):
-
-template <typename T> Measurement<T> &Measurement<T>::operator = (const Measurement<T> &measurement)
-{
-	this->name        = measurement.name;
-	this->value       = measurement.value;
-	this->uncertainty = measurement.uncertainty;
-	this->unit        = measurement.unit;
-	
-	return *this;
-}
-
 // Comparison operators:
 
 template <typename T> bool Measurement<T>::operator == (Measurement<T> &measurement)
@@ -355,7 +375,7 @@ template <typename T> Measurement<T> &Measurement<T>::operator *= (const Measure
 	
 	this->unit *= measurement.unit;
 	
-	(this->name).append(" × " + measurement.name);
+	this->nameId = measurementNameId(measurementName(this->nameId) + " × " + measurementName(measurement.nameId));
 	
 	return *this;
 }
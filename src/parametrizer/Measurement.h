@@ -11,11 +11,20 @@
 #include "helperFunctions.h"
 #include "Unit.h"
 
+// Measurement names are interned in a global table, so that measurements
+// only hold the ID of their name and can be copied without allocating
+// memory. ID 0 is the empty name.
+
+unsigned int       measurementNameId(const std::string &name);
+const std::string &measurementName(unsigned int id);
+
 template <typename T> class Measurement
 {
 public:
 	Measurement();
-	Measurement(const Measurement<T> &measurement);
+	
+	// Measurements hold no pointers, so the implicitly generated copy
+	// constructor and assignment operator are plain member-wise copies.
 	
 	void            clear();
 	
@@ -29,6 +38,7 @@ public:
 	int             setUnit(const std::string &newUnitStr);
 	
 	std::string     getName();
+	unsigned int    getNameId();
 	T               getValue();
 	T               getUncertainty();
 	Unit            getUnit();
@@ -45,7 +55,6 @@ public:
 	bool            operator >= (Measurement<T> &measurement);
 	bool            operator <  (Measurement<T> &measurement);
 	bool            operator >  (Measurement<T> &measurement);
-	Measurement<T> &operator =  (const Measurement<T> &measurement);
 	Measurement<T> &operator += (Measurement<T> &measurement);
 	Measurement<T> &operator -= (Measurement<T> &measurement);
 	Measurement<T> &operator *= (const Measurement<T> &measurement);
@@ -57,7 +66,7 @@ public:
 	Measurement<T>  operator -  ();
 	
 private:
-	std::string     name;
+	unsigned int    nameId;
 	T               value;
 	T               uncertainty;
 	Unit            unit;
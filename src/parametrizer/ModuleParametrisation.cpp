@@ -1,6 +1,8 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #include "helperFunctions.h"
 #include "ModuleParametrisation.h"
@@ -9,6 +11,23 @@
 
 
 
+// --------------------------------------------- //
+// Columns of source tables used by runColumns() //
+// --------------------------------------------- //
+
+const char *ModuleParametrisation::inputColumns[PARAMETRISATION_INPUT_COLUMNS] = {
+	"id", "flag", "x", "y", "z", "x_min", "x_max", "y_min", "y_max", "z_min", "z_max"
+};
+
+const char *ModuleParametrisation::outputColumns[PARAMETRISATION_OUTPUT_COLUMNS] = {
+	"bf_a", "bf_b1", "bf_b2", "bf_c", "bf_chi2", "bf_f_int", "bf_f_peak", "bf_flag", "bf_w", "bf_w20", "bf_w50", "bf_xe", "bf_xp", "bf_z",
+	"ell3s_maj", "ell3s_min", "ell3s_pa", "ell_maj", "ell_min", "ell_pa", "err_w20", "err_w50", "err_x", "err_y", "err_z",
+	"f_int", "f_peak", "f_wm50", "flag", "id", "kin_pa", "n_pix", "rms", "snr_int", "w20", "w50", "wm50",
+	"x", "x_max", "x_min", "y", "y_max", "y_min", "z", "z_max", "z_min"
+};
+
+
+
 // -------------------------- //
 // Constructor and destructor //
 // -------------------------- //
@@ -33,8 +52,10 @@ ModuleParametrisation::~ModuleParametrisation()
 // -------------------------------------- //
 
 //int ModuleParametrisation::run(float *d, short *m, long dx, long dy, long dz, std::map<std::string, std::string> &fitsHeader, SourceCatalog &initCatalog)
-int ModuleParametrisation::run(float *d, short *m, long dx, long dy, long dz, SourceCatalog &initCatalog)
+template <typename T> int ModuleParametrisation::run(float *d, T *m, long dx, long dy, long dz, SourceCatalog &initCatalog)
 {
+	DataCube<T> maskCube;
+	
 	// Check data
 	
 	if(d == 0 or m == 0) {
@@ -65,22 +86,132 @@ int ModuleParametrisation::run(float *d, short *m, long dx, long dy, long dz, So
 			return 1;
 		}
 		
-		// Pipeline: Run mask optimisation algorithm:
-		if(doMaskOptimisation) {
-			std::cout << "Mask optimisation of source " << i << std::endl;
-			MaskOptimization maskOptimization;
-			if(maskOptimization.optimize(&dataCube, &maskCube, source) != 0) {
-				std::cerr << "Error (ModParam): Mask optimisation failed for source " << source->getSourceID() << ".\n";
-			}
-		}
+		parametriseSource(&maskCube, source);
+	}
+	
+	return 0;
+}
+
+
+
+// ------------------------------------------------------- //
+// Function to run parametrisation module on source tables //
+// ------------------------------------------------------- //
+
+template <typename T> int ModuleParametrisation::runColumns(float *d, T *m, long dx, long dy, long dz, size_t n, const double *input, double *output, unsigned char *defined)
+{
+	DataCube<T> maskCube;
+	
+	// Check data
+	
+	if(d == 0 or m == 0 or (n > 0 and (input == 0 or output == 0 or defined == 0))) {
+		std::cerr << "Error (ModParam): Invalid data pointer provided.\n";
+		return 1;
+	}
+	
+	if(dx <= 0 or dy <= 0 or dz <= 0) {
+		std::cerr << "Error (ModParam): Invalid data cube dimensions.\n";
+		return 1;
+	}
+	
+	dataCube.createNewCubeFromPointer(dx, dy, dz, d);
+	maskCube.createNewCubeFromPointer(dx, dy, dz, m);
+	
+	for(size_t j = 0; j < PARAMETRISATION_OUTPUT_COLUMNS; j++) defined[j] = 0;
+	
+	// Look up IDs of output parameter names only once
+	std::vector<unsigned int> outputIds(PARAMETRISATION_OUTPUT_COLUMNS);
+	for(size_t j = 0; j < PARAMETRISATION_OUTPUT_COLUMNS; j++) outputIds[j] = measurementNameId(outputColumns[j]);
+	
+	// Process sources in order of increasing ID, as in run(), since
+	// mask optimisation can assign pixels to only one source.
+	std::vector<size_t> order(n);
+	for(size_t i = 0; i < n; i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), CompareColumn(input));
+	
+	for(std::vector<size_t>::iterator it = order.begin(); it != order.end(); it++) {
+		const double *row = input  + *it;
+		double *result    = output + *it;
+		
+		Source source;
+		source.setSourceID(static_cast<unsigned long>(row[0]));
+		for(size_t j = 1; j < PARAMETRISATION_INPUT_COLUMNS; j++) source.setParameter(inputColumns[j], row[j * n]);
 		
-		// Pipeline: Run parametrisation algorithm:
-		std::cout << "Parametrisation of source " << i << std::endl;
-		Parametrization parametrization;
-		if(parametrization.parametrize(&dataCube, &maskCube, source, doBusyFunction) != 0) {
-			std::cerr << "Error (ModParam): Parametrisation failed for source " << source->getSourceID() << ".\n";
+		parametriseSource(&maskCube, &source);
+		
+		// Only parameters actually measured are written, so undefined
+		// parameters retain the values provided by the caller.
+		for(size_t j = 0; j < PARAMETRISATION_OUTPUT_COLUMNS; j++) {
+			if(source.parameterDefined(outputIds[j])) {
+				result[j * n] = source.getParameter(outputIds[j]);
+				defined[j] = 1;
+			}
 		}
 	}
 	
 	return 0;
 }
+
+
+
+// --------------------------------------- //
+// Function to parametrise a single source //
+// --------------------------------------- //
+
+template <typename T> void ModuleParametrisation::parametriseSource(DataCube<T> *maskCube, Source *source)
+{
+	// Pipeline: Run mask optimisation algorithm:
+	if(doMaskOptimisation) {
+		std::cout << "Mask optimisation of source " << source->getSourceID() << std::endl;
+		MaskOptimization<T> maskOptimization;
+		if(maskOptimization.optimize(&dataCube, maskCube, source) != 0) {
+			std::cerr << "Error (ModParam): Mask optimisation failed for source " << source->getSourceID() << ".\n";
+		}
+	}
+	
+	// Pipeline: Run parametrisation algorithm:
+	std::cout << "Parametrisation of source " << source->getSourceID() << std::endl;
+	Parametrization<T> parametrization;
+	if(parametrization.parametrize(&dataCube, maskCube, source, doBusyFunction) != 0) {
+		std::cerr << "Error (ModParam): Parametrisation failed for source " << source->getSourceID() << ".\n";
+	}
+	
+	return;
+}
+
+
+
+// ######################################################### //
+// Instantiate templates for all supported mask label types: //
+// ######################################################### //
+
+template int ModuleParametrisation::run<short>(float *d, short *m, long dx, long dy, long dz, SourceCatalog &initCatalog);
+template int ModuleParametrisation::run<int>(float *d, int *m, long dx, long dy, long dz, SourceCatalog &initCatalog);
+template int ModuleParametrisation::run<long>(float *d, long *m, long dx, long dy, long dz, SourceCatalog &initCatalog);
+template int ModuleParametrisation::runColumns<short>(float *d, short *m, long dx, long dy, long dz, size_t n, const double *input, double *output, unsigned char *defined);
+template int ModuleParametrisation::runColumns<int>(float *d, int *m, long dx, long dy, long dz, size_t n, const double *input, double *output, unsigned char *defined);
+template int ModuleParametrisation::runColumns<long>(float *d, long *m, long dx, long dy, long dz, size_t n, const double *input, double *output, unsigned char *defined);
+
+
+
+// ------------------------------------- //
+// C interface for access through ctypes //
+// ------------------------------------- //
+
+size_t parametrisation_columns(int output)
+{
+	return output ? PARAMETRISATION_OUTPUT_COLUMNS : PARAMETRISATION_INPUT_COLUMNS;
+}
+
+const char *parametrisation_column_name(int output, size_t i)
+{
+	if(output) return i < PARAMETRISATION_OUTPUT_COLUMNS ? ModuleParametrisation::outputColumns[i] : 0;
+	return i < PARAMETRISATION_INPUT_COLUMNS ? ModuleParametrisation::inputColumns[i] : 0;
+}
+
+int parametrisation_run_columns(float *d, long *m, long dx, long dy, long dz, size_t n, const double *input, double *output, unsigned char *defined, int doMO, int doBF)
+{
+	ModuleParametrisation module;
+	module.setFlags(doMO != 0, doBF != 0);
+	return module.runColumns(d, m, dx, dy, dz, n, input, output, defined);
+}
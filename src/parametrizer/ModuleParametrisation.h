@@ -8,6 +8,9 @@
 #include "SourceCatalog.h"
 #include "DataCube.h"
 
+#define PARAMETRISATION_INPUT_COLUMNS  11
+#define PARAMETRISATION_OUTPUT_COLUMNS 46
+
 class ModuleParametrisation
 {
 public:
@@ -15,7 +18,21 @@ public:
 	~ModuleParametrisation();
 	
 	//int run(float *d, short *m, long dx, long dy, long dz, std::map<std::string, std::string> &fitsHeader, SourceCatalog &initCatalog);
-	int run(float *d, short *m, long dx, long dy, long dz, SourceCatalog &initCatalog);
+	
+	// Mask label type T can be short, int or long; the mask
+	// is accessed in place without conversion.
+	template <typename T> int run(float *d, T *m, long dx, long dy, long dz, SourceCatalog &initCatalog);
+	
+	// Columnar alternative to run(): each parameter of the n sources is
+	// passed as a contiguous column of n values of the input table, and
+	// the measured parameters are written into the columns of the out-
+	// put table in place (see inputColumns and outputColumns for the
+	// column order). defined flags all columns that were measured for
+	// at least one source.
+	template <typename T> int runColumns(float *d, T *m, long dx, long dy, long dz, size_t n, const double *input, double *output, unsigned char *defined);
+	
+	static const char *inputColumns[PARAMETRISATION_INPUT_COLUMNS];
+	static const char *outputColumns[PARAMETRISATION_OUTPUT_COLUMNS];
 	
 	SourceCatalog getCatalog()
 	{
@@ -33,15 +50,32 @@ private:
 	//std::map<std::string, std::string> parameters;
 	
 	DataCube<float> dataCube;
-	DataCube<short> maskCube;
 	SourceCatalog   catalog;
 	
 	bool doMaskOptimisation;
 	bool doBusyFunction;
 	
+	template <typename T> void parametriseSource(DataCube<T> *maskCube, Source *source);
+	
+	// Orders sources by their values in a column of a table
+	struct CompareColumn
+	{
+		CompareColumn(const double *c) : column(c) {}
+		bool operator()(size_t a, size_t b) const { return column[a] < column[b]; }
+		const double *column;
+	};
+	
 	// Make copy constructor and assignment operator private, so they can't be called:
 	ModuleParametrisation(const ModuleParametrisation&);
 	ModuleParametrisation &operator=(const ModuleParametrisation&);
 };
 
+// C interface for access through ctypes
+extern "C"
+{
+	size_t parametrisation_columns(int output);
+	const char *parametrisation_column_name(int output, size_t i);
+	int parametrisation_run_columns(float *d, long *m, long dx, long dy, long dz, size_t n, const double *input, double *output, unsigned char *defined, int doMO, int doBF);
+}
+
 #endif
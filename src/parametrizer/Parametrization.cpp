@@ -13,7 +13,7 @@
 #define M_PI 3.14159265358979323846
 #endif
 
-#define SOURCE_LOOP_START for(long x = subRegionX1; x <= subRegionX2; ++x) { for(long y = subRegionY1; y <= subRegionY2; ++y) { for(long z = subRegionZ1; z <= subRegionZ2; ++z) { double fluxValue = static_cast<double>(dataCube->getData(x, y, z)); if(static_cast<unsigned short>(maskCube->getData(x, y, z)) == source->getSourceID())
+#define SOURCE_LOOP_START for(long x = subRegionX1; x <= subRegionX2; ++x) { for(long y = subRegionY1; y <= subRegionY2; ++y) { for(long z = subRegionZ1; z <= subRegionZ2; ++z) { double fluxValue = static_cast<double>(dataCube->getData(x, y, z)); if(maskCube->getData(x, y, z) == static_cast<T>(source->getSourceID()))
 #define SOURCE_LOOP_END } } }
 
 
@@ -22,7 +22,7 @@
 // Constructor //
 // ----------- //
 
-Parametrization::Parametrization()
+template <typename T> Parametrization<T>::Parametrization()
 {
 	// Initialisation of data:
 	dataCube = 0;
@@ -81,7 +81,7 @@ Parametrization::Parametrization()
 // Interface function to call parameterisation module //
 // -------------------------------------------------- //
 
-int Parametrization::parametrize(DataCube<float> *d, DataCube<short> *m, Source *s, bool doBF)
+template <typename T> int Parametrization<T>::parametrize(DataCube<float> *d, DataCube<T> *m, Source *s, bool doBF)
 {
 	doBusyFunction = doBF;
 	
@@ -135,7 +135,7 @@ int Parametrization::parametrize(DataCube<float> *d, DataCube<short> *m, Source
 // Function to load data and determine local noise //
 // ----------------------------------------------- //
 
-int Parametrization::loadData(DataCube<float> *d, DataCube<short> *m, Source *s)
+template <typename T> int Parametrization<T>::loadData(DataCube<float> *d, DataCube<T> *m, Source *s)
 {
 	dataCube = 0;
 	maskCube = 0;
@@ -233,7 +233,7 @@ int Parametrization::loadData(DataCube<float> *d, DataCube<short> *m, Source *s)
 // Measure centroid //
 // ---------------- //
 
-int Parametrization::measureCentroid()
+template <typename T> int Parametrization<T>::measureCentroid()
 {
 	double sum   = 0.0;
 	centroidX    = 0.0;
@@ -281,7 +281,7 @@ int Parametrization::measureCentroid()
 // Measure peak flux, integrated flux and integrated S/N //
 // ----------------------------------------------------- //
 
-int Parametrization::measureFlux()
+template <typename T> int Parametrization<T>::measureFlux()
 {
 	totalFlux = 0.0;
 	peakFlux  = -std::numeric_limits<double>::max();
@@ -308,7 +308,7 @@ int Parametrization::measureFlux()
 // Fit ellipse to source //
 // --------------------- //
 
-int Parametrization::fitEllipse()
+template <typename T> int Parametrization<T>::fitEllipse()
 {
 	// (1) Fitting ellipse to intensity-weighted image:
 	
@@ -322,12 +322,16 @@ int Parametrization::fitEllipse()
 	double momXY = 0.0;
 	double sum   = 0.0;
 	
+	// Source position is looked up once rather than for every pixel:
+	const double posX = source->getParameter("x");
+	const double posY = source->getParameter("y");
+	
 	SOURCE_LOOP_START {
 		if(fluxValue > 0.0) {
 			// NOTE: Only positive pixels considered here!
-			momX  += static_cast<double>((x - source->getParameter("x")) * (x - source->getParameter("x"))) * fluxValue;
-			momY  += static_cast<double>((y - source->getParameter("y")) * (y - source->getParameter("y"))) * fluxValue;
-			momXY += static_cast<double>((x - source->getParameter("x")) * (y - source->getParameter("y"))) * fluxValue;
+			momX  += static_cast<double>((x - posX) * (x - posX)) * fluxValue;
+			momY  += static_cast<double>((y - posY) * (y - posY)) * fluxValue;
+			momXY += static_cast<double>((x - posX) * (y - posY)) * fluxValue;
 			sum += fluxValue;
 		}
 	} SOURCE_LOOP_END
@@ -401,9 +405,9 @@ int Parametrization::fitEllipse()
 	// set to 1, all other pixels to 0):
 	for(size_t x = 0; x < sizeX; ++x) {
 		for(size_t y = 0; y < sizeY; ++y) {
-			momX  += static_cast<double>((x - source->getParameter("x") + subRegionX1) * (x - source->getParameter("x") + subRegionX1) * maskMap[x + sizeX * y]);
-			momY  += static_cast<double>((y - source->getParameter("y") + subRegionY1) * (y - source->getParameter("y") + subRegionY1) * maskMap[x + sizeX * y]);
-			momXY += static_cast<double>((x - source->getParameter("x") + subRegionX1) * (y - source->getParameter("y") + subRegionY1) * maskMap[x + sizeX * y]);
+			momX  += static_cast<double>((x - posX + subRegionX1) * (x - posX + subRegionX1) * maskMap[x + sizeX * y]);
+			momY  += static_cast<double>((y - posY + subRegionY1) * (y - posY + subRegionY1) * maskMap[x + sizeX * y]);
+			momXY += static_cast<double>((x - posX + subRegionX1) * (y - posY + subRegionY1) * maskMap[x + sizeX * y]);
 			sum += static_cast<double>(maskMap[x + sizeX * y]);
 		}
 	}
@@ -437,7 +441,7 @@ int Parametrization::fitEllipse()
 // Measure kinematic major axis //
 // ---------------------------- //
 
-int Parametrization::kinematicMajorAxis()
+template <typename T> int Parametrization<T>::kinematicMajorAxis()
 {
 	// Determine the flux-weighted centroid in each channel:
 	size_t size = subRegionZ2 - subRegionZ1 + 1;
@@ -548,7 +552,7 @@ int Parametrization::kinematicMajorAxis()
 // Create integrated spectrum //
 // -------------------------- //
 
-int Parametrization::createIntegratedSpectrum()
+template <typename T> int Parametrization<T>::createIntegratedSpectrum()
 {
 	spectrum.clear();
 	noiseSpectrum.clear();
@@ -597,7 +601,7 @@ int Parametrization::createIntegratedSpectrum()
 // Measure line width //
 // ------------------ //
 
-int Parametrization::measureLineWidth()
+template <typename T> int Parametrization<T>::measureLineWidth()
 {
 	// Determine maximum:
 	double specMax = 0.0;    // WARNING: This assumes that sources are always positive!
@@ -782,7 +786,7 @@ int Parametrization::measureLineWidth()
 // Fit Busy Function //
 // ----------------- //
 
-int Parametrization::fitBusyFunction()
+template <typename T> int Parametrization<T>::fitBusyFunction()
 {
 	// Create spectral axis:
 	std::vector<double> channels;
@@ -847,7 +851,7 @@ int Parametrization::fitBusyFunction()
 // Assign results to source //
 // ------------------------ //
 
-int Parametrization::writeParameters()
+template <typename T> int Parametrization<T>::writeParameters()
 {
 	source->setParameter("id",        source->getSourceID());
 	source->setParameter("x",         centroidX);
@@ -896,3 +900,13 @@ int Parametrization::writeParameters()
 	
 	return 0;
 }
+
+
+
+// ######################################################### //
+// Instantiate templates for all supported mask label types: //
+// ######################################################### //
+
+template class Parametrization<short>;
+template class Parametrization<int>;
+template class Parametrization<long>;
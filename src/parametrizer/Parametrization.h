@@ -12,15 +12,15 @@
 #include "DataCube.h"
 #include "Source.h"
 
-class Parametrization
+template <typename T> class Parametrization
 {
 public:
 	Parametrization();
 	
-	int parametrize(DataCube<float> *d, DataCube<short> *m, Source *s, bool doBF = false);
+	int parametrize(DataCube<float> *d, DataCube<T> *m, Source *s, bool doBF = false);
 	
 private:
-	int loadData(DataCube<float> *d, DataCube<short> *m, Source *s);
+	int loadData(DataCube<float> *d, DataCube<T> *m, Source *s);
 	int measureCentroid();
 	int measureLineWidth();
 	int measureFlux();
@@ -33,7 +33,7 @@ private:
 	bool doBusyFunction;
 	
 	DataCube<float> *dataCube;
-	DataCube<short> *maskCube;
+	DataCube<T> *maskCube;
 	Source          *source;
 	
 	long searchRadiusX;
@@ -47,10 +47,25 @@ bool Source::isDefined()
 
 bool Source::parameterDefined(const std::string &name)
 {
-	if (parameters.find(name)==parameters.end())
-		return false;
-	else
-		return true;
+	return parameterDefined(measurementNameId(name));
+}
+
+bool Source::parameterDefined(unsigned int nameId)
+{
+	return findParameter(nameId) < parameters.size();
+}
+
+size_t Source::findParameter(unsigned int nameId)
+{
+	// Returns index of parameter or parameters.size() if not found;
+	// sources only have a few dozen parameters, so a linear search
+	// over their integer IDs is fastest.
+	for(size_t i = 0; i < parameters.size(); i++)
+	{
+		if(parameters[i].getNameId() == nameId) return i;
+	}
+	
+	return parameters.size();
 }
 
 
@@ -62,7 +77,11 @@ bool Source::parameterDefined(const std::string &name)
 
 int Source::setParameter(Measurement<double> &measurement)
 {
-	parameters[measurement.getName()]=measurement;
+	const size_t i = findParameter(measurement.getNameId());
+	
+	if(i < parameters.size()) parameters[i] = measurement;
+	else parameters.push_back(measurement);
+	
 	return 0;
 }
 
@@ -81,8 +100,7 @@ int Source::setParameter(const std::string &parameter, double value, double unce
 		std::cerr << "Error (Source): Failed to set source parameter.\n";
 		return 1;
 	}
-	parameters[tmp.getName()]=tmp;
-	return 0;
+	return setParameter(tmp);
 }
 
 
@@ -90,54 +108,51 @@ int Source::setParameter(const std::string &parameter, double value, double unce
 // Function to get source parameters //
 // --------------------------------- //
 
-Measurement<double> Source::getParameterMeasurement(const std::string &parameter)
+double Source::parameterNotFound(const std::string &parameter, Measurement<double> &measurement)
 {
-	
-	if (parameters.find(parameter)==parameters.end())
+	std::cerr << "Error (Source): Source parameter \'" << parameter << "\' not found.\n";
+	if(std::numeric_limits<double>::has_quiet_NaN)
 	{
-		std::cerr << "Error (Source): Source parameter \'" << parameter << "\' not found.\n";
-		Measurement<double> tmp;
-		if(std::numeric_limits<double>::has_quiet_NaN)
-		{
-			double nan=std::numeric_limits<double>::quiet_NaN();         // Return NaN if available
-			tmp.set("notfound",nan,nan,"");
-			
-		}
-		else
-		{
-			tmp.set("notfound",0.,0.,"");                              // Otherwise return 0
-		}
-		return tmp;
+		double nan=std::numeric_limits<double>::quiet_NaN();         // Return NaN if available
+		measurement.set("notfound",nan,nan,"");
+		
 	}
 	else
 	{
-		return parameters[parameter];
+		measurement.set("notfound",0.,0.,"");                      // Otherwise return 0
 	}
+	return measurement.getValue();
+}
+
+Measurement<double> Source::getParameterMeasurement(const std::string &parameter)
+{
+	const size_t i = findParameter(measurementNameId(parameter));
+	
+	if(i < parameters.size()) return parameters[i];
+	
+	Measurement<double> tmp;
+	parameterNotFound(parameter, tmp);
+	return tmp;
 }
 
 double Source::getParameter(const std::string &parameter)
 {
+	const size_t i = findParameter(measurementNameId(parameter));
 	
-	if (parameters.find(parameter)==parameters.end())
-	{
-		std::cerr << "Error (Source): Source parameter \'" << parameter << "\' not found.\n";
-		Measurement<double> tmp;
-		if(std::numeric_limits<double>::has_quiet_NaN)
-		{
-			double nan=std::numeric_limits<double>::quiet_NaN();         // Return NaN if available
-			tmp.set("notfound",nan,nan,"");
-			
-		}
-		else
-		{
-			tmp.set("notfound",0.,0.,"");                              // Otherwise return 0
-		}
-		return tmp.getValue();
-	}
-	else
-	{
-		return parameters[parameter].getValue();
-	}
+	if(i < parameters.size()) return parameters[i].getValue();
+	
+	Measurement<double> tmp;
+	return parameterNotFound(parameter, tmp);
+}
+
+double Source::getParameter(unsigned int nameId)
+{
+	const size_t i = findParameter(nameId);
+	
+	if(i < parameters.size()) return parameters[i].getValue();
+	
+	Measurement<double> tmp;
+	return parameterNotFound(measurementName(nameId), tmp);
 }
 
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include "Measurement.h"
 
@@ -14,6 +15,7 @@ public:
 	
 	bool          isDefined();
 	bool          parameterDefined(const std::string &name);
+	bool          parameterDefined(unsigned int nameId);
 	//     unsigned int  findParameter(const std::string &name);
 	
 	int           setParameter(const std::string &parameter, double value, double uncertainty, std::string &unit);
@@ -21,6 +23,7 @@ public:
 	int           setParameter(Measurement<double> &measurement);
 	Measurement<double> getParameterMeasurement(const std::string &parameter);
 	double        getParameter(const std::string &parameter);
+	double        getParameter(unsigned int nameId);
 	
 	int           setSourceID(unsigned long sid);
 	unsigned long getSourceID();
@@ -30,11 +33,14 @@ public:
 	
 	std::map<std::string,Measurement<double> > getParameters()
 	{
-		return parameters;
+		std::map<std::string,Measurement<double> > result;
+		for(size_t i = 0; i < parameters.size(); i++) result[parameters[i].getName()] = parameters[i];
+		return result;
 	}
 	void setParameters(std::map<std::string,Measurement<double> > params)
 	{
-		parameters=params;
+		parameters.clear();
+		for(std::map<std::string,Measurement<double> >::iterator it = params.begin(); it != params.end(); it++) setParameter(it->second);
 	}
 	void clear()
 	{
@@ -45,7 +51,13 @@ public:
 private:
 	unsigned long sourceID;
 	std::string   sourceName;
-	std::map<std::string,Measurement<double> > parameters;      // Space after first '>' required, otherwise g++ will complain
+	
+	// Parameters in order of insertion; as measurements are plain data,
+	// copying a source only copies a single array.
+	std::vector<Measurement<double> > parameters;
+	
+	size_t        findParameter(unsigned int nameId);
+	double        parameterNotFound(const std::string &parameter, Measurement<double> &measurement);
 };
 
 #endif
@@ -19,8 +19,6 @@ const std::map<std::string, int>               Unit::prefixMap    = Unit::create
 
 Unit::Unit()
 {
-	units.resize(UNIT_NUMBER_BASE_UNITS, 0);
-	
 	this->clear();
 	
 	return;
@@ -28,29 +26,13 @@ Unit::Unit()
 
 Unit::Unit(const std::string &value)
 {
-	units.resize(UNIT_NUMBER_BASE_UNITS, 0);
+	this->clear();
 	
 	this->set(value);
 	
 	return;
 }
 
-// Copy constructor (must take const reference):
-
-Unit::Unit(const Unit &unit)
-{
-	units.resize(UNIT_NUMBER_BASE_UNITS, 0);
-	
-	for(size_t i = 0; i < UNIT_NUMBER_BASE_UNITS; i++)
-	{
-		this->units[i] = unit.units[i];
-	}
-	
-	this->prefixes = unit.prefixes;
-	
-	return;
-}
-
 
 
 // --------------------------------------
@@ -123,20 +105,6 @@ void Unit::invert()
 // Overloaded operators:
 // ---------------------
 
-// Assignment operator (hopefully exception-safe):
-
-Unit &Unit::operator = (const Unit &unit)
-{
-	for(size_t i = 0; i < UNIT_NUMBER_BASE_UNITS; i++)
-	{
-		this->units[i] = unit.units[i];
-	}
-	
-	this->prefixes     = unit.prefixes;
-	
-	return *this;
-}
-
 // Comparison operators:
 
 bool Unit::operator == (const Unit &cmpUnit)
@@ -277,6 +245,33 @@ std::string Unit::printString(const unsigned int mode)
 // ---------------------
 
 int Unit::set(const std::string &value)
+{
+	// Look up unit string in table of interned units first; only
+	// units that were parsed successfully are added to the table.
+	std::map<std::string, Unit> &interned = internedUnits();
+	std::map<std::string, Unit>::const_iterator iter = interned.find(value);
+	
+	if(iter != interned.end())
+	{
+		*this = iter->second;
+		return 0;
+	}
+	
+	if(this->parse(value) != 0) return 1;
+	
+	interned.insert(std::pair<std::string, Unit>(value, *this));
+	
+	return 0;
+}
+
+std::map<std::string, Unit> &Unit::internedUnits()
+{
+	static std::map<std::string, Unit> interned;
+	
+	return interned;
+}
+
+int Unit::parse(const std::string &value)
 {
 	this->clear();
 	
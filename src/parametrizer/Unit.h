@@ -40,9 +40,11 @@ class Unit
 {
 public:
 	Unit();
-	Unit(const Unit &unit);
 	Unit(const std::string &value);
 	
+	// Units hold no pointers, so the implicitly generated copy constructor
+	// and assignment operator are plain copies of a few integers.
+	
 	int              getPrefix();
 	
 	int              set(const std::string &value);
@@ -54,7 +56,6 @@ public:
 	bool             isEmpty();
 	bool             isDefined();
 	
-	Unit &           operator =  (const Unit &unit);
 	bool             operator == (const Unit &cmpUnit);
 	bool             operator == (const std::string &cmpUnitStr);
 	bool             operator != (const Unit &cmpUnit);
@@ -66,7 +67,14 @@ public:
 	
 private:
 	int              prefixes;
-	std::vector<int> units;
+	int              units[UNIT_NUMBER_BASE_UNITS];
+	
+	int              parse(const std::string &value);
+	
+	// Table of units already parsed, so that each unit string
+	// only needs to be parsed once:
+	
+	static std::map<std::string, Unit> &internedUnits();
 	
 	
 	
@@ -1846,7 +1846,7 @@ static CYTHON_INLINE PyObject *__pyx_convert_PyStr_string_to_py_std__in_string(s
 static CYTHON_INLINE PyObject *__pyx_convert_PyBytes_string_to_py_std__in_string(std::string const &); /*proto*/
 static CYTHON_INLINE PyObject *__pyx_convert_PyByteArray_string_to_py_std__in_string(std::string const &); /*proto*/
 static __Pyx_TypeInfo __Pyx_TypeInfo_float = { "float", NULL, sizeof(float), { 0 }, 0, 'R', 0, 0 };
-static __Pyx_TypeInfo __Pyx_TypeInfo_short = { "short", NULL, sizeof(short), { 0 }, 0, IS_UNSIGNED(short) ? 'U' : 'I', IS_UNSIGNED(short), 0 };
+static __Pyx_TypeInfo __Pyx_TypeInfo_long = { "long", NULL, sizeof(long), { 0 }, 0, IS_UNSIGNED(long) ? 'U' : 'I', IS_UNSIGNED(long), 0 };
 #define __Pyx_MODULE_NAME "cparametrizer"
 int __pyx_module_is_main_cparametrizer = 0;
 
@@ -1863,6 +1863,7 @@ static PyObject *__pyx_builtin_print;
 static PyObject *__pyx_builtin_range;
 static PyObject *__pyx_builtin_RuntimeError;
 static PyObject *__pyx_builtin_ImportError;
+static const char __pyx_k_l[] = "l";
 static const char __pyx_k_s[] = "s";
 static const char __pyx_k_u[] = "u";
 static const char __pyx_k_ID[] = "ID";
@@ -1886,7 +1887,6 @@ static const char __pyx_k_unit[] = "unit";
 static const char __pyx_k_UTF_8[] = "UTF-8";
 static const char __pyx_k_clear[] = "clear";
 static const char __pyx_k_dtype[] = "dtype";
-static const char __pyx_k_int16[] = "int16";
 static const char __pyx_k_print[] = "print";
 static const char __pyx_k_range[] = "range";
 static const char __pyx_k_value[] = "value";
@@ -2007,7 +2007,7 @@ static const char __pyx_k_Source_ID_0_d_already_present_pl[] = "Source ID ({0:d}
 static const char __pyx_k_Source_ID_0_d_not_present_please[] = "Source ID ({0:d}) not present, please use insert()";
 static const char __pyx_k_any_dictionary_value_is_not_a_Py[] = "any dictionary value is not a PyMeasurement";
 static const char __pyx_k_data_must_have_type_float_np_flo[] = "data must have type float (np.float32 aka <f4)";
-static const char __pyx_k_mask_must_have_type_short_np_int[] = "mask must have type short (np.int16 aka <i2)";
+static const char __pyx_k_mask_must_have_type_long_np_int_[] = "mask must have type long (np.int_ aka C long)";
 static const char __pyx_k_ndarray_is_not_Fortran_contiguou[] = "ndarray is not Fortran contiguous";
 static const char __pyx_k_no_default___reduce___due_to_non[] = "no default __reduce__ due to non-trivial __cinit__";
 static const char __pyx_k_numpy_core_umath_failed_to_impor[] = "numpy.core.umath failed to import";
@@ -2086,11 +2086,11 @@ static PyObject *__pyx_n_s_getValue;
 static PyObject *__pyx_kp_u_if_an_integer_enum_is_used;
 static PyObject *__pyx_n_s_initCatalog;
 static PyObject *__pyx_n_s_insert;
-static PyObject *__pyx_n_u_int16;
 static PyObject *__pyx_n_s_intersection;
 static PyObject *__pyx_n_s_keys;
+static PyObject *__pyx_n_u_l;
 static PyObject *__pyx_n_s_main;
-static PyObject *__pyx_kp_u_mask_must_have_type_short_np_int;
+static PyObject *__pyx_kp_u_mask_must_have_type_long_np_int_;
 static PyObject *__pyx_n_s_maskcube;
 static PyObject *__pyx_n_s_measurement_compact;
 static PyObject *__pyx_n_u_measurement_compact;
@@ -13216,7 +13216,7 @@ static PyObject *__pyx_pf_13cparametrizer_23PyModuleParametrisation_4run(struct
   __pyx_pybuffernd_datacube.diminfo[0].strides = __pyx_pybuffernd_datacube.rcbuffer->pybuffer.strides[0]; __pyx_pybuffernd_datacube.diminfo[0].shape = __pyx_pybuffernd_datacube.rcbuffer->pybuffer.shape[0]; __pyx_pybuffernd_datacube.diminfo[1].strides = __pyx_pybuffernd_datacube.rcbuffer->pybuffer.strides[1]; __pyx_pybuffernd_datacube.diminfo[1].shape = __pyx_pybuffernd_datacube.rcbuffer->pybuffer.shape[1]; __pyx_pybuffernd_datacube.diminfo[2].strides = __pyx_pybuffernd_datacube.rcbuffer->pybuffer.strides[2]; __pyx_pybuffernd_datacube.diminfo[2].shape = __pyx_pybuffernd_datacube.rcbuffer->pybuffer.shape[2];
   {
     __Pyx_BufFmt_StackElem __pyx_stack[1];
-    if (unlikely(__Pyx_GetBufferAndValidate(&__pyx_pybuffernd_maskcube.rcbuffer->pybuffer, (PyObject*)__pyx_v_maskcube, &__Pyx_TypeInfo_short, PyBUF_FORMAT| PyBUF_STRIDES, 3, 0, __pyx_stack) == -1)) __PYX_ERR(0, 604, __pyx_L1_error)
+    if (unlikely(__Pyx_GetBufferAndValidate(&__pyx_pybuffernd_maskcube.rcbuffer->pybuffer, (PyObject*)__pyx_v_maskcube, &__Pyx_TypeInfo_long, PyBUF_FORMAT| PyBUF_STRIDES, 3, 0, __pyx_stack) == -1)) __PYX_ERR(0, 604, __pyx_L1_error)
   }
   __pyx_pybuffernd_maskcube.diminfo[0].strides = __pyx_pybuffernd_maskcube.rcbuffer->pybuffer.strides[0]; __pyx_pybuffernd_maskcube.diminfo[0].shape = __pyx_pybuffernd_maskcube.rcbuffer->pybuffer.shape[0]; __pyx_pybuffernd_maskcube.diminfo[1].strides = __pyx_pybuffernd_maskcube.rcbuffer->pybuffer.strides[1]; __pyx_pybuffernd_maskcube.diminfo[1].shape = __pyx_pybuffernd_maskcube.rcbuffer->pybuffer.shape[1]; __pyx_pybuffernd_maskcube.diminfo[2].strides = __pyx_pybuffernd_maskcube.rcbuffer->pybuffer.strides[2]; __pyx_pybuffernd_maskcube.diminfo[2].shape = __pyx_pybuffernd_maskcube.rcbuffer->pybuffer.shape[2];
 
@@ -13224,7 +13224,7 @@ static PyObject *__pyx_pf_13cparametrizer_23PyModuleParametrisation_4run(struct
  *         """Note: for each source id there must be a corresponding region (subcube) in the
  *         maskcube, having pixel values that equal source id"""
  *         assert datacube.dtype is np.dtype('float32'), 'data must have type float (np.float32 aka <f4)'             # <<<<<<<<<<<<<<
- *         assert maskcube.dtype is np.dtype('int16'), 'mask must have type short (np.int16 aka <i2)'
+ *         assert maskcube.dtype is np.dtype('l'), 'mask must have type long (np.int_ aka C long)'
  *         assert datacube.ndim == 3
  */
   #ifndef CYTHON_WITHOUT_ASSERTIONS
@@ -13246,7 +13246,7 @@ static PyObject *__pyx_pf_13cparametrizer_23PyModuleParametrisation_4run(struct
   /* "cparametrizer.pyx":613
  *         maskcube, having pixel values that equal source id"""
  *         assert datacube.dtype is np.dtype('float32'), 'data must have type float (np.float32 aka <f4)'
- *         assert maskcube.dtype is np.dtype('int16'), 'mask must have type short (np.int16 aka <i2)'             # <<<<<<<<<<<<<<
+ *         assert maskcube.dtype is np.dtype('l'), 'mask must have type long (np.int_ aka C long)'             # <<<<<<<<<<<<<<
  *         assert datacube.ndim == 3
  * 
  */
@@ -13260,7 +13260,7 @@ static PyObject *__pyx_pf_13cparametrizer_23PyModuleParametrisation_4run(struct
     __Pyx_DECREF(__pyx_t_2); __pyx_t_2 = 0;
     __Pyx_DECREF(__pyx_t_1); __pyx_t_1 = 0;
     if (unlikely(!(__pyx_t_3 != 0))) {
-      PyErr_SetObject(PyExc_AssertionError, __pyx_kp_u_mask_must_have_type_short_np_int);
+      PyErr_SetObject(PyExc_AssertionError, __pyx_kp_u_mask_must_have_type_long_np_int_);
       __PYX_ERR(0, 613, __pyx_L1_error)
     }
   }
@@ -13268,7 +13268,7 @@ static PyObject *__pyx_pf_13cparametrizer_23PyModuleParametrisation_4run(struct
 
   /* "cparametrizer.pyx":614
  *         assert datacube.dtype is np.dtype('float32'), 'data must have type float (np.float32 aka <f4)'
- *         assert maskcube.dtype is np.dtype('int16'), 'mask must have type short (np.int16 aka <i2)'
+ *         assert maskcube.dtype is np.dtype('l'), 'mask must have type long (np.int_ aka C long)'
  *         assert datacube.ndim == 3             # <<<<<<<<<<<<<<
  * 
  *         cdef long dz = datacube.shape[0]
@@ -13313,7 +13313,7 @@ static PyObject *__pyx_pf_13cparametrizer_23PyModuleParametrisation_4run(struct
  *         cdef long dx = datacube.shape[2]
  * 
  *         initCatalogPtr = new SourceCatalog(deref((<PySourceCatalog> initCatalog).thisptr))             # <<<<<<<<<<<<<<
- *         self.thisptr.run(
+ *         self.thisptr.run[long](
  *             <float*> datacube.data,
  */
   try {
@@ -13327,11 +13327,11 @@ static PyObject *__pyx_pf_13cparametrizer_23PyModuleParametrisation_4run(struct
   /* "cparametrizer.pyx":621
  * 
  *         initCatalogPtr = new SourceCatalog(deref((<PySourceCatalog> initCatalog).thisptr))
- *         self.thisptr.run(             # <<<<<<<<<<<<<<
+ *         self.thisptr.run[long](             # <<<<<<<<<<<<<<
  *             <float*> datacube.data,
- *             <short*> maskcube.data,
+ *             <long*> maskcube.data,
  */
-  __pyx_v_self->thisptr->run(((float *)__pyx_v_datacube->data), ((short *)__pyx_v_maskcube->data), __pyx_v_dx, __pyx_v_dy, __pyx_v_dz, (*__pyx_v_initCatalogPtr));
+  __pyx_v_self->thisptr->run<long>(((float *)__pyx_v_datacube->data), ((long *)__pyx_v_maskcube->data), __pyx_v_dx, __pyx_v_dy, __pyx_v_dz, (*__pyx_v_initCatalogPtr));
 
   /* "cparametrizer.pyx":604
  *         del self.thisptr
@@ -17213,11 +17213,11 @@ static __Pyx_StringTabEntry __pyx_string_tab[] = {
   {&__pyx_kp_u_if_an_integer_enum_is_used, __pyx_k_if_an_integer_enum_is_used, sizeof(__pyx_k_if_an_integer_enum_is_used), 0, 1, 0, 0},
   {&__pyx_n_s_initCatalog, __pyx_k_initCatalog, sizeof(__pyx_k_initCatalog), 0, 0, 1, 1},
   {&__pyx_n_s_insert, __pyx_k_insert, sizeof(__pyx_k_insert), 0, 0, 1, 1},
-  {&__pyx_n_u_int16, __pyx_k_int16, sizeof(__pyx_k_int16), 0, 1, 0, 1},
   {&__pyx_n_s_intersection, __pyx_k_intersection, sizeof(__pyx_k_intersection), 0, 0, 1, 1},
   {&__pyx_n_s_keys, __pyx_k_keys, sizeof(__pyx_k_keys), 0, 0, 1, 1},
+  {&__pyx_n_u_l, __pyx_k_l, sizeof(__pyx_k_l), 0, 1, 0, 1},
   {&__pyx_n_s_main, __pyx_k_main, sizeof(__pyx_k_main), 0, 0, 1, 1},
-  {&__pyx_kp_u_mask_must_have_type_short_np_int, __pyx_k_mask_must_have_type_short_np_int, sizeof(__pyx_k_mask_must_have_type_short_np_int), 0, 1, 0, 0},
+  {&__pyx_kp_u_mask_must_have_type_long_np_int_, __pyx_k_mask_must_have_type_long_np_int_, sizeof(__pyx_k_mask_must_have_type_long_np_int_), 0, 1, 0, 0},
   {&__pyx_n_s_maskcube, __pyx_k_maskcube, sizeof(__pyx_k_maskcube), 0, 0, 1, 1},
   {&__pyx_n_s_measurement_compact, __pyx_k_measurement_compact, sizeof(__pyx_k_measurement_compact), 0, 0, 1, 1},
   {&__pyx_n_u_measurement_compact, __pyx_k_measurement_compact, sizeof(__pyx_k_measurement_compact), 0, 1, 0, 1},
@@ -17674,7 +17674,7 @@ static int __Pyx_InitCachedConstants(void) {
  *         """Note: for each source id there must be a corresponding region (subcube) in the
  *         maskcube, having pixel values that equal source id"""
  *         assert datacube.dtype is np.dtype('float32'), 'data must have type float (np.float32 aka <f4)'             # <<<<<<<<<<<<<<
- *         assert maskcube.dtype is np.dtype('int16'), 'mask must have type short (np.int16 aka <i2)'
+ *         assert maskcube.dtype is np.dtype('l'), 'mask must have type long (np.int_ aka C long)'
  *         assert datacube.ndim == 3
  */
   __pyx_tuple__39 = PyTuple_Pack(1, __pyx_n_u_float32); if (unlikely(!__pyx_tuple__39)) __PYX_ERR(0, 612, __pyx_L1_error)
@@ -17684,11 +17684,11 @@ static int __Pyx_InitCachedConstants(void) {
   /* "cparametrizer.pyx":613
  *         maskcube, having pixel values that equal source id"""
  *         assert datacube.dtype is np.dtype('float32'), 'data must have type float (np.float32 aka <f4)'
- *         assert maskcube.dtype is np.dtype('int16'), 'mask must have type short (np.int16 aka <i2)'             # <<<<<<<<<<<<<<
+ *         assert maskcube.dtype is np.dtype('l'), 'mask must have type long (np.int_ aka C long)'             # <<<<<<<<<<<<<<
  *         assert datacube.ndim == 3
  * 
  */
-  __pyx_tuple__40 = PyTuple_Pack(1, __pyx_n_u_int16); if (unlikely(!__pyx_tuple__40)) __PYX_ERR(0, 613, __pyx_L1_error)
+  __pyx_tuple__40 = PyTuple_Pack(1, __pyx_n_u_l); if (unlikely(!__pyx_tuple__40)) __PYX_ERR(0, 613, __pyx_L1_error)
   __Pyx_GOTREF(__pyx_tuple__40);
   __Pyx_GIVEREF(__pyx_tuple__40);
 
@@ -148,9 +148,9 @@ cdef extern from "ModuleParametrisation.h":
     cdef cppclass ModuleParametrisation:
         ModuleParametrisation() except +
 
-        int run(
+        int run[T](
             float *d,
-            short *m,
+            T *m,
             long dx,
             long dy,
             long dz,
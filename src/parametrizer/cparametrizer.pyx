@@ -604,13 +604,13 @@ cdef class PyModuleParametrisation:
     def run(
             self,
             np.ndarray[float, ndim=3] datacube,
-            np.ndarray[short, ndim=3] maskcube,
+            np.ndarray[long, ndim=3] maskcube,
             PySourceCatalog initCatalog,
             ):
         """Note: for each source id there must be a corresponding region (subcube) in the
         maskcube, having pixel values that equal source id"""
         assert datacube.dtype is np.dtype('float32'), 'data must have type float (np.float32 aka <f4)'
-        assert maskcube.dtype is np.dtype('int16'), 'mask must have type short (np.int16 aka <i2)'
+        assert maskcube.dtype is np.dtype('l'), 'mask must have type long (np.int_ aka C long)'
         assert datacube.ndim == 3
 
         cdef long dz = datacube.shape[0]
@@ -618,9 +618,9 @@ cdef class PyModuleParametrisation:
         cdef long dx = datacube.shape[2]
 
         initCatalogPtr = new SourceCatalog(deref((<PySourceCatalog> initCatalog).thisptr))
-        self.thisptr.run(
+        self.thisptr.run[long](
             <float*> datacube.data,
-            <short*> maskcube.data,
+            <long*> maskcube.data,
             dx,
             dy,
             dz,
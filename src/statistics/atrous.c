@@ -0,0 +1,268 @@
+// ===================================================================
+// This module provides the à-trous convolution kernels, the hard
+// thresholding step and the sub-band noise measurement of the 2D-1D
+// wavelet denoiser. The convolutions
+// operate on a 3-D array of size nz × ny × nx stored in C order and
+// use periodic boundary conditions, i.e. the same edge handling as
+// the former Cython implementation of the denoiser. All
+// functions are parallelised with OpenMP over rows of the array.
+// ===================================================================
+
+#include <math.h>
+
+#include "statistics.h"
+
+
+
+// ---------------------
+// Internal declarations
+// ---------------------
+
+static size_t wrap_index(long i, const long n);
+static data_t atrous_pixel(const data_t *row, const size_t x, const size_t nx, const data_t *kernel, const size_t size, const size_t step);
+static void atrous_rows(data_t *out, const data_t *in, const size_t row, const size_t n_rows, const size_t n_cols, const size_t stride, const data_t *kernel, const size_t size, const size_t step);
+static data_t nth_abs(const data_t *data, const size_t size, size_t n);
+
+
+
+// ------------------------------------------
+// Map index into range [0, n) assuming that
+// the data are periodic with period n.
+// ------------------------------------------
+
+static size_t wrap_index(long i, const long n)
+{
+	if(i >= 0 && i < n) return (size_t)i;
+	i %= n;
+	return (size_t)(i < 0 ? i + n : i);
+}
+
+
+
+// ----------------------------------------------------------
+// Convolve a single pixel of a row near its edges, where the
+// kernel taps need to be wrapped around the row boundaries.
+// ----------------------------------------------------------
+
+static data_t atrous_pixel(const data_t *row, const size_t x, const size_t nx, const data_t *kernel, const size_t size, const size_t step)
+{
+	const long first = (long)x - (long)(size / 2 * step);
+	data_t a = 0.0;
+	
+	for(size_t j = 0; j < size; ++j) a += row[wrap_index(first + (long)(j * step), (long)nx)] * kernel[j];
+	
+	return a;
+}
+
+
+
+// -----------------------------------------------------------------
+// Create a single output row of an à-trous convolution along the
+// row index of a 2-D array of n_rows rows of n_cols elements each,
+// with consecutive rows being stride elements apart. The output
+// row is accumulated from entire input rows, so the inner loop runs
+// over the contiguous column index and can be vectorised.
+// -----------------------------------------------------------------
+
+static void atrous_rows(data_t *out, const data_t *in, const size_t row, const size_t n_rows, const size_t n_cols, const size_t stride, const data_t *kernel, const size_t size, const size_t step)
+{
+	data_t *restrict dst = out + row * stride;
+	const long first = (long)row - (long)(size / 2 * step);
+	
+	for(size_t col = 0; col < n_cols; ++col) dst[col] = 0.0;
+	
+	for(size_t j = 0; j < size; ++j)
+	{
+		const data_t w = kernel[j];
+		const data_t *restrict src = in + wrap_index(first + (long)(j * step), (long)n_rows) * stride;
+		for(size_t col = 0; col < n_cols; ++col) dst[col] += src[col] * w;
+	}
+	
+	return;
+}
+
+
+
+// ---------------------------------------------------------------
+// À-trous convolution along x axis; the interior of each row, for
+// which all kernel taps fall inside the row, is processed without
+// any index wrapping, while the edges are handled separately.
+// ---------------------------------------------------------------
+
+void atrous_x(data_t *out, const data_t *in, const size_t nx, const size_t ny, const size_t nz, const data_t *kernel, const size_t size, const size_t step)
+{
+	const size_t n_rows = ny * nz;
+	const size_t left = size / 2 * step;
+	const size_t right = (size - 1 - size / 2) * step;
+	
+	// Range of pixels not affected by the boundaries
+	const size_t x_min = left < nx ? left : nx;
+	const size_t x_max = right < nx - x_min ? nx - right : x_min;
+	
+	#pragma omp parallel for schedule(static)
+	for(size_t row = 0; row < n_rows; ++row)
+	{
+		data_t *restrict dst = out + row * nx;
+		const data_t *restrict src = in + row * nx;
+		
+		// Interior
+		for(size_t x = x_min; x < x_max; ++x) dst[x] = 0.0;
+		for(size_t j = 0; j < size; ++j)
+		{
+			const data_t w = kernel[j];
+			const data_t *restrict tap = src + j * step;
+			for(size_t x = x_min; x < x_max; ++x) dst[x] += tap[x - left] * w;
+		}
+		
+		// Edges
+		for(size_t x = 0; x < x_min; ++x) dst[x] = atrous_pixel(src, x, nx, kernel, size, step);
+		for(size_t x = x_max; x < nx; ++x) dst[x] = atrous_pixel(src, x, nx, kernel, size, step);
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------
+// À-trous convolution along y
+// ----------------------------
+
+void atrous_y(data_t *out, const data_t *in, const size_t nx, const size_t ny, const size_t nz, const data_t *kernel, const size_t size, const size_t step)
+{
+	const size_t plane = nx * ny;
+	
+	#pragma omp parallel for schedule(static)
+	for(size_t row = 0; row < ny * nz; ++row)
+	{
+		const size_t z = row / ny;
+		atrous_rows(out + z * plane, in + z * plane, row % ny, ny, nx, nx, kernel, size, step);
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------
+// À-trous convolution along z
+// ----------------------------
+
+void atrous_z(data_t *out, const data_t *in, const size_t nx, const size_t ny, const size_t nz, const data_t *kernel, const size_t size, const size_t step)
+{
+	const size_t plane = nx * ny;
+	
+	// Each spatial row of a plane is convolved separately
+	// for load balancing in the case of few channels.
+	#pragma omp parallel for schedule(static)
+	for(size_t row = 0; row < ny * nz; ++row)
+	{
+		const size_t z = row / ny;
+		const size_t y = row % ny;
+		atrous_rows(out + y * nx, in + y * nx, z, nz, nx, plane, kernel, size, step);
+	}
+	
+	return;
+}
+
+
+
+// -------------------------------------------------------------------
+// Hard thresholding of wavelet coefficients with multi-resolution
+// support: coefficients above threshold or already contained in the
+// support are added to the reconstruction and to the support; if
+// fix_mrs is set, only the existing support is used. The support of
+// up to eight sub-bands is packed into each byte of mrs, with bit
+// selecting the sub-band to be used.
+// -------------------------------------------------------------------
+
+void wavelet_threshold(data_t *reconstruction, const data_t *coeff, unsigned char *mrs, const size_t size, const data_t threshold, const int fix_mrs, const unsigned char bit)
+{
+	const int use_threshold = !fix_mrs && threshold >= 0.0;
+	
+	#pragma omp parallel for schedule(static)
+	for(size_t i = 0; i < size; ++i)
+	{
+		if((mrs[i] & bit) || (use_threshold && fabs(coeff[i]) > threshold))
+		{
+			reconstruction[i] += coeff[i];
+			mrs[i] |= bit;
+		}
+	}
+	
+	return;
+}
+
+
+
+// -----------------------------------------------------------------
+// Return the n-th smallest absolute value of data without modifying
+// or copying the data. As the bit patterns of non-negative floating-
+// point numbers are ordered in the same way as the numbers them-
+// selves, the element can be found by radix selection over the bit
+// patterns in three passes of 11, 10 and 10 bits each. NaN values
+// are sorted after all other values.
+// -----------------------------------------------------------------
+
+static data_t nth_abs(const data_t *data, const size_t size, size_t n)
+{
+	const unsigned int width[3] = {11, 10, 10};
+	unsigned int shift = 31;
+	uint32_t prefix = 0;
+	size_t hist[2048];
+	
+	for(int pass = 0; pass < 3; ++pass)
+	{
+		const unsigned int prev = shift;
+		const uint32_t nbins = (uint32_t)1 << width[pass];
+		shift -= width[pass];
+		
+		memset(hist, 0, sizeof(hist));
+		
+		// Histogram of next bits of all elements matching the current prefix
+		#pragma omp parallel
+		{
+			size_t local[2048] = {0};
+			
+			#pragma omp for schedule(static)
+			for(size_t i = 0; i < size; ++i)
+			{
+				uint32_t u;
+				memcpy(&u, data + i, sizeof(uint32_t));
+				u &= 0x7fffffff;
+				if(prev == 31 || (u >> prev) == prefix) ++local[(u >> shift) & (nbins - 1)];
+			}
+			
+			#pragma omp critical
+			for(uint32_t b = 0; b < nbins; ++b) hist[b] += local[b];
+		}
+		
+		// Find bin containing n-th element
+		uint32_t b = 0;
+		while(n >= hist[b]) n -= hist[b++];
+		prefix = (prefix << width[pass]) | b;
+	}
+	
+	data_t result;
+	memcpy(&result, &prefix, sizeof(data_t));
+	return result;
+}
+
+
+
+// ---------------------------------------------------
+// Median of absolute values of data (same as NumPy's
+// median, i.e. the mean of the two central elements
+// is returned for an even number of elements)
+// ---------------------------------------------------
+
+data_t median_abs(const data_t *data, const size_t size)
+{
+	if(size == 0) return NAN;
+	
+	const data_t upper = nth_abs(data, size, size / 2);
+	if(size % 2) return upper;
+	
+	const data_t lower = nth_abs(data, size, size / 2 - 1);
+	return (data_t)(lower + upper) / 2;
+}
@@ -0,0 +1,454 @@
+// ===================================================================
+// This module provides the separable convolution filters used by the
+// S+C finder. All filters operate in place on a 3-D array of size
+// nz × ny × nx stored in C order (i.e. with x being the fastest-vary-
+// ing axis, as in NumPy) and are parallelised with OpenMP over planes
+// or rows of the array. Edge handling follows that of scipy.ndimage.
+// ===================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "statistics.h"
+
+// Truncation radius of Gaussian kernels in units of sigma (same as in scipy.ndimage)
+#define GAUSS_TRUNCATE 4.0
+
+
+
+// ---------------------
+// Internal declarations
+// ---------------------
+
+static void *filter_alloc(const size_t n, const size_t size);
+static long edge_index(long i, const long n, const int edge_mode);
+static data_t *gauss_kernel(const double sigma, size_t *radius);
+static void convolve_rows(data_t *out, const data_t *in, const size_t n_rows, const size_t n_cols, const data_t *kernel, const size_t radius, const int edge_mode);
+static void gauss_plane(data_t *data, data_t *line, data_t *buffer, const size_t nx, const size_t ny, const data_t *kernel_x, const size_t radius_x, const data_t *kernel_y, const size_t radius_y, const int edge_mode);
+
+
+
+// --------------------------------------------------
+// Allocate zeroed memory and exit with error message
+// --------------------------------------------------
+
+static void *filter_alloc(const size_t n, const size_t size)
+{
+	void *ptr = calloc(n, size);
+	
+	if(ptr == NULL)
+	{
+		fprintf(stderr, "ERROR: Failed to allocate memory for convolution.\n");
+		exit(1);
+	}
+	
+	return ptr;
+}
+
+
+
+// ----------------------------------------------------------
+// Map index outside of [0, n) back into range based on edge
+// mode; returns -1 if the pixel is to be treated as zero.
+// ----------------------------------------------------------
+
+static long edge_index(long i, const long n, const int edge_mode)
+{
+	if(i >= 0 && i < n) return i;
+	
+	switch(edge_mode)
+	{
+		case EDGE_NEAREST:
+			return i < 0 ? 0 : n - 1;
+		
+		case EDGE_WRAP:
+			i %= n;
+			return i < 0 ? i + n : i;
+		
+		case EDGE_REFLECT:
+			// (d c b a | a b c d | d c b a)
+			i %= 2 * n;
+			if(i < 0) i += 2 * n;
+			return i < n ? i : 2 * n - 1 - i;
+		
+		case EDGE_MIRROR:
+			// (d c b | a b c d | c b a)
+			if(n == 1) return 0;
+			i %= 2 * n - 2;
+			if(i < 0) i += 2 * n - 2;
+			return i < n ? i : 2 * n - 2 - i;
+		
+		default:
+			return -1;
+	}
+}
+
+
+
+// -------------------------------------------------------------
+// Create normalised half-kernel of truncated Gaussian; element 0
+// holds the central weight and element k the weight at offset ±k.
+// -------------------------------------------------------------
+
+static data_t *gauss_kernel(const double sigma, size_t *radius)
+{
+	*radius = (size_t)(GAUSS_TRUNCATE * sigma + 0.5);
+	
+	data_t *kernel = (data_t *)filter_alloc(*radius + 1, sizeof(data_t));
+	double *weights = (double *)filter_alloc(*radius + 1, sizeof(double));
+	double norm = 0.0;
+	
+	for(size_t k = 0; k <= *radius; ++k)
+	{
+		weights[k] = exp(-0.5 * (double)(k * k) / (sigma * sigma));
+		norm += k ? 2.0 * weights[k] : weights[k];
+	}
+	
+	for(size_t k = 0; k <= *radius; ++k) kernel[k] = weights[k] / norm;
+	
+	free(weights);
+	return kernel;
+}
+
+
+
+// ---------------------------------------------------------------
+// Convolve the rows of a 2-D array with a symmetric kernel along
+// the row index. Each output row is accumulated as a weighted sum
+// of entire input rows, so the inner loop runs over the contiguous
+// column index without any bounds checks and can be vectorised.
+// ---------------------------------------------------------------
+
+static void convolve_rows(data_t *out, const data_t *in, const size_t n_rows, const size_t n_cols, const data_t *kernel, const size_t radius, const int edge_mode)
+{
+	for(size_t row = 0; row < n_rows; ++row)
+	{
+		data_t *restrict dst = out + row * n_cols;
+		const data_t *restrict src = in + row * n_cols;
+		const data_t w0 = kernel[0];
+		
+		for(size_t col = 0; col < n_cols; ++col) dst[col] = w0 * src[col];
+		
+		for(size_t k = 1; k <= radius; ++k)
+		{
+			const data_t w = kernel[k];
+			const long row1 = edge_index((long)row - (long)k, (long)n_rows, edge_mode);
+			const long row2 = edge_index((long)row + (long)k, (long)n_rows, edge_mode);
+			
+			if(row1 >= 0 && row2 >= 0)
+			{
+				const data_t *restrict src1 = in + row1 * n_cols;
+				const data_t *restrict src2 = in + row2 * n_cols;
+				for(size_t col = 0; col < n_cols; ++col) dst[col] += w * (src1[col] + src2[col]);
+			}
+			else if(row1 >= 0 || row2 >= 0)
+			{
+				const data_t *restrict src1 = in + (row1 >= 0 ? row1 : row2) * n_cols;
+				for(size_t col = 0; col < n_cols; ++col) dst[col] += w * src1[col];
+			}
+		}
+	}
+	
+	return;
+}
+
+
+
+// -------------------------------------------------------
+// Re-insert NaN values of the original data into the copy
+// -------------------------------------------------------
+
+void sc_restore_nan(data_t *work, const data_t *data, const size_t size)
+{
+	#pragma omp parallel for schedule(static)
+	for(size_t i = 0; i < size; ++i)
+	{
+		if(is_nan(data[i])) work[i] = NAN;
+	}
+	
+	return;
+}
+
+
+
+// ---------------------------------------------------------
+// Gaussian filter of a single spatial plane; line must hold
+// nx + 2 * radius_x and buffer nx * ny elements.
+// ---------------------------------------------------------
+
+static void gauss_plane(data_t *data, data_t *line, data_t *buffer, const size_t nx, const size_t ny, const data_t *kernel_x, const size_t radius_x, const data_t *kernel_y, const size_t radius_y, const int edge_mode)
+{
+	// Filter along x axis
+	if(radius_x)
+	{
+		for(size_t y = 0; y < ny; ++y)
+		{
+			data_t *restrict row = data + y * nx;
+			
+			// Fill line buffer, including edges
+			memcpy(line + radius_x, row, nx * sizeof(data_t));
+			for(size_t k = 1; k <= radius_x; ++k)
+			{
+				const long i1 = edge_index(-(long)k, (long)nx, edge_mode);
+				const long i2 = edge_index((long)(nx - 1 + k), (long)nx, edge_mode);
+				line[radius_x - k] = i1 >= 0 ? row[i1] : 0.0;
+				line[radius_x + nx - 1 + k] = i2 >= 0 ? row[i2] : 0.0;
+			}
+			
+			const data_t *restrict centre = line + radius_x;
+			const data_t w0 = kernel_x[0];
+			for(size_t x = 0; x < nx; ++x) row[x] = w0 * centre[x];
+			
+			for(size_t k = 1; k <= radius_x; ++k)
+			{
+				const data_t w = kernel_x[k];
+				const data_t *restrict left  = centre - k;
+				const data_t *restrict right = centre + k;
+				for(size_t x = 0; x < nx; ++x) row[x] += w * (left[x] + right[x]);
+			}
+		}
+	}
+	
+	// Filter along y axis
+	if(radius_y)
+	{
+		memcpy(buffer, data, nx * ny * sizeof(data_t));
+		convolve_rows(data, buffer, ny, nx, kernel_y, radius_y, edge_mode);
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------------------------
+// Gaussian filter across spatial planes (x and y)
+// ----------------------------------------------
+
+void filter_gauss_xy(data_t *data, const size_t nx, const size_t ny, const size_t nz, const double sigma_x, const double sigma_y, const int edge_mode)
+{
+	size_t radius_x = 0;
+	size_t radius_y = 0;
+	data_t *kernel_x = sigma_x > 0.0 ? gauss_kernel(sigma_x, &radius_x) : NULL;
+	data_t *kernel_y = sigma_y > 0.0 ? gauss_kernel(sigma_y, &radius_y) : NULL;
+	
+	if(radius_x || radius_y)
+	{
+		#pragma omp parallel
+		{
+			data_t *line   = (data_t *)filter_alloc(nx + 2 * radius_x, sizeof(data_t));
+			data_t *buffer = (data_t *)filter_alloc(nx * ny, sizeof(data_t));
+			
+			#pragma omp for schedule(static)
+			for(size_t z = 0; z < nz; ++z) gauss_plane(data + z * nx * ny, line, buffer, nx, ny, kernel_x, radius_x, kernel_y, radius_y, edge_mode);
+			
+			free(line);
+			free(buffer);
+		}
+	}
+	
+	free(kernel_x);
+	free(kernel_y);
+	return;
+}
+
+
+
+// ----------------------------------------------------------------
+// S+C finder: copy data into work array, replacing NaN with 0 and
+// clipping pixels already contained in the mask to ±clip, and then
+// apply spatial Gaussian filter. If planes is not NULL, only those
+// spatial planes z with planes[z] != 0 will be processed, allowing
+// a cached, spatially smoothed cube to be updated after new pixels
+// have been added to the mask.
+// ----------------------------------------------------------------
+
+void sc_smooth_xy(data_t *work, const data_t *data, const unsigned char *mask, const size_t nx, const size_t ny, const size_t nz, const data_t clip, const double sigma_x, const double sigma_y, const int edge_mode, const unsigned char *planes)
+{
+	const size_t size_xy = nx * ny;
+	size_t radius_x = 0;
+	size_t radius_y = 0;
+	data_t *kernel_x = sigma_x > 0.0 ? gauss_kernel(sigma_x, &radius_x) : NULL;
+	data_t *kernel_y = sigma_y > 0.0 ? gauss_kernel(sigma_y, &radius_y) : NULL;
+	
+	#pragma omp parallel
+	{
+		data_t *line   = (data_t *)filter_alloc(nx + 2 * radius_x, sizeof(data_t));
+		data_t *buffer = (data_t *)filter_alloc(size_xy, sizeof(data_t));
+		
+		#pragma omp for schedule(dynamic)
+		for(size_t z = 0; z < nz; ++z)
+		{
+			if(planes != NULL && !planes[z]) continue;
+			
+			data_t *restrict dst = work + z * size_xy;
+			const data_t *restrict src = data + z * size_xy;
+			const unsigned char *restrict msk = mask + z * size_xy;
+			
+			for(size_t i = 0; i < size_xy; ++i)
+			{
+				data_t value = src[i];
+				
+				if(is_nan(value)) value = 0.0;
+				else if(msk[i])
+				{
+					if(value > 0.0) value = clip;
+					else if(value < 0.0) value = -clip;
+				}
+				
+				dst[i] = value;
+			}
+			
+			if(radius_x || radius_y) gauss_plane(dst, line, buffer, nx, ny, kernel_x, radius_x, kernel_y, radius_y, edge_mode);
+		}
+		
+		free(line);
+		free(buffer);
+	}
+	
+	free(kernel_x);
+	free(kernel_y);
+	return;
+}
+
+
+
+// -----------------------------------------------------------------
+// S+C finder: add pixels with |data| >= threshold to mask and flag
+// the spatial planes in which new pixels were added in changed (if
+// not NULL). Returns the number of newly added pixels.
+// -----------------------------------------------------------------
+
+size_t sc_update_mask(unsigned char *mask, const data_t *data, const size_t nx, const size_t ny, const size_t nz, const data_t threshold, unsigned char *changed)
+{
+	const size_t size_xy = nx * ny;
+	size_t counter = 0;
+	
+	#pragma omp parallel for schedule(static) reduction(+:counter)
+	for(size_t z = 0; z < nz; ++z)
+	{
+		unsigned char *restrict msk = mask + z * size_xy;
+		const data_t *restrict src = data + z * size_xy;
+		size_t added = 0;
+		
+		for(size_t i = 0; i < size_xy; ++i)
+		{
+			if(fabs(src[i]) >= threshold && !msk[i])
+			{
+				msk[i] = 1U;
+				++added;
+			}
+		}
+		
+		if(added && changed != NULL) changed[z] = 1U;
+		counter += added;
+	}
+	
+	return counter;
+}
+
+
+
+// -------------------------------------
+// Gaussian filter along spectral axis z
+// -------------------------------------
+
+void filter_gauss_z(data_t *data, const size_t nx, const size_t ny, const size_t nz, const double sigma, const int edge_mode)
+{
+	if(sigma <= 0.0) return;
+	
+	size_t radius = 0;
+	data_t *kernel = gauss_kernel(sigma, &radius);
+	
+	if(radius == 0)
+	{
+		free(kernel);
+		return;
+	}
+	
+	#pragma omp parallel
+	{
+		// Buffers holding one x-z slice of the cube
+		data_t *slice_in  = (data_t *)filter_alloc(nx * nz, sizeof(data_t));
+		data_t *slice_out = (data_t *)filter_alloc(nx * nz, sizeof(data_t));
+		
+		#pragma omp for schedule(static)
+		for(size_t y = 0; y < ny; ++y)
+		{
+			for(size_t z = 0; z < nz; ++z) memcpy(slice_in + z * nx, data + (z * ny + y) * nx, nx * sizeof(data_t));
+			convolve_rows(slice_out, slice_in, nz, nx, kernel, radius, edge_mode);
+			for(size_t z = 0; z < nz; ++z) memcpy(data + (z * ny + y) * nx, slice_out + z * nx, nx * sizeof(data_t));
+		}
+		
+		free(slice_in);
+		free(slice_out);
+	}
+	
+	free(kernel);
+	return;
+}
+
+
+
+// ------------------------------------------------------------
+// Boxcar filter along spectral axis z using a running sum; the
+// window covers [z - width / 2, z - width / 2 + width - 1] as in
+// scipy.ndimage.uniform_filter1d.
+// ------------------------------------------------------------
+
+void filter_boxcar_z(data_t *data, const size_t nx, const size_t ny, const size_t nz, const size_t width, const int edge_mode)
+{
+	if(width < 2) return;
+	
+	const long lo = (long)(width / 2);
+	const long hi = (long)width - 1 - lo;
+	const double inv_width = 1.0 / (double)width;
+	
+	#pragma omp parallel
+	{
+		data_t *slice = (data_t *)filter_alloc(nx * nz, sizeof(data_t));
+		double *acc = (double *)filter_alloc(nx, sizeof(double));
+		
+		#pragma omp for schedule(static)
+		for(size_t y = 0; y < ny; ++y)
+		{
+			for(size_t z = 0; z < nz; ++z) memcpy(slice + z * nx, data + (z * ny + y) * nx, nx * sizeof(data_t));
+			
+			// Initial sum across window of first channel
+			for(size_t x = 0; x < nx; ++x) acc[x] = 0.0;
+			for(long i = -lo; i <= hi; ++i)
+			{
+				const long zz = edge_index(i, (long)nz, edge_mode);
+				if(zz < 0) continue;
+				const data_t *restrict src = slice + zz * nx;
+				for(size_t x = 0; x < nx; ++x) acc[x] += src[x];
+			}
+			
+			for(size_t z = 0; z < nz; ++z)
+			{
+				data_t *restrict dst = data + (z * ny + y) * nx;
+				for(size_t x = 0; x < nx; ++x) dst[x] = acc[x] * inv_width;
+				
+				// Slide window by one channel
+				const long z_add = edge_index((long)z + hi + 1, (long)nz, edge_mode);
+				const long z_sub = edge_index((long)z - lo, (long)nz, edge_mode);
+				if(z_add >= 0)
+				{
+					const data_t *restrict src = slice + z_add * nx;
+					for(size_t x = 0; x < nx; ++x) acc[x] += src[x];
+				}
+				if(z_sub >= 0)
+				{
+					const data_t *restrict src = slice + z_sub * nx;
+					for(size_t x = 0; x < nx; ++x) acc[x] -= src[x];
+				}
+			}
+		}
+		
+		free(slice);
+		free(acc);
+	}
+	
+	return;
+}
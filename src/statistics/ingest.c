@@ -0,0 +1,107 @@
+// ===================================================================
+// This module provides the ingest kernel used when reading uncomp-
+// ressed single-precision FITS data. Each plane of nx × ny elements
+// is converted from FITS (big-endian) to native byte order, scaled
+// and copied into a C-contiguous output array in a single pass, and
+// the number of NaN values as well as the minimum and maximum of all
+// other values are recorded on the way, so that later stages of the
+// pipeline do not need to scan the entire cube again.
+// ===================================================================
+
+#include <math.h>
+
+#include "statistics.h"
+
+
+
+// Number of elements converted at a time
+#define INGEST_CHUNK 1024
+
+
+
+// ----------------------------------------------------------------
+// Convert a plane of ny rows of nx single-precision values each,
+// with consecutive rows of the input being stride elements apart,
+// into a contiguous plane of native byte order, swapping bytes if
+// requested and applying BSCALE and BZERO in the same order and at
+// the same precision as NumPy's in-place operators would; returns
+// the number of NaN values and sets range[0] and range[1] to the
+// minimum and maximum of all other values, or to NaN if there are
+// none. The minimum and maximum are determined on integer keys that
+// are ordered in the same way as the floating-point values (except
+// for -0 < +0), so that all loops can be vectorised.
+// ----------------------------------------------------------------
+
+size_t ingest_plane(data_t *out, const data_t *in, const size_t nx, const size_t ny, const size_t stride, const int swap, const double scale, const double zero, data_t *range)
+{
+	const data_t f_scale = (data_t)scale;
+	const data_t f_zero = (data_t)zero;
+	const int do_scale = (scale != 1.0);
+	const int do_zero = (zero != 0.0);
+	int32_t key_min = INT32_MAX;
+	int32_t key_max = INT32_MIN;
+	size_t n_nan = 0;
+	
+	#pragma omp parallel for schedule(static) reduction(min:key_min) reduction(max:key_max) reduction(+:n_nan)
+	for(size_t y = 0; y < ny; ++y)
+	{
+		uint32_t bits[INGEST_CHUNK];
+		
+		for(size_t x0 = 0; x0 < nx; x0 += INGEST_CHUNK)
+		{
+			const size_t n = nx - x0 < INGEST_CHUNK ? nx - x0 : INGEST_CHUNK;
+			data_t *dst = out + y * nx + x0;
+			
+			// Conversion
+			memcpy(bits, in + y * stride + x0, n * sizeof(uint32_t));
+			if(swap)
+			{
+				// Swap bytes in two separate steps, as the compiler would otherwise
+				// recognise a byte swap, which cannot be vectorised without SSSE3.
+				for(size_t i = 0; i < n; ++i) bits[i] = ((bits[i] & 0x00ff00ffu) << 8) | ((bits[i] >> 8) & 0x00ff00ffu);
+				for(size_t i = 0; i < n; ++i) bits[i] = (bits[i] << 16) | (bits[i] >> 16);
+			}
+			memcpy(dst, bits, n * sizeof(uint32_t));
+			if(do_scale || do_zero)
+			{
+				if(do_scale) for(size_t i = 0; i < n; ++i) dst[i] *= f_scale;
+				if(do_zero) for(size_t i = 0; i < n; ++i) dst[i] += f_zero;
+				memcpy(bits, dst, n * sizeof(uint32_t));
+			}
+			
+			// Statistics
+			uint32_t chunk_nan = 0;
+			int32_t chunk_min = INT32_MAX;
+			int32_t chunk_max = INT32_MIN;
+			for(size_t i = 0; i < n; ++i)
+			{
+				const int32_t u = (int32_t)bits[i];
+				const int32_t key = u ^ ((u >> 31) & INT32_MAX);
+				const int32_t nan = -((u & INT32_MAX) > 0x7f800000);
+				const int32_t key_lo = (key & ~nan) | (INT32_MAX & nan);
+				const int32_t key_hi = (key & ~nan) | (INT32_MIN & nan);
+				chunk_nan -= nan;
+				chunk_min = key_lo < chunk_min ? key_lo : chunk_min;
+				chunk_max = key_hi > chunk_max ? key_hi : chunk_max;
+			}
+			n_nan += chunk_nan;
+			if(chunk_min < key_min) key_min = chunk_min;
+			if(chunk_max > key_max) key_max = chunk_max;
+		}
+	}
+	
+	if(n_nan == nx * ny)
+	{
+		range[0] = range[1] = NAN;
+	}
+	else
+	{
+		// Convert keys back into values
+		key_min ^= (key_min >> 31) & INT32_MAX;
+		key_max ^= (key_max >> 31) & INT32_MAX;
+		memcpy(range, &key_min, sizeof(data_t));
+		memcpy(range + 1, &key_max, sizeof(data_t));
+	}
+	
+	return n_nan;
+}
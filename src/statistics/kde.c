@@ -0,0 +1,209 @@
+// ===================================================================
+// This module provides the evaluation of Gaussian kernel density
+// estimates with a full covariance matrix, as used by the reliabil-
+// ity calculation in low-dimensional parameter spaces. Points and
+// targets are first transformed into a whitened space in which the
+// kernel is isotropic with unit width. The points are then sorted
+// into a uniform grid spanned by the first two whitened axes with a
+// cell size of at least the truncation radius of the kernel, so that
+// only the neighbouring cells of each target need to be visited.
+// The evaluation is parallelised with OpenMP over targets.
+// ===================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "statistics.h"
+
+
+
+// Maximum number of grid cells per point
+#define KDE_CELLS_PER_POINT 4
+
+
+
+// ---------------------
+// Internal declarations
+// ---------------------
+
+static double *kde_whiten(const double *data, const size_t n, const size_t dim, const double *whiten);
+static size_t kde_cell(const double value, const double origin, const double cell_size, const size_t n_cells);
+
+
+
+// -----------------------------------------------------------------
+// Transform n vectors of dimension dim, stored as dim rows of n
+// elements each, by the upper triangular matrix whiten; returns a
+// newly allocated array of n rows of dim elements each.
+// -----------------------------------------------------------------
+
+static double *kde_whiten(const double *data, const size_t n, const size_t dim, const double *whiten)
+{
+	double *result = (double *)malloc(n * dim * sizeof(double));
+	if(result == NULL)
+	{
+		fprintf(stderr, "ERROR: Failed to allocate memory for kernel density estimation.\n");
+		exit(1);
+	}
+	
+	#pragma omp parallel for schedule(static)
+	for(size_t i = 0; i < n; ++i)
+	{
+		for(size_t a = 0; a < dim; ++a)
+		{
+			double sum = 0.0;
+			for(size_t b = a; b < dim; ++b) sum += whiten[a * dim + b] * data[b * n + i];
+			result[i * dim + a] = sum;
+		}
+	}
+	
+	return result;
+}
+
+
+
+// ------------------------------------------------------
+// Index of grid cell containing value, clipped to grid
+// ------------------------------------------------------
+
+static size_t kde_cell(const double value, const double origin, const double cell_size, const size_t n_cells)
+{
+	const double cell = floor((value - origin) / cell_size);
+	if(cell < 0.0) return 0;
+	if(cell >= (double)(n_cells - 1)) return n_cells - 1;
+	return (size_t)cell;
+}
+
+
+
+// --------------------------------------------------------------------
+// Sum of Gaussian kernels centred on n_points points at each of the
+// n_targets targets, with points and targets of dimension dim stored
+// as dim rows of n elements each (the layout used by SciPy). The ker-
+// nel is defined by the upper triangular matrix whiten, the transpose
+// of the Cholesky factor of the inverse covariance matrix, such that
+// the exponent of the kernel is -|whiten * d|^2 / 2 for a separation
+// d. Contributions beyond cutoff kernel widths are neglected. The
+// kernels are not normalised.
+// --------------------------------------------------------------------
+
+void kde_evaluate(const double *points, const size_t n_points, const double *targets, const size_t n_targets, const size_t dim, const double *whiten, const double cutoff, double *density)
+{
+	if(n_points == 0 || dim == 0)
+	{
+		for(size_t i = 0; i < n_targets; ++i) density[i] = 0.0;
+		return;
+	}
+	
+	// Whitened points and targets
+	double *wp = kde_whiten(points, n_points, dim, whiten);
+	double *wt = kde_whiten(targets, n_targets, dim, whiten);
+	const size_t n_axes = dim < 2 ? dim : 2;
+	const double cutoff_sq = cutoff * cutoff;
+	
+	// Extent of points along grid axes
+	double origin[2] = {0.0, 0.0};
+	double extent[2] = {0.0, 0.0};
+	for(size_t a = 0; a < n_axes; ++a)
+	{
+		double lo = wp[a], hi = wp[a];
+		for(size_t i = 1; i < n_points; ++i)
+		{
+			const double value = wp[i * dim + a];
+			if(value < lo) lo = value;
+			if(value > hi) hi = value;
+		}
+		origin[a] = lo;
+		extent[a] = hi - lo;
+	}
+	
+	// Grid cells must not be smaller than the cutoff radius; they are
+	// enlarged if the grid would otherwise be too sparsely populated.
+	double cell_size = cutoff;
+	size_t n_cells[2] = {1, 1};
+	for(;;)
+	{
+		for(size_t a = 0; a < n_axes; ++a) n_cells[a] = (size_t)(extent[a] / cell_size) + 1;
+		if(n_cells[0] * n_cells[1] <= KDE_CELLS_PER_POINT * n_points) break;
+		cell_size *= 2.0;
+	}
+	
+	// Sort points into grid cells (counting sort)
+	size_t *cell_start = (size_t *)calloc(n_cells[0] * n_cells[1] + 1, sizeof(size_t));
+	size_t *cell_of = (size_t *)malloc(n_points * sizeof(size_t));
+	double *sorted = (double *)malloc(n_points * dim * sizeof(double));
+	if(cell_start == NULL || cell_of == NULL || sorted == NULL)
+	{
+		fprintf(stderr, "ERROR: Failed to allocate memory for kernel density estimation.\n");
+		exit(1);
+	}
+	
+	for(size_t i = 0; i < n_points; ++i)
+	{
+		size_t cell = kde_cell(wp[i * dim], origin[0], cell_size, n_cells[0]);
+		if(n_axes > 1) cell += n_cells[0] * kde_cell(wp[i * dim + 1], origin[1], cell_size, n_cells[1]);
+		cell_of[i] = cell;
+		++cell_start[cell + 1];
+	}
+	for(size_t c = 0; c < n_cells[0] * n_cells[1]; ++c) cell_start[c + 1] += cell_start[c];
+	for(size_t i = 0; i < n_points; ++i)
+	{
+		// cell_start[c] is used as insertion counter and restored below
+		memcpy(sorted + cell_start[cell_of[i]]++ * dim, wp + i * dim, dim * sizeof(double));
+	}
+	for(size_t c = n_cells[0] * n_cells[1]; c > 0; --c) cell_start[c] = cell_start[c - 1];
+	cell_start[0] = 0;
+	
+	free(cell_of);
+	free(wp);
+	
+	// Evaluate density at each target from the neighbouring cells
+	#pragma omp parallel for schedule(dynamic, 256)
+	for(size_t j = 0; j < n_targets; ++j)
+	{
+		const double *target = wt + j * dim;
+		size_t c_min[2] = {0, 0};
+		size_t c_max[2] = {0, 0};
+		int outside = 0;
+		
+		for(size_t a = 0; a < n_axes; ++a)
+		{
+			const double lo = floor((target[a] - cutoff - origin[a]) / cell_size);
+			const double hi = floor((target[a] + cutoff - origin[a]) / cell_size);
+			if(hi < 0.0 || lo > (double)(n_cells[a] - 1)) outside = 1;
+			c_min[a] = lo < 0.0 ? 0 : (size_t)lo;
+			c_max[a] = hi > (double)(n_cells[a] - 1) ? n_cells[a] - 1 : (size_t)hi;
+		}
+		
+		double sum = 0.0;
+		if(!outside)
+		{
+			for(size_t cy = c_min[1]; cy <= c_max[1]; ++cy)
+			{
+				const size_t first = cell_start[cy * n_cells[0] + c_min[0]];
+				const size_t last = cell_start[cy * n_cells[0] + c_max[0] + 1];
+				
+				for(size_t i = first; i < last; ++i)
+				{
+					const double *point = sorted + i * dim;
+					double dist_sq = 0.0;
+					for(size_t a = 0; a < dim; ++a)
+					{
+						const double d = point[a] - target[a];
+						dist_sq += d * d;
+					}
+					if(dist_sq <= cutoff_sq) sum += exp(-0.5 * dist_sq);
+				}
+			}
+		}
+		
+		density[j] = sum;
+	}
+	
+	free(sorted);
+	free(cell_start);
+	free(wt);
+	
+	return;
+}
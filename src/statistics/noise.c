@@ -0,0 +1,570 @@
+// ===================================================================
+// This module provides the local noise measurement used for noise
+// scaling of a data cube of size nz × ny × nx stored in C order. The
+// noise is measured in windows centred on the points of a regular
+// grid and then applied to the data, either per grid cell or with
+// linear interpolation in between the grid points along one axis
+// after the other. The windows of each row of grid points along the
+// x axis form a tile that is processed by a single thread, with the
+// window being moved along the row by only adding and removing the
+// columns that enter and leave it. For the MAD, the absolute values
+// in the window are tracked in a histogram over the upper bits of
+// their bit patterns (which are ordered in the same way as the val-
+// ues themselves), so that only the values in the bins containing
+// the median need to be looked at. The results are identical to
+// those of GetRMS() in sofia/functions.py for the same windows.
+// ===================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "statistics.h"
+
+// Histogram bins are defined by the upper 16 bits of the absolute
+// value's bit pattern and grouped into 256 blocks for faster look-up.
+#define NOISE_BIN_SHIFT   15
+#define NOISE_BINS        65536
+#define NOISE_BLOCK_SHIFT 8
+#define NOISE_BLOCKS      256
+
+// Number of columns processed together during interpolation
+#define NOISE_CHUNK 256
+
+// Conversion factor between MAD and STD as used by GetRMS()
+#define NOISE_MAD_TO_STD 1.4826
+
+// Rolling histogram of the absolute values in a window
+typedef struct
+{
+	size_t *bins;
+	size_t blocks[NOISE_BLOCKS];
+	size_t n_range;
+	size_t n_valid;
+} noise_hist_t;
+
+
+
+// ---------------------
+// Internal declarations
+// ---------------------
+
+static inline int in_flux_range(const data_t value, const int flux_range);
+static inline uint32_t abs_bits(const data_t value);
+static void hist_update(noise_hist_t *hist, const data_t *data, const size_t nx, const size_t ny, const size_t z_min, const size_t z_max, const size_t y_min, const size_t y_max, const size_t x_min, const size_t x_max, const int flux_range, const size_t step);
+static void hist_find(const noise_hist_t *hist, size_t n, uint32_t *bin, size_t *rank);
+static double window_mad(const noise_hist_t *hist, const data_t *data, const size_t nx, const size_t ny, const size_t z_min, const size_t z_max, const size_t y_min, const size_t y_max, const size_t x_min, const size_t x_max, const int flux_range, data_t *buffer);
+static void interpolate_axis(data_t *base, const size_t stride, const size_t n, const int64_t *knots, const size_t n_knots, const size_t width, data_t *values, size_t *valid, size_t *count, size_t *index);
+
+
+
+// --------------------------------------------------------
+// Check if value falls into flux range (0 = all non-NaN,
+// -1 = negative, +1 = positive), same as in stddev()
+// --------------------------------------------------------
+
+static inline int in_flux_range(const data_t value, const int flux_range)
+{
+	return (!flux_range && !is_nan(value)) || (flux_range < 0 && value < 0.0) || (flux_range > 0 && value > 0.0);
+}
+
+
+
+// -------------------------------------
+// Bit pattern of absolute value of data
+// -------------------------------------
+
+static inline uint32_t abs_bits(const data_t value)
+{
+	uint32_t u;
+	memcpy(&u, &value, sizeof(uint32_t));
+	return u & 0x7fffffff;
+}
+
+
+
+// ----------------------------------------------------------------
+// Add (step = 1) or remove (step = SIZE_MAX, i.e. -1 in unsigned
+// arithmetic) the values in the given box to or from the histogram
+// ----------------------------------------------------------------
+
+static void hist_update(noise_hist_t *hist, const data_t *data, const size_t nx, const size_t ny, const size_t z_min, const size_t z_max, const size_t y_min, const size_t y_max, const size_t x_min, const size_t x_max, const int flux_range, const size_t step)
+{
+	for(size_t z = z_min; z < z_max; ++z)
+	{
+		for(size_t y = y_min; y < y_max; ++y)
+		{
+			const data_t *row = data + (z * ny + y) * nx;
+			
+			for(size_t x = x_min; x < x_max; ++x)
+			{
+				if(is_nan(row[x])) continue;
+				hist->n_valid += step;
+				
+				if(in_flux_range(row[x], flux_range))
+				{
+					const uint32_t bin = abs_bits(row[x]) >> NOISE_BIN_SHIFT;
+					hist->bins[bin] += step;
+					hist->blocks[bin >> NOISE_BLOCK_SHIFT] += step;
+					hist->n_range += step;
+				}
+			}
+		}
+	}
+	
+	return;
+}
+
+
+
+// ---------------------------------------------------------
+// Find histogram bin containing the n-th smallest absolute
+// value and the rank of that value within the bin
+// ---------------------------------------------------------
+
+static void hist_find(const noise_hist_t *hist, size_t n, uint32_t *bin, size_t *rank)
+{
+	uint32_t block = 0;
+	while(n >= hist->blocks[block]) n -= hist->blocks[block++];
+	
+	uint32_t b = block << NOISE_BLOCK_SHIFT;
+	while(n >= hist->bins[b]) n -= hist->bins[b++];
+	
+	*bin = b;
+	*rank = n;
+	return;
+}
+
+
+
+// --------------------------------------------------------------
+// MAD of the values in the given window (assuming a median of 0)
+// converted to standard deviation. The histogram must describe
+// the same window. Only the values in the one or two bins con-
+// taining the central elements are copied into buffer for exact
+// selection. Returns NaN if there are no values in flux range.
+// --------------------------------------------------------------
+
+static double window_mad(const noise_hist_t *hist, const data_t *data, const size_t nx, const size_t ny, const size_t z_min, const size_t z_max, const size_t y_min, const size_t y_max, const size_t x_min, const size_t x_max, const int flux_range, data_t *buffer)
+{
+	const size_t n = hist->n_range;
+	if(n == 0) return NAN;
+	
+	// Locate central elements
+	uint32_t bin_hi, bin_lo;
+	size_t rank_hi, rank_lo;
+	hist_find(hist, n / 2, &bin_hi, &rank_hi);
+	if(n % 2) { bin_lo = bin_hi; rank_lo = rank_hi; }
+	else hist_find(hist, n / 2 - 1, &bin_lo, &rank_lo);
+	
+	// Copy values in those bins, with the lower bin first
+	data_t *lower = buffer;
+	data_t *upper = buffer + (bin_lo == bin_hi ? 0 : hist->bins[bin_lo]);
+	size_t n_lower = 0;
+	size_t n_upper = 0;
+	
+	for(size_t z = z_min; z < z_max; ++z)
+	{
+		for(size_t y = y_min; y < y_max; ++y)
+		{
+			const data_t *row = data + (z * ny + y) * nx;
+			
+			for(size_t x = x_min; x < x_max; ++x)
+			{
+				const uint32_t bin = abs_bits(row[x]) >> NOISE_BIN_SHIFT;
+				if((bin == bin_hi || bin == bin_lo) && in_flux_range(row[x], flux_range))
+				{
+					if(bin == bin_hi) upper[n_upper++] = fabs(row[x]);
+					else lower[n_lower++] = fabs(row[x]);
+				}
+			}
+		}
+	}
+	
+	// Select central elements
+	const data_t value_hi = nth_element(upper, n_upper, rank_hi);
+	if(n % 2) return NOISE_MAD_TO_STD * value_hi;
+	
+	const data_t value_lo = bin_lo == bin_hi ? max(upper, rank_hi) : nth_element(lower, n_lower, rank_lo);
+	return NOISE_MAD_TO_STD * (data_t)((value_lo + value_hi) / 2);
+}
+
+
+
+// -------------------------------------------------------------------
+// Measure noise in windows of size (2 * radius_xy + 1) spatially and
+// (2 * radius_z + 1) spectrally, truncated at the cube boundaries,
+// centred on the grid points given by the Cartesian product of the
+// coordinates grid_x, grid_y and grid_z. Statistic can be RMS_STD
+// or RMS_MAD (both about 0), and the flux range is defined as in
+// stddev(). The results are written to rms, an array of size n_gz ×
+// n_gy × n_gx, and are NaN for windows with NaN values only. Returns
+// the number of windows that contain valid values, none of which
+// fall into the requested flux range.
+// -------------------------------------------------------------------
+
+size_t local_noise(const data_t *data, double *rms, const size_t nx, const size_t ny, const size_t nz, const int64_t *grid_x, const size_t n_gx, const int64_t *grid_y, const size_t n_gy, const int64_t *grid_z, const size_t n_gz, const size_t radius_xy, const size_t radius_z, const int statistic, const int flux_range)
+{
+	const size_t size_xy = 2 * radius_xy + 1;
+	const size_t size_z = 2 * radius_z + 1;
+	const size_t max_window = (size_xy < nx ? size_xy : nx) * (size_xy < ny ? size_xy : ny) * (size_z < nz ? size_z : nz);
+	size_t n_empty = 0;
+	
+	#pragma omp parallel reduction(+:n_empty)
+	{
+		noise_hist_t hist;
+		double *col_sum = NULL;
+		size_t *col_range = NULL;
+		size_t *col_valid = NULL;
+		data_t *buffer = NULL;
+		
+		if(statistic == RMS_MAD)
+		{
+			hist.bins = (size_t *)calloc(NOISE_BINS, sizeof(size_t));
+			buffer = (data_t *)malloc(max_window * sizeof(data_t));
+			if(hist.bins == NULL || buffer == NULL)
+			{
+				fprintf(stderr, "ERROR: Failed to allocate memory for local noise measurement.\n");
+				exit(1);
+			}
+			memset(hist.blocks, 0, sizeof(hist.blocks));
+			hist.n_range = 0;
+			hist.n_valid = 0;
+		}
+		else
+		{
+			col_sum = (double *)malloc(nx * sizeof(double));
+			col_range = (size_t *)malloc(nx * sizeof(size_t));
+			col_valid = (size_t *)malloc(nx * sizeof(size_t));
+			if(col_sum == NULL || col_range == NULL || col_valid == NULL)
+			{
+				fprintf(stderr, "ERROR: Failed to allocate memory for local noise measurement.\n");
+				exit(1);
+			}
+		}
+		
+		#pragma omp for schedule(dynamic)
+		for(size_t tile = 0; tile < n_gz * n_gy; ++tile)
+		{
+			const size_t gz = (size_t)grid_z[tile / n_gy];
+			const size_t gy = (size_t)grid_y[tile % n_gy];
+			const size_t z_min = gz > radius_z ? gz - radius_z : 0;
+			const size_t z_max = gz + radius_z + 1 < nz ? gz + radius_z + 1 : nz;
+			const size_t y_min = gy > radius_xy ? gy - radius_xy : 0;
+			const size_t y_max = gy + radius_xy + 1 < ny ? gy + radius_xy + 1 : ny;
+			double *result = rms + tile * n_gx;
+			
+			if(statistic == RMS_MAD)
+			{
+				// Slide window along the row of grid points
+				size_t lo = 0;
+				size_t hi = 0;
+				
+				for(size_t i = 0; i < n_gx; ++i)
+				{
+					const size_t gx = (size_t)grid_x[i];
+					const size_t x_min = gx > radius_xy ? gx - radius_xy : 0;
+					const size_t x_max = gx + radius_xy + 1 < nx ? gx + radius_xy + 1 : nx;
+					
+					if(x_min >= hi || x_max <= lo)
+					{
+						hist_update(&hist, data, nx, ny, z_min, z_max, y_min, y_max, lo, hi, flux_range, SIZE_MAX);
+						hist_update(&hist, data, nx, ny, z_min, z_max, y_min, y_max, x_min, x_max, flux_range, 1);
+					}
+					else
+					{
+						if(x_min > lo) hist_update(&hist, data, nx, ny, z_min, z_max, y_min, y_max, lo, x_min, flux_range, SIZE_MAX);
+						else if(x_min < lo) hist_update(&hist, data, nx, ny, z_min, z_max, y_min, y_max, x_min, lo, flux_range, 1);
+						if(x_max < hi) hist_update(&hist, data, nx, ny, z_min, z_max, y_min, y_max, x_max, hi, flux_range, SIZE_MAX);
+						else if(x_max > hi) hist_update(&hist, data, nx, ny, z_min, z_max, y_min, y_max, hi, x_max, flux_range, 1);
+					}
+					lo = x_min;
+					hi = x_max;
+					
+					result[i] = window_mad(&hist, data, nx, ny, z_min, z_max, y_min, y_max, x_min, x_max, flux_range, buffer);
+					if(hist.n_valid && !hist.n_range) ++n_empty;
+				}
+				
+				// Empty histogram again for next tile
+				hist_update(&hist, data, nx, ny, z_min, z_max, y_min, y_max, lo, hi, flux_range, SIZE_MAX);
+			}
+			else
+			{
+				// Sum of squares of each column of the tile
+				for(size_t x = 0; x < nx; ++x)
+				{
+					col_sum[x] = 0.0;
+					col_range[x] = 0;
+					col_valid[x] = 0;
+				}
+				
+				for(size_t z = z_min; z < z_max; ++z)
+				{
+					for(size_t y = y_min; y < y_max; ++y)
+					{
+						const data_t *row = data + (z * ny + y) * nx;
+						
+						for(size_t x = 0; x < nx; ++x)
+						{
+							if(is_nan(row[x])) continue;
+							++col_valid[x];
+							
+							if(in_flux_range(row[x], flux_range))
+							{
+								const data_t square = row[x] * row[x];
+								col_sum[x] += square;
+								++col_range[x];
+							}
+						}
+					}
+				}
+				
+				// Combine columns of each window
+				for(size_t i = 0; i < n_gx; ++i)
+				{
+					const size_t gx = (size_t)grid_x[i];
+					const size_t x_min = gx > radius_xy ? gx - radius_xy : 0;
+					const size_t x_max = gx + radius_xy + 1 < nx ? gx + radius_xy + 1 : nx;
+					double sum = 0.0;
+					size_t n_range = 0;
+					size_t n_valid = 0;
+					
+					for(size_t x = x_min; x < x_max; ++x)
+					{
+						sum += col_sum[x];
+						n_range += col_range[x];
+						n_valid += col_valid[x];
+					}
+					
+					result[i] = n_range ? sqrt(sum / n_range) : NAN;
+					if(n_valid && !n_range) ++n_empty;
+				}
+			}
+		}
+		
+		if(statistic == RMS_MAD) free(hist.bins);
+		free(buffer);
+		free(col_sum);
+		free(col_range);
+		free(col_valid);
+	}
+	
+	return n_empty;
+}
+
+
+
+// ------------------------------------------------------------------
+// Linear interpolation along one axis of a 2-D slice of width col-
+// umns, with element i of column x located at base[i * stride + x].
+// The values at the knots are taken from the slice itself, ignoring
+// NaN; columns without any valid knots are left untouched. Outside
+// of the range of valid knots the nearest knot value is used. The
+// arithmetic is the same as that of numpy.interp(). The arrays
+// values, valid, index (size n_knots × width) and count (size width)
+// are used as workspace.
+// ------------------------------------------------------------------
+
+static void interpolate_axis(data_t *base, const size_t stride, const size_t n, const int64_t *knots, const size_t n_knots, const size_t width, data_t *values, size_t *valid, size_t *count, size_t *index)
+{
+	// Collect valid knots of each column
+	for(size_t x = 0; x < width; ++x)
+	{
+		count[x] = 0;
+		index[x] = 0;
+	}
+	
+	for(size_t k = 0; k < n_knots; ++k)
+	{
+		const data_t *src = base + (size_t)knots[k] * stride;
+		
+		for(size_t x = 0; x < width; ++x)
+		{
+			if(is_nan(src[x])) continue;
+			values[x * n_knots + count[x]] = src[x];
+			valid[x * n_knots + count[x]] = (size_t)knots[k];
+			++count[x];
+		}
+	}
+	
+	// Interpolate in between knots
+	for(size_t i = 0; i < n; ++i)
+	{
+		data_t *dst = base + i * stride;
+		
+		for(size_t x = 0; x < width; ++x)
+		{
+			const size_t m = count[x];
+			if(m == 0) continue;
+			
+			const data_t *val = values + x * n_knots;
+			const size_t *pos = valid + x * n_knots;
+			size_t j = index[x];
+			
+			while(j + 1 < m && pos[j + 1] <= i) ++j;
+			index[x] = j;
+			
+			if(i <= pos[0]) dst[x] = val[0];
+			else if(i >= pos[m - 1]) dst[x] = val[m - 1];
+			else if(i == pos[j]) dst[x] = val[j];
+			else
+			{
+				const double slope = ((double)val[j + 1] - (double)val[j]) / ((double)pos[j + 1] - (double)pos[j]);
+				dst[x] = slope * ((double)i - (double)pos[j]) + (double)val[j];
+			}
+		}
+	}
+	
+	return;
+}
+
+
+
+// -------------------------------------------------------------------
+// Divide data cube of size nz × ny × nx by the noise measured on the
+// grid (as returned by local_noise()) without creating a full-size
+// noise cube. If interpolate is false, each grid cell of size (2 *
+// radius_xy + 1) spatially and (2 * radius_z + 1) spectrally around a
+// grid point is divided by its value. Otherwise, the noise is linear-
+// ly interpolated in between grid points along x, y and z in this
+// order; only the planes of spectral grid points are stored in full,
+// while the interpolation along z and the division are carried out on
+// tiles of NOISE_CHUNK columns. Noise values that are NaN (including
+// parts not covered by any valid value) or not positive turn the data
+// into NaN. If noise is not NULL, the noise values are written to it;
+// if data is NULL, only the noise cube is created.
+// -------------------------------------------------------------------
+
+void local_noise_apply(data_t *data, data_t *noise, const double *rms, const size_t nx, const size_t ny, const size_t nz, const int64_t *grid_x, const size_t n_gx, const int64_t *grid_y, const size_t n_gy, const int64_t *grid_z, const size_t n_gz, const size_t radius_xy, const size_t radius_z, const int interpolate)
+{
+	const size_t plane = nx * ny;
+	
+	if(!interpolate)
+	{
+		#pragma omp parallel for schedule(dynamic)
+		for(size_t tile = 0; tile < n_gz * n_gy; ++tile)
+		{
+			const size_t gz = (size_t)grid_z[tile / n_gy];
+			const size_t gy = (size_t)grid_y[tile % n_gy];
+			const size_t z_min = gz > radius_z ? gz - radius_z : 0;
+			const size_t z_max = gz + radius_z + 1 < nz ? gz + radius_z + 1 : nz;
+			const size_t y_min = gy > radius_xy ? gy - radius_xy : 0;
+			const size_t y_max = gy + radius_xy + 1 < ny ? gy + radius_xy + 1 : ny;
+			const double *result = rms + tile * n_gx;
+			
+			for(size_t i = 0; i < n_gx; ++i)
+			{
+				const size_t gx = (size_t)grid_x[i];
+				const size_t x_min = gx > radius_xy ? gx - radius_xy : 0;
+				const size_t x_max = gx + radius_xy + 1 < nx ? gx + radius_xy + 1 : nx;
+				const data_t value = result[i] > 0.0 ? (data_t)result[i] : NAN;
+				
+				for(size_t z = z_min; z < z_max; ++z)
+				{
+					for(size_t y = y_min; y < y_max; ++y)
+					{
+						const size_t offset = z * plane + y * nx;
+						if(data != NULL) for(size_t x = x_min; x < x_max; ++x) data[offset + x] /= value;
+						if(noise != NULL) for(size_t x = x_min; x < x_max; ++x) noise[offset + x] = value;
+					}
+				}
+			}
+		}
+		
+		return;
+	}
+	
+	// Planes of spectral grid points, initially NaN except at grid points
+	data_t *planes = (data_t *)malloc(n_gz * plane * sizeof(data_t));
+	
+	if(planes == NULL)
+	{
+		fprintf(stderr, "ERROR: Failed to allocate memory for noise interpolation.\n");
+		exit(1);
+	}
+	
+	#pragma omp parallel for schedule(static)
+	for(size_t i = 0; i < n_gz * plane; ++i) planes[i] = NAN;
+	
+	for(size_t tile = 0; tile < n_gz * n_gy; ++tile)
+	{
+		data_t *row = planes + (tile / n_gy) * plane + (size_t)grid_y[tile % n_gy] * nx;
+		for(size_t i = 0; i < n_gx; ++i) row[grid_x[i]] = rms[tile * n_gx + i];
+	}
+	
+	const size_t n_knots = n_gx > n_gy ? (n_gx > n_gz ? n_gx : n_gz) : (n_gy > n_gz ? n_gy : n_gz);
+	const size_t n_chunks = (nx + NOISE_CHUNK - 1) / NOISE_CHUNK;
+	
+	#pragma omp parallel
+	{
+		data_t *values = (data_t *)malloc(n_knots * NOISE_CHUNK * sizeof(data_t));
+		size_t *valid = (size_t *)malloc(n_knots * NOISE_CHUNK * sizeof(size_t));
+		size_t *count = (size_t *)malloc(NOISE_CHUNK * sizeof(size_t));
+		size_t *index = (size_t *)malloc(NOISE_CHUNK * sizeof(size_t));
+		data_t *column = (data_t *)malloc(nz * NOISE_CHUNK * sizeof(data_t));
+		
+		if(values == NULL || valid == NULL || count == NULL || index == NULL || column == NULL)
+		{
+			fprintf(stderr, "ERROR: Failed to allocate memory for noise interpolation.\n");
+			exit(1);
+		}
+		
+		// Along x for each row of grid points
+		if(n_gx < nx)
+		{
+			#pragma omp for schedule(static)
+			for(size_t tile = 0; tile < n_gz * n_gy; ++tile)
+			{
+				data_t *row = planes + (tile / n_gy) * plane + (size_t)grid_y[tile % n_gy] * nx;
+				interpolate_axis(row, 1, nx, grid_x, n_gx, 1, values, valid, count, index);
+			}
+		}
+		
+		// Along y for each plane of grid points
+		if(n_gy < ny)
+		{
+			#pragma omp for schedule(static)
+			for(size_t tile = 0; tile < n_gz * n_chunks; ++tile)
+			{
+				const size_t x = (tile % n_chunks) * NOISE_CHUNK;
+				const size_t width = nx - x < NOISE_CHUNK ? nx - x : NOISE_CHUNK;
+				interpolate_axis(planes + (tile / n_chunks) * plane + x, nx, ny, grid_y, n_gy, width, values, valid, count, index);
+			}
+		}
+		
+		// Along z for tiles of columns, followed by division
+		#pragma omp for schedule(static)
+		for(size_t tile = 0; tile < ny * n_chunks; ++tile)
+		{
+			const size_t y = tile / n_chunks;
+			const size_t x = (tile % n_chunks) * NOISE_CHUNK;
+			const size_t width = nx - x < NOISE_CHUNK ? nx - x : NOISE_CHUNK;
+			
+			for(size_t i = 0; i < nz * width; ++i) column[i] = NAN;
+			for(size_t k = 0; k < n_gz; ++k) memcpy(column + (size_t)grid_z[k] * width, planes + k * plane + y * nx + x, width * sizeof(data_t));
+			if(n_gz < nz) interpolate_axis(column, width, nz, grid_z, n_gz, width, values, valid, count, index);
+			
+			for(size_t z = 0; z < nz; ++z)
+			{
+				const size_t offset = z * plane + y * nx + x;
+				
+				for(size_t i = 0; i < width; ++i)
+				{
+					const data_t value = column[z * width + i] > 0.0 ? column[z * width + i] : NAN;
+					if(data != NULL) data[offset + i] /= value;
+					if(noise != NULL) noise[offset + i] = value;
+				}
+			}
+		}
+		
+		free(values);
+		free(valid);
+		free(count);
+		free(index);
+		free(column);
+	}
+	
+	free(planes);
+	
+	return;
+}
@@ -0,0 +1,698 @@
+// ===================================================================
+// This module provides functions for measuring the basic properties
+// of all labelled regions (sources) in an integer mask of size nz ×
+// ny × nx in a single sweep across the mask, and for dilating and
+// flagging the masks of individual sources. Labels are mapped onto a dense table
+// of n_labels entries starting at label_min; a value of 0 denotes
+// background. Each thread accumulates the properties of the lines of
+// sight it processes in its own table, and the partial tables are
+// merged at the end.
+// ===================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "statistics.h"
+
+// Properties of a single region
+typedef struct
+{
+	int64_t x_min, x_max, y_min, y_max, z_min, z_max;
+	double sum_x, sum_y, sum_z;
+	uint64_t n_pix, n_los;
+	size_t last_los;
+} region_t;
+
+
+
+// --------------------------------------------------
+// Range of non-zero labels in mask; returns number of
+// non-zero pixels and sets min and max accordingly.
+// --------------------------------------------------
+
+size_t label_range(const int32_t *mask, const size_t size, int32_t *label_min, int32_t *label_max)
+{
+	int32_t lo = INT32_MAX;
+	int32_t hi = INT32_MIN;
+	size_t counter = 0;
+	
+	#pragma omp parallel for schedule(static) reduction(min:lo) reduction(max:hi) reduction(+:counter)
+	for(size_t i = 0; i < size; ++i)
+	{
+		const int32_t label = mask[i];
+		if(label)
+		{
+			if(label < lo) lo = label;
+			if(label > hi) hi = label;
+			++counter;
+		}
+	}
+	
+	*label_min = lo;
+	*label_max = hi;
+	return counter;
+}
+
+
+
+// ------------------------------------------------------------------
+// Measure bounding box (inclusive), geometric centroid, number of
+// pixels and number of lines of sight of all regions with labels in
+// the range [label_min, label_min + n_labels). Results are written
+// into the arrays bbox (6 values per region in the order x_min,
+// x_max, y_min, y_max, z_min, z_max), centroid (x, y, z per region),
+// n_pix and n_los, each of which must hold n_labels entries. The
+// mask is swept one line of sight at a time, so that each line of
+// sight is counted only once for each region it intersects.
+// ------------------------------------------------------------------
+
+void region_props(const int32_t *mask, const size_t nx, const size_t ny, const size_t nz, const int32_t label_min, const size_t n_labels, int64_t *bbox, double *centroid, uint64_t *n_pix, uint64_t *n_los)
+{
+	const size_t plane = nx * ny;
+	int n_threads = 1;
+	
+	// Limit number of threads such that the partial tables
+	// do not require more memory than the mask itself
+	#ifdef _OPENMP
+	const size_t max_tables = (plane * nz * sizeof(int32_t)) / (n_labels * sizeof(region_t) + 1);
+	n_threads = omp_get_max_threads();
+	if((size_t)n_threads > max_tables) n_threads = max_tables > 1 ? (int)max_tables : 1;
+	#endif
+	
+	// Initialise output
+	for(size_t i = 0; i < n_labels; ++i)
+	{
+		bbox[6 * i]     = bbox[6 * i + 2] = bbox[6 * i + 4] = INT64_MAX;
+		bbox[6 * i + 1] = bbox[6 * i + 3] = bbox[6 * i + 5] = -1;
+		centroid[3 * i] = centroid[3 * i + 1] = centroid[3 * i + 2] = 0.0;
+		n_pix[i] = n_los[i] = 0;
+	}
+	
+	#pragma omp parallel num_threads(n_threads)
+	{
+		region_t *table = (region_t *)malloc(n_labels * sizeof(region_t));
+		
+		if(table == NULL)
+		{
+			fprintf(stderr, "ERROR: Failed to allocate memory for region properties.\n");
+			exit(1);
+		}
+		
+		for(size_t i = 0; i < n_labels; ++i)
+		{
+			table[i].x_min = table[i].y_min = table[i].z_min = INT64_MAX;
+			table[i].x_max = table[i].y_max = table[i].z_max = -1;
+			table[i].sum_x = table[i].sum_y = table[i].sum_z = 0.0;
+			table[i].n_pix = table[i].n_los = 0;
+			table[i].last_los = SIZE_MAX;
+		}
+		
+		#pragma omp for schedule(dynamic)
+		for(size_t y = 0; y < ny; ++y)
+		{
+			for(size_t x = 0; x < nx; ++x)
+			{
+				const size_t los = y * nx + x;
+				const int32_t *ptr = mask + los;
+				
+				for(size_t z = 0; z < nz; ++z, ptr += plane)
+				{
+					if(*ptr == 0) continue;
+					
+					region_t *r = table + (size_t)((int64_t)*ptr - label_min);
+					
+					if((int64_t)x < r->x_min) r->x_min = x;
+					if((int64_t)x > r->x_max) r->x_max = x;
+					if((int64_t)y < r->y_min) r->y_min = y;
+					if((int64_t)y > r->y_max) r->y_max = y;
+					if((int64_t)z < r->z_min) r->z_min = z;
+					if((int64_t)z > r->z_max) r->z_max = z;
+					r->sum_x += x;
+					r->sum_y += y;
+					r->sum_z += z;
+					++r->n_pix;
+					
+					if(r->last_los != los)
+					{
+						r->last_los = los;
+						++r->n_los;
+					}
+				}
+			}
+		}
+		
+		// Merge partial tables
+		#pragma omp critical
+		for(size_t i = 0; i < n_labels; ++i)
+		{
+			const region_t *r = table + i;
+			if(r->n_pix == 0) continue;
+			
+			int64_t *b = bbox + 6 * i;
+			if(r->x_min < b[0]) b[0] = r->x_min;
+			if(r->x_max > b[1]) b[1] = r->x_max;
+			if(r->y_min < b[2]) b[2] = r->y_min;
+			if(r->y_max > b[3]) b[3] = r->y_max;
+			if(r->z_min < b[4]) b[4] = r->z_min;
+			if(r->z_max > b[5]) b[5] = r->z_max;
+			centroid[3 * i]     += r->sum_x;
+			centroid[3 * i + 1] += r->sum_y;
+			centroid[3 * i + 2] += r->sum_z;
+			n_pix[i] += r->n_pix;
+			n_los[i] += r->n_los;
+		}
+		
+		free(table);
+	}
+	
+	// Convert coordinate sums into centroids
+	for(size_t i = 0; i < n_labels; ++i)
+	{
+		if(n_pix[i] == 0) continue;
+		centroid[3 * i]     /= (double)n_pix[i];
+		centroid[3 * i + 1] /= (double)n_pix[i];
+		centroid[3 * i + 2] /= (double)n_pix[i];
+	}
+	
+	return;
+}
+
+
+
+// ---------------------------------------------------------
+// Workspace and disc offsets used by the dilation functions
+// ---------------------------------------------------------
+
+typedef struct
+{
+	uint16_t *dist;
+	uint32_t *dist2;
+	double *flux;
+	size_t size_dist, size_dist2;
+} dilate_work_t;
+
+typedef struct
+{
+	long dx, dy;
+	uint32_t d2;
+} disc_offset_t;
+
+typedef struct
+{
+	int64_t label;
+	size_t index;
+} label_index_t;
+
+static int compare_labels(const void *a, const void *b)
+{
+	const int64_t la = ((const label_index_t *)a)->label;
+	const int64_t lb = ((const label_index_t *)b)->label;
+	return (la > lb) - (la < lb);
+}
+
+static int compare_offsets(const void *a, const void *b)
+{
+	const uint32_t d2a = ((const disc_offset_t *)a)->d2;
+	const uint32_t d2b = ((const disc_offset_t *)b)->d2;
+	return (d2a > d2b) - (d2a < d2b);
+}
+
+
+
+// -----------------------------------------------------------------
+// Find the number of dilation steps after which the relative flux
+// increase, (flux_new - flux_old) / flux_new, first drops below the
+// threshold; flux[k] is the flux added in step k, and flux[0] is the
+// flux before dilation.
+// -----------------------------------------------------------------
+
+static size_t dilate_steps(const double *flux, const size_t n_max, const double threshold)
+{
+	double flux_old = flux[0];
+	
+	for(size_t k = 1; k <= n_max; ++k)
+	{
+		const double flux_new = flux_old + flux[k];
+		if((flux_new - flux_old) / flux_new < threshold) return k - 1;
+		flux_old = flux_new;
+	}
+	
+	return n_max;
+}
+
+
+
+// -------------------------------------------------------------------
+// Dilate the mask of a single source with the given label within the
+// box (x_min, x_max, y_min, y_max, z_min, z_max), first along the
+// spectral axis by up to n_chan channels and then in the spatial
+// plane by a disc of up to n_pix pixels radius. Each growth step only
+// visits the shell of voxels newly covered. Rather than applying a
+// series of dilation kernels, the distance of each voxel from the
+// source is measured once, such that the flux added in each step is
+// known after a single pass across the box. The flux of other sources
+// is ignored in the flux measurement.
+//
+// If apply is zero, the number of steps at which the flux converges
+// is determined and written back to n_chan and n_pix, and overlap is
+// set if the box contains any other sources. Otherwise the mask is
+// dilated by exactly n_chan and n_pix steps; voxels belonging to
+// other sources are never modified.
+// -------------------------------------------------------------------
+
+static void dilate_source(const data_t *data, int64_t *mask, const size_t nx, const size_t ny, const int64_t label, const size_t *box, size_t *n_chan, size_t *n_pix, const double threshold, const int apply, unsigned char *overlap, const disc_offset_t *offsets, const size_t *n_offsets, const uint32_t *radius, dilate_work_t *work)
+{
+	const size_t bx = box[1] - box[0] + 1;
+	const size_t by = box[3] - box[2] + 1;
+	const size_t bz = box[5] - box[4] + 1;
+	const size_t plane = nx * ny;
+	const uint16_t far = (uint16_t)(*n_chan + 1);
+	const uint32_t far2 = (uint32_t)(*n_pix * *n_pix + 1);
+	
+	// Make sure workspace is large enough
+	if(work->size_dist < bx * by * bz)
+	{
+		free(work->dist);
+		work->size_dist = bx * by * bz;
+		work->dist = (uint16_t *)malloc(work->size_dist * sizeof(uint16_t));
+	}
+	if(work->size_dist2 < bx * by)
+	{
+		free(work->dist2);
+		work->size_dist2 = bx * by;
+		work->dist2 = (uint32_t *)malloc(work->size_dist2 * sizeof(uint32_t));
+	}
+	if(work->dist == NULL || work->dist2 == NULL)
+	{
+		fprintf(stderr, "ERROR: Failed to allocate memory for mask dilation.\n");
+		exit(1);
+	}
+	
+	uint16_t *dist = work->dist;
+	uint32_t *dist2 = work->dist2;
+	double *flux = work->flux;
+	
+	// Spectral distance from source along each line of sight
+	for(size_t y = 0; y < by; ++y)
+	{
+		for(size_t x = 0; x < bx; ++x)
+		{
+			const int64_t *ptr = mask + (box[4] * ny + box[2] + y) * nx + box[0] + x;
+			uint16_t *d = dist + y * bx + x;
+			uint16_t current = far;
+			
+			for(size_t z = 0; z < bz; ++z)
+			{
+				if(ptr[z * plane] == label) current = 0;
+				else if(current < far) ++current;
+				d[z * bx * by] = current;
+			}
+			
+			current = far;
+			for(size_t z = bz; z--;)
+			{
+				if(d[z * bx * by] == 0) current = 0;
+				else
+				{
+					if(current < far) ++current;
+					if(current < d[z * bx * by]) d[z * bx * by] = current;
+				}
+			}
+		}
+	}
+	
+	// Flux added in each spectral dilation step
+	if(!apply)
+	{
+		for(size_t k = 0; k <= *n_chan; ++k) flux[k] = 0.0;
+		
+		for(size_t z = 0; z < bz; ++z)
+		{
+			for(size_t y = 0; y < by; ++y)
+			{
+				const size_t offset = ((box[4] + z) * ny + box[2] + y) * nx + box[0];
+				const uint16_t *d = dist + (z * by + y) * bx;
+				
+				for(size_t x = 0; x < bx; ++x)
+				{
+					const int64_t value = mask[offset + x];
+					if(value && value != label) *overlap = 1;
+					else if(d[x] < far) flux[d[x]] += data[offset + x];
+				}
+			}
+		}
+		
+		*n_chan = dilate_steps(flux, *n_chan, threshold);
+	}
+	
+	// Spatial dilation, one channel at a time, of the spectrally
+	// dilated source; the squared distance of each pixel from the
+	// source is obtained by stamping a disc onto all pixels at the
+	// edge of the source, as the closest source pixel of any outside
+	// pixel must lie on the edge.
+	const uint16_t seed = (uint16_t)*n_chan;
+	const size_t n_off = n_offsets[*n_pix];
+	
+	if(!apply) for(size_t k = 0; k <= *n_pix; ++k) flux[k] = 0.0;
+	
+	for(size_t z = 0; z < bz; ++z)
+	{
+		const uint16_t *d = dist + z * bx * by;
+		
+		for(size_t i = 0; i < bx * by; ++i) dist2[i] = d[i] <= seed ? 0 : far2;
+		
+		for(size_t y = 0; y < by; ++y)
+		{
+			for(size_t x = 0; x < bx; ++x)
+			{
+				if(dist2[y * bx + x]) continue;
+				
+				// Skip pixels inside the source
+				if(x > 0 && x < bx - 1 && y > 0 && y < by - 1 && !dist2[y * bx + x - 1] && !dist2[y * bx + x + 1] && !dist2[(y - 1) * bx + x] && !dist2[(y + 1) * bx + x]) continue;
+				
+				for(size_t i = 0; i < n_off; ++i)
+				{
+					const long xx = (long)x + offsets[i].dx;
+					const long yy = (long)y + offsets[i].dy;
+					if(xx < 0 || yy < 0 || xx >= (long)bx || yy >= (long)by) continue;
+					uint32_t *d2 = dist2 + yy * bx + xx;
+					if(*d2 > offsets[i].d2) *d2 = offsets[i].d2;
+				}
+			}
+		}
+		
+		for(size_t y = 0; y < by; ++y)
+		{
+			const size_t offset = ((box[4] + z) * ny + box[2] + y) * nx + box[0];
+			
+			for(size_t x = 0; x < bx; ++x)
+			{
+				const uint32_t d2 = dist2[y * bx + x];
+				if(d2 >= far2) continue;
+				
+				int64_t *ptr = mask + offset + x;
+				
+				if(apply)
+				{
+					if(*ptr == 0) *ptr = label;
+				}
+				else if(*ptr == 0 || *ptr == label) flux[radius[d2]] += data[offset + x];
+			}
+		}
+	}
+	
+	if(!apply) *n_pix = dilate_steps(flux, *n_pix, threshold);
+	
+	return;
+}
+
+
+
+// -------------------------------------------------------------------
+// Dilate the masks of n_src sources with non-zero labels ids, given
+// their bounding boxes (6 values per source as in region_props), by
+// up to chan_max channels and then up to pix_max pixels until the
+// relative flux increase drops below threshold. The result is the
+// same as when dilating one source after the other in order of in-
+// creasing label, but sources not affecting each other are processed
+// in parallel. The number of channels and pixels by which
+// each source was dilated is written to dil (2 values per source).
+// For the dilated sources, centroid, n_pix, n_chan and n_los receive
+// the geometric centroid and the numbers of pixels, channels and
+// lines of sight, and overlap is set if the search box of a source
+// contained other sources prior to dilation.
+// -------------------------------------------------------------------
+
+void dilate_sources(const data_t *data, int64_t *mask, const size_t nx, const size_t ny, const size_t nz, const size_t n_src, const int64_t *ids, const int64_t *bbox, const size_t chan_max, const size_t pix_max, const double threshold, uint64_t *dil, double *centroid, uint64_t *n_pix, uint64_t *n_chan, uint64_t *n_los, unsigned char *overlap)
+{
+	if(chan_max >= UINT16_MAX)
+	{
+		fprintf(stderr, "ERROR: Spectral dilation limit out of range.\n");
+		exit(1);
+	}
+	
+	// Disc offsets sorted by distance, with number of
+	// offsets and integer radius for each distance
+	const size_t n_disc = (2 * pix_max + 1) * (2 * pix_max + 1);
+	disc_offset_t *offsets = (disc_offset_t *)malloc(n_disc * sizeof(disc_offset_t));
+	size_t *n_offsets = (size_t *)malloc((pix_max + 1) * sizeof(size_t));
+	uint32_t *radius = (uint32_t *)malloc((pix_max * pix_max + 1) * sizeof(uint32_t));
+	size_t *boxes = (size_t *)malloc(6 * n_src * sizeof(size_t));
+	
+	if(offsets == NULL || n_offsets == NULL || radius == NULL || boxes == NULL)
+	{
+		fprintf(stderr, "ERROR: Failed to allocate memory for mask dilation.\n");
+		exit(1);
+	}
+	
+	size_t counter = 0;
+	for(long dy = -(long)pix_max; dy <= (long)pix_max; ++dy)
+	{
+		for(long dx = -(long)pix_max; dx <= (long)pix_max; ++dx)
+		{
+			const uint32_t d2 = (uint32_t)(dx * dx + dy * dy);
+			if(d2 == 0 || d2 > pix_max * pix_max) continue;
+			offsets[counter].dx = dx;
+			offsets[counter].dy = dy;
+			offsets[counter].d2 = d2;
+			++counter;
+		}
+	}
+	qsort(offsets, counter, sizeof(disc_offset_t), compare_offsets);
+	
+	for(size_t k = 0; k <= pix_max; ++k)
+	{
+		n_offsets[k] = 0;
+		while(n_offsets[k] < counter && offsets[n_offsets[k]].d2 <= k * k) ++n_offsets[k];
+	}
+	
+	for(uint32_t d2 = 0, k = 0; d2 <= pix_max * pix_max; ++d2)
+	{
+		while(k * k < d2) ++k;
+		radius[d2] = k;
+	}
+	
+	// Search boxes, clipped to the data cube
+	for(size_t i = 0; i < n_src; ++i)
+	{
+		const int64_t *b = bbox + 6 * i;
+		size_t *box = boxes + 6 * i;
+		box[0] = b[0] > (int64_t)pix_max ? b[0] - pix_max : 0;
+		box[1] = b[1] + pix_max < nx ? b[1] + pix_max : nx - 1;
+		box[2] = b[2] > (int64_t)pix_max ? b[2] - pix_max : 0;
+		box[3] = b[3] + pix_max < ny ? b[3] + pix_max : ny - 1;
+		box[4] = b[4] > (int64_t)chan_max ? b[4] - chan_max : 0;
+		box[5] = b[5] + chan_max < nz ? b[5] + chan_max : nz - 1;
+	}
+	
+	// The result of dilating a source depends on all sources with lower
+	// labels whose search boxes overlap its own, as those were dilated
+	// before. Sources are therefore assigned to consecutive levels in
+	// order of increasing label, such that the boxes of all sources on
+	// the same level are disjoint and can be processed in parallel.
+	label_index_t *sorted = (label_index_t *)malloc(n_src * sizeof(label_index_t));
+	size_t *order = (size_t *)malloc(n_src * sizeof(size_t));
+	size_t *level = (size_t *)malloc(n_src * sizeof(size_t));
+	size_t *level_map = (size_t *)calloc(nx * ny, sizeof(size_t));
+	
+	if(sorted == NULL || order == NULL || level == NULL || level_map == NULL)
+	{
+		fprintf(stderr, "ERROR: Failed to allocate memory for mask dilation.\n");
+		exit(1);
+	}
+	
+	for(size_t i = 0; i < n_src; ++i)
+	{
+		sorted[i].label = ids[i];
+		sorted[i].index = i;
+	}
+	qsort(sorted, n_src, sizeof(label_index_t), compare_labels);
+	
+	size_t n_levels = 0;
+	for(size_t j = 0; j < n_src; ++j)
+	{
+		const size_t i = sorted[j].index;
+		const size_t *box = boxes + 6 * i;
+		size_t current = 0;
+		
+		for(size_t y = box[2]; y <= box[3]; ++y)
+			for(size_t x = box[0]; x <= box[1]; ++x)
+				if(level_map[y * nx + x] > current) current = level_map[y * nx + x];
+		
+		level[i] = ++current;
+		if(current > n_levels) n_levels = current;
+		
+		for(size_t y = box[2]; y <= box[3]; ++y)
+			for(size_t x = box[0]; x <= box[1]; ++x)
+				level_map[y * nx + x] = current;
+	}
+	
+	free(level_map);
+	free(sorted);
+	
+	// Sort sources by level
+	size_t *first = (size_t *)calloc(n_levels + 2, sizeof(size_t));
+	if(first == NULL)
+	{
+		fprintf(stderr, "ERROR: Failed to allocate memory for mask dilation.\n");
+		exit(1);
+	}
+	for(size_t i = 0; i < n_src; ++i) ++first[level[i] + 1];
+	for(size_t l = 1; l <= n_levels + 1; ++l) first[l] += first[l - 1];
+	for(size_t i = 0; i < n_src; ++i) order[first[level[i]]++] = i;
+	for(size_t l = n_levels + 1; l > 0; --l) first[l] = first[l - 1];
+	first[0] = 0;
+	
+	#pragma omp parallel
+	{
+		dilate_work_t work = {NULL, NULL, NULL, 0, 0};
+		work.flux = (double *)malloc(((chan_max > pix_max ? chan_max : pix_max) + 1) * sizeof(double));
+		
+		if(work.flux == NULL)
+		{
+			fprintf(stderr, "ERROR: Failed to allocate memory for mask dilation.\n");
+			exit(1);
+		}
+		
+		for(size_t l = 1; l <= n_levels; ++l)
+		{
+			#pragma omp for schedule(dynamic)
+			for(size_t j = first[l]; j < first[l + 1]; ++j)
+			{
+				const size_t i = order[j];
+				size_t dil_chan = chan_max;
+				size_t dil_pix  = pix_max;
+				
+				overlap[i] = 0;
+				
+				// Determine dilation, then apply it
+				dilate_source(data, mask, nx, ny, ids[i], boxes + 6 * i, &dil_chan, &dil_pix, threshold, 0, overlap + i, offsets, n_offsets, radius, &work);
+				dilate_source(data, mask, nx, ny, ids[i], boxes + 6 * i, &dil_chan, &dil_pix, threshold, 1, overlap + i, offsets, n_offsets, radius, &work);
+				
+				dil[2 * i] = dil_chan;
+				dil[2 * i + 1] = dil_pix;
+			}
+		}
+		
+		free(work.dist);
+		free(work.dist2);
+		free(work.flux);
+	}
+	
+	free(order);
+	free(level);
+	free(first);
+	
+	// Measure properties of dilated sources
+	#pragma omp parallel for schedule(dynamic)
+	for(size_t i = 0; i < n_src; ++i)
+	{
+		const size_t *box = boxes + 6 * i;
+		const int64_t label = ids[i];
+		size_t z_min = SIZE_MAX, z_max = 0;
+		double sum_x = 0.0, sum_y = 0.0, sum_z = 0.0;
+		uint64_t pixels = 0, los = 0;
+		
+		for(size_t y = box[2]; y <= box[3]; ++y)
+		{
+			for(size_t x = box[0]; x <= box[1]; ++x)
+			{
+				const int64_t *ptr = mask + y * nx + x;
+				uint64_t found = 0;
+				
+				for(size_t z = box[4]; z <= box[5]; ++z)
+				{
+					if(ptr[z * nx * ny] != label) continue;
+					sum_x += x;
+					sum_y += y;
+					sum_z += z;
+					if(z < z_min) z_min = z;
+					if(z > z_max) z_max = z;
+					++found;
+				}
+				
+				pixels += found;
+				if(found) ++los;
+			}
+		}
+		
+		centroid[3 * i]     = pixels ? sum_x / (double)pixels : NAN;
+		centroid[3 * i + 1] = pixels ? sum_y / (double)pixels : NAN;
+		centroid[3 * i + 2] = pixels ? sum_z / (double)pixels : NAN;
+		n_pix[i]  = pixels;
+		n_chan[i] = pixels ? z_max - z_min + 1 : 0;
+		n_los[i]  = los;
+	}
+	
+	free(offsets);
+	free(n_offsets);
+	free(radius);
+	free(boxes);
+	
+	return;
+}
+
+
+
+// -------------------------------------------------------------------
+// Flag sources (with labels ids and inclusive bounding boxes bbox of
+// 6 values per source) that touch the spatial (1) or spectral (2)
+// edge of the cube, or whose mask, grown by one pixel in all 26
+// directions within the bounding box, contains NaN values (4) or
+// pixels of other sources with positive labels (8).
+// -------------------------------------------------------------------
+
+void source_flags(const data_t *data, const int64_t *mask, const size_t nx, const size_t ny, const size_t nz, const size_t n_src, const int64_t *ids, const int64_t *bbox, unsigned char *flags)
+{
+	const size_t size_xy = nx * ny;
+	
+	#pragma omp parallel for schedule(dynamic)
+	for(size_t i = 0; i < n_src; ++i)
+	{
+		const int64_t *b = bbox + 6 * i;
+		const int64_t label = ids[i];
+		unsigned char flag = 0;
+		
+		if(b[0] == 0 || b[1] == (int64_t)nx || b[2] == 0 || b[3] == (int64_t)ny) flag |= 1;
+		if(b[4] == 0 || b[5] == (int64_t)nz) flag |= 2;
+		
+		// Bounding box clipped to the data cube
+		const long x_min = b[0] > 0 ? b[0] : 0;
+		const long y_min = b[2] > 0 ? b[2] : 0;
+		const long z_min = b[4] > 0 ? b[4] : 0;
+		const long x_max = b[1] < (int64_t)nx ? b[1] : (long)nx - 1;
+		const long y_max = b[3] < (int64_t)ny ? b[3] : (long)ny - 1;
+		const long z_max = b[5] < (int64_t)nz ? b[5] : (long)nz - 1;
+		
+		for(long z = z_min; z <= z_max && (flag & 12) != 12; ++z)
+		{
+			for(long y = y_min; y <= y_max && (flag & 12) != 12; ++y)
+			{
+				for(long x = x_min; x <= x_max && (flag & 12) != 12; ++x)
+				{
+					if(mask[z * size_xy + y * nx + x] != label) continue;
+					
+					// Check neighbourhood of source pixel
+					for(long zz = z > z_min ? z - 1 : z; zz <= z + 1 && zz <= z_max; ++zz)
+					{
+						for(long yy = y > y_min ? y - 1 : y; yy <= y + 1 && yy <= y_max; ++yy)
+						{
+							for(long xx = x > x_min ? x - 1 : x; xx <= x + 1 && xx <= x_max; ++xx)
+							{
+								const size_t index = zz * size_xy + yy * nx + xx;
+								const int64_t other = mask[index];
+								if(is_nan(data[index])) flag |= 4;
+								if(other > 0 && other != label) flag |= 8;
+							}
+						}
+					}
+				}
+			}
+		}
+		
+		flags[i] = flag;
+	}
+	
+	return;
+}
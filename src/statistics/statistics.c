@@ -2,34 +2,20 @@
 // This module provides time-critical and memory-critical statistical
 // functions implemented in plain C99. They can be called from within
 // Python using the ctypes module after compilation into a shared ob-
-// ject library named statistics.so.
+// ject library named _statistics.so.
 // ===================================================================
-// Compilation: gcc -std=c99 -O3 -fPIC -shared -o statistics.so statistics.c
+// Compilation: gcc -std=c99 -O3 -fPIC -fopenmp -shared -o _statistics.so *.c
 // ===================================================================
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <stdint.h>
 #include <math.h>
-#include <float.h>
 
-#define RMS_STD 0
-#define RMS_MAD 1
-#define RMS_GAUSS 2
+#include "statistics.h"
 
+// Number of spectra processed together by mad_spectra()
+#define SPECTRA_TILE 64
 
-#define loop_desc(I,N) for(size_t (I) = (N); (I)--;)
-
-// Conversion factor between MAD and STD, calculated as 1.0 / scipy.stats.norm.ppf(3.0 / 4.0)
-#define MAD_TO_STD 1.482602218505602
-
-
-// Define data type
-#define DATA_T_MAX FLT_MAX
-typedef float data_t;
-//#define DATA_T_MAX DBL_MAX
-//typedef double data_t;
 
 
 // General remarks:
@@ -45,43 +31,6 @@ typedef float data_t;
 
 
 
-// ---------------------
-// Function declarations
-// ---------------------
-
-// Check for NaN
-unsigned int contains_nan(const data_t *data, const size_t size);
-// Set mask based on threshold
-void set_mask(unsigned char *mask, const data_t *data, const size_t size, const data_t threshold);
-// Standard deviation
-double stddev(const data_t *data, const size_t size, const size_t cadence, const int flux_range, data_t value);
-// Median
-data_t median(data_t *data, const size_t size, const unsigned int approx);
-// Median absolute deviation
-data_t mad(data_t *data, const size_t size, data_t value);
-// Summation
-double sum(const data_t *data, const size_t size, const unsigned int mean);
-// Moment map generation
-double *moment(const data_t *data, const size_t nx, const size_t ny, const size_t nz, const unsigned int mom, const double *mom0, const double *mom1);
-// Uniform filter
-void uniform_filter_1d(data_t *data, const size_t nx, const size_t ny, const size_t nz, const size_t width, const unsigned int edge_mode);
-// Partial sorting of n-th element
-data_t nth_element(data_t *data, const size_t size, const size_t n);
-// Maximum and minimum
-data_t max(const data_t *data, const size_t size);
-data_t min(const data_t *data, const size_t size);
-// Memory release
-void free_memory(double *data);
-// Check native byte order of machine
-inline unsigned int native_byte_order(void);
-// Swap byte order
-inline void swap_byte_order_32(float *value);
-inline void swap_byte_order_64(double *value);
-// Check for NaN
-inline unsigned int is_nan(const data_t value);
-
-
-
 // --------------------------
 // Check for any NaN in array
 // --------------------------
@@ -220,6 +169,81 @@ data_t mad(data_t *data, const size_t size, data_t value)
 
 
 
+// ----------------------------------------------------------------
+// Robust noise of each spectrum of a data cube of size nz × ny × nx,
+// calculated as the MAD of the absolute values (i.e. assuming that
+// the median is zero) converted to standard deviation. If clip > 0,
+// a second pass is made using only values below clip times the re-
+// sult of the first pass. NaN values are ignored; the result will be
+// NaN if no valid values are left. The spectra are copied in tiles
+// of SPECTRA_TILE adjacent pixels along x to make memory access ef-
+// ficient, with different rows being processed in parallel.
+// ----------------------------------------------------------------
+
+void mad_spectra(const data_t *data, double *rms, const size_t nx, const size_t ny, const size_t nz, const double clip)
+{
+	const size_t plane = nx * ny;
+	
+	#pragma omp parallel
+	{
+		data_t *tile = (data_t*)malloc(SPECTRA_TILE * nz * sizeof(data_t));
+		size_t count[SPECTRA_TILE];
+		
+		if(tile == NULL)
+		{
+			fprintf(stderr, "ERROR: Failed to allocate memory for noise measurement.\n");
+			exit(1);
+		}
+		
+		#pragma omp for schedule(dynamic)
+		for(size_t y = 0; y < ny; ++y)
+		{
+			for(size_t x0 = 0; x0 < nx; x0 += SPECTRA_TILE)
+			{
+				const size_t n_tile = nx - x0 < SPECTRA_TILE ? nx - x0 : SPECTRA_TILE;
+				
+				// Copy absolute values of valid pixels
+				for(size_t i = 0; i < n_tile; ++i) count[i] = 0;
+				for(size_t z = 0; z < nz; ++z)
+				{
+					const data_t *src = data + z * plane + y * nx + x0;
+					for(size_t i = 0; i < n_tile; ++i)
+					{
+						if(!is_nan(src[i])) tile[i * nz + count[i]++] = fabs(src[i]);
+					}
+				}
+				
+				// Measure noise of each spectrum
+				for(size_t i = 0; i < n_tile; ++i)
+				{
+					data_t *spectrum = tile + i * nz;
+					size_t n = count[i];
+					double value = n ? MAD_TO_STD * median(spectrum, n, 0) : NAN;
+					
+					if(n && clip > 0.0)
+					{
+						const double limit = clip * value;
+						size_t m = 0;
+						for(size_t j = 0; j < n; ++j)
+						{
+							if(spectrum[j] < limit) spectrum[m++] = spectrum[j];
+						}
+						value = m ? MAD_TO_STD * median(spectrum, m, 0) : NAN;
+					}
+					
+					rms[y * nx + x0 + i] = value;
+				}
+			}
+		}
+		
+		free(tile);
+	}
+	
+	return;
+}
+
+
+
 // ------------------------------
 // N-th smallest element in array
 // ------------------------------
@@ -267,13 +291,10 @@ data_t nth_element(data_t *data, const size_t size, const size_t n)
 
 void set_mask(unsigned char *mask, const data_t *data, const size_t size, const data_t threshold)
 {
-	const data_t *ptr_data = data + size;
-	unsigned char *ptr_mask = mask + size;
-	
-	while(ptr_data --> data)
+	#pragma omp parallel for schedule(static)
+	for(size_t i = 0; i < size; ++i)
 	{
-		--ptr_mask;
-		if(fabs(*ptr_data) >= threshold) *ptr_mask = 1U;
+		if(fabs(data[i]) >= threshold) mask[i] = 1U;
 	}
 	
 	return;
@@ -439,7 +460,7 @@ void free_memory(double *data)
 /* FUNCTION: Check native byte order of machine */
 /* ============================================ */
 
-inline unsigned int native_byte_order(void)
+unsigned int native_byte_order(void)
 {
 	// Returns 0 on little-endian and 1 on big-endian machines
 	// NOTE: This check will only work on systems where
@@ -448,37 +469,3 @@ inline unsigned int native_byte_order(void)
 	long n = 1;
 	return *(char *)&n != 1;
 }
-
-
-
-/* ========================= */
-/* FUNCTION: Swap byte order */
-/* ========================= */
-
-inline void swap_byte_order_32(float *value)
-{
-	uint32_t tmp;
-	memcpy(&tmp, value, 4);
-	tmp = __builtin_bswap32(tmp);
-	memcpy(value, &tmp, 4);
-	return;
-}
-
-inline void swap_byte_order_64(double *value)
-{
-	uint64_t tmp;
-	memcpy(&tmp, value, 8);
-	tmp = __builtin_bswap64(tmp);
-	memcpy(value, &tmp, 8);
-	return;
-}
-
-
-/* ============ */
-/* Check if NaN */
-/* ============ */
-
-inline unsigned int is_nan(const data_t value)
-{
-	return value != value;
-}
@@ -0,0 +1,127 @@
+// ===================================================================
+// Common definitions shared by the C source files that are compiled
+// into SoFiA's native statistics library (_statistics.so). All func-
+// tions declared here are meant to be called from Python via ctypes.
+// ===================================================================
+
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define RMS_STD 0
+#define RMS_MAD 1
+#define RMS_GAUSS 2
+
+// Edge modes of the convolution filters; names and behaviour
+// follow those of scipy.ndimage.
+#define EDGE_CONSTANT 0
+#define EDGE_REFLECT  1
+#define EDGE_NEAREST  2
+#define EDGE_MIRROR   3
+#define EDGE_WRAP     4
+
+#define loop_desc(I,N) for(size_t (I) = (N); (I)--;)
+
+// Conversion factor between MAD and STD, calculated as 1.0 / scipy.stats.norm.ppf(3.0 / 4.0)
+#define MAD_TO_STD 1.482602218505602
+
+
+// Define data type
+#define DATA_T_MAX FLT_MAX
+typedef float data_t;
+//#define DATA_T_MAX DBL_MAX
+//typedef double data_t;
+
+
+
+// ---------------------
+// Function declarations
+// ---------------------
+
+// statistics.c
+unsigned int contains_nan(const data_t *data, const size_t size);
+void set_mask(unsigned char *mask, const data_t *data, const size_t size, const data_t threshold);
+double stddev(const data_t *data, const size_t size, const size_t cadence, const int flux_range, data_t value);
+data_t median(data_t *data, const size_t size, const unsigned int approx);
+data_t mad(data_t *data, const size_t size, data_t value);
+void mad_spectra(const data_t *data, double *rms, const size_t nx, const size_t ny, const size_t nz, const double clip);
+double sum(const data_t *data, const size_t size, const unsigned int mean);
+double *moment(const data_t *data, const size_t nx, const size_t ny, const size_t nz, const unsigned int mom, const double *mom0, const double *mom1);
+void uniform_filter_1d(data_t *data, const size_t nx, const size_t ny, const size_t nz, const size_t width, const unsigned int edge_mode);
+data_t nth_element(data_t *data, const size_t size, const size_t n);
+data_t max(const data_t *data, const size_t size);
+data_t min(const data_t *data, const size_t size);
+void free_memory(double *data);
+unsigned int native_byte_order(void);
+
+// filter.c
+void sc_smooth_xy(data_t *work, const data_t *data, const unsigned char *mask, const size_t nx, const size_t ny, const size_t nz, const data_t clip, const double sigma_x, const double sigma_y, const int edge_mode, const unsigned char *planes);
+size_t sc_update_mask(unsigned char *mask, const data_t *data, const size_t nx, const size_t ny, const size_t nz, const data_t threshold, unsigned char *changed);
+void sc_restore_nan(data_t *work, const data_t *data, const size_t size);
+void filter_gauss_xy(data_t *data, const size_t nx, const size_t ny, const size_t nz, const double sigma_x, const double sigma_y, const int edge_mode);
+void filter_gauss_z(data_t *data, const size_t nx, const size_t ny, const size_t nz, const double sigma, const int edge_mode);
+void filter_boxcar_z(data_t *data, const size_t nx, const size_t ny, const size_t nz, const size_t width, const int edge_mode);
+
+// atrous.c
+void atrous_x(data_t *out, const data_t *in, const size_t nx, const size_t ny, const size_t nz, const data_t *kernel, const size_t size, const size_t step);
+void atrous_y(data_t *out, const data_t *in, const size_t nx, const size_t ny, const size_t nz, const data_t *kernel, const size_t size, const size_t step);
+void atrous_z(data_t *out, const data_t *in, const size_t nx, const size_t ny, const size_t nz, const data_t *kernel, const size_t size, const size_t step);
+void wavelet_threshold(data_t *reconstruction, const data_t *coeff, unsigned char *mrs, const size_t size, const data_t threshold, const int fix_mrs, const unsigned char bit);
+data_t median_abs(const data_t *data, const size_t size);
+
+// regions.c
+size_t label_range(const int32_t *mask, const size_t size, int32_t *label_min, int32_t *label_max);
+void region_props(const int32_t *mask, const size_t nx, const size_t ny, const size_t nz, const int32_t label_min, const size_t n_labels, int64_t *bbox, double *centroid, uint64_t *n_pix, uint64_t *n_los);
+void dilate_sources(const data_t *data, int64_t *mask, const size_t nx, const size_t ny, const size_t nz, const size_t n_src, const int64_t *ids, const int64_t *bbox, const size_t chan_max, const size_t pix_max, const double threshold, uint64_t *dil, double *centroid, uint64_t *n_pix, uint64_t *n_chan, uint64_t *n_los, unsigned char *overlap);
+void source_flags(const data_t *data, const int64_t *mask, const size_t nx, const size_t ny, const size_t nz, const size_t n_src, const int64_t *ids, const int64_t *bbox, unsigned char *flags);
+
+// noise.c
+size_t local_noise(const data_t *data, double *rms, const size_t nx, const size_t ny, const size_t nz, const int64_t *grid_x, const size_t n_gx, const int64_t *grid_y, const size_t n_gy, const int64_t *grid_z, const size_t n_gz, const size_t radius_xy, const size_t radius_z, const int statistic, const int flux_range);
+void local_noise_apply(data_t *data, data_t *noise, const double *rms, const size_t nx, const size_t ny, const size_t nz, const int64_t *grid_x, const size_t n_gx, const int64_t *grid_y, const size_t n_gy, const int64_t *grid_z, const size_t n_gz, const size_t radius_xy, const size_t radius_z, const int interpolate);
+
+// ingest.c
+size_t ingest_plane(data_t *out, const data_t *in, const size_t nx, const size_t ny, const size_t stride, const int swap, const double scale, const double zero, data_t *range);
+
+// kde.c
+void kde_evaluate(const double *points, const size_t n_points, const double *targets, const size_t n_targets, const size_t dim, const double *whiten, const double cutoff, double *density);
+
+
+
+// ------------------------------------
+// Inline helpers shared by all modules
+// ------------------------------------
+
+// Check if NaN
+static inline unsigned int is_nan(const data_t value)
+{
+	return value != value;
+}
+
+// Swap byte order
+static inline void swap_byte_order_32(float *value)
+{
+	uint32_t tmp;
+	memcpy(&tmp, value, 4);
+	tmp = __builtin_bswap32(tmp);
+	memcpy(value, &tmp, 4);
+	return;
+}
+
+static inline void swap_byte_order_64(double *value)
+{
+	uint64_t tmp;
+	memcpy(&tmp, value, 8);
+	tmp = __builtin_bswap64(tmp);
+	memcpy(value, &tmp, 8);
+	return;
+}
+
+#endif